@@ -0,0 +1,716 @@
+#include "benchmark.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+#include "och_cuda_compat.cuh"
+
+#include "och_simplex_noise.h"
+#include "och_simplex_noise_gpu.cuh"
+#include "och_bytes_to_bits_gpu.cuh"
+#include "och_bit_pack.h"
+#include "och_csg.h"
+#include "och_morphology.h"
+#include "och_components.h"
+#include "och_distance_field.h"
+#include "och_thread_pool.h"
+#include "och_occupancy_pyramid.h"
+#include "och_cpu_raymarch.h"
+#include "och_frame_pipeline.h"
+#include "och_frame_stats.h"
+#include "voxels.h"
+
+#ifdef OCH_CPU_BACKEND
+static constexpr const char* kernel_backend_name = "cpu";
+#else
+static constexpr const char* kernel_backend_name = "cuda";
+#endif
+
+//A case is repeated until the relative standard deviation of its last stable_window runs is at most target_rsd
+static constexpr uint32_t stable_window = 5;
+
+static constexpr double target_rsd = 0.02;
+
+//Hard limits per case, so that slow cases (e.g. scalar 512^3) still finish. Hitting them is reported as unstable
+static constexpr uint32_t max_runs = 100;
+
+static constexpr uint32_t min_runs_over_budget = 3;
+
+static constexpr double case_budget_seconds = 5.0;
+
+struct bench_result
+{
+	const char* name;
+	const char* backend;
+	uint32_t dim;
+	uint32_t threads;
+	uint64_t voxels;
+	double bytes_per_voxel;
+	uint32_t runs;
+	double median_ns;
+	double min_ns;
+	double rsd;
+	double cycles_per_voxel;
+	bool is_stable;
+};
+
+struct bench_sample
+{
+	double ns;
+	double cycles;
+};
+
+static double relative_stddev(const bench_sample* samples, uint32_t cnt) noexcept
+{
+	double mean = 0.0;
+
+	for (uint32_t i = 0; i != cnt; ++i)
+		mean += samples[i].ns;
+
+	mean /= cnt;
+
+	double var = 0.0;
+
+	for (uint32_t i = 0; i != cnt; ++i)
+		var += (samples[i].ns - mean) * (samples[i].ns - mean);
+
+	return cnt > 1 && mean > 0.0 ? std::sqrt(var / (cnt - 1)) / mean : 0.0;
+}
+
+//Runs fn once to warm up, then repeatedly until stable. fn must not return before its work is complete.
+//Cycles are TSC ticks, i.e. reference cycles at the nominal clock rather than core cycles.
+template<typename Fn>
+static bench_result measure(const char* name, const char* backend, uint32_t dim, uint32_t threads, uint64_t voxels, double bytes_per_voxel, Fn&& fn)
+{
+	fn();
+
+	std::vector<bench_sample> samples;
+
+	const auto case_beg = std::chrono::steady_clock::now();
+
+	double rsd = 0.0;
+
+	bool is_stable = false;
+
+	while (true)
+	{
+		const auto beg = std::chrono::steady_clock::now();
+
+		const uint64_t tsc_beg = __rdtsc();
+
+		fn();
+
+		const uint64_t tsc_end = __rdtsc();
+
+		const auto end = std::chrono::steady_clock::now();
+
+		samples.push_back({ std::chrono::duration<double, std::nano>(end - beg).count(), static_cast<double>(tsc_end - tsc_beg) });
+
+		const uint32_t runs = static_cast<uint32_t>(samples.size());
+
+		if (runs >= stable_window)
+		{
+			rsd = relative_stddev(samples.data() + runs - stable_window, stable_window);
+
+			if (rsd <= target_rsd)
+			{
+				is_stable = true;
+
+				break;
+			}
+		}
+		else
+		{
+			rsd = relative_stddev(samples.data(), runs);
+		}
+
+		const double elapsed = std::chrono::duration<double>(end - case_beg).count();
+
+		if (runs == max_runs || (elapsed >= case_budget_seconds && runs >= min_runs_over_budget))
+			break;
+	}
+
+	std::sort(samples.begin(), samples.end(), [](const bench_sample& a, const bench_sample& b) { return a.ns < b.ns; });
+
+	const bench_sample& median = samples[samples.size() / 2];
+
+	return { name, backend, dim, threads, voxels, bytes_per_voxel, static_cast<uint32_t>(samples.size()), median.ns, samples.front().ns, rsd, median.cycles / voxels, is_stable };
+}
+
+static void print_result(const bench_result& r, FILE* csv)
+{
+	const double seconds = r.median_ns * 1e-9;
+
+	printf("%-26s %-6s %5u %3u %6u %10.3f %12.2f %10.2f %10.2f %6.2f%%%s\n",
+		r.name, r.backend, r.dim, r.threads, r.runs, r.median_ns * 1e-6, r.voxels / seconds * 1e-6, r.cycles_per_voxel, r.voxels * r.bytes_per_voxel / seconds * 1e-9, r.rsd * 100.0, r.is_stable ? "" : " (unstable)");
+
+	if (csv)
+		fprintf(csv, "%s,%s,%u,%u,%llu,%u,%.1f,%.1f,%.5f,%d,%.1f,%.4f,%.1f\n",
+			r.name, r.backend, r.dim, r.threads, static_cast<unsigned long long>(r.voxels), r.runs, r.median_ns, r.min_ns, r.rsd, r.is_stable ? 1 : 0, r.voxels / seconds, r.cycles_per_voxel, r.voxels * r.bytes_per_voxel / seconds);
+}
+
+static uint32_t kernel_thread_cnt() noexcept
+{
+#ifdef OCH_CPU_BACKEND
+	return cpu_backend_thread_cnt();
+#else
+	return 0;
+#endif
+}
+
+//Byte-per-voxel 26-neighbourhood dilation of a dim^3 volume as one pass per axis, the baseline for morph_dilate
+static void dilate_bytes(uint8_t* dst, uint8_t* tmp, const uint8_t* src, uint32_t dim)
+{
+	const size_t strides[3]{ 1, dim, static_cast<size_t>(dim) * dim };
+
+	const uint8_t* in = src;
+
+	uint8_t* outs[3]{ dst, tmp, dst };
+
+	for (uint32_t a = 0; a != 3; ++a)
+	{
+		uint8_t* const out = outs[a];
+
+		const size_t stride = strides[a];
+
+		for (uint32_t z = 0; z != dim; ++z)
+			for (uint32_t y = 0; y != dim; ++y)
+				for (uint32_t x = 0; x != dim; ++x)
+				{
+					const uint32_t coord = a == 0 ? x : a == 1 ? y : z;
+
+					const size_t i = x + (y + static_cast<size_t>(z) * dim) * dim;
+
+					uint8_t v = in[i];
+
+					if (coord != 0)
+						v |= in[i - stride];
+
+					if (coord + 1 != dim)
+						v |= in[i + stride];
+
+					out[i] = v;
+				}
+
+		in = out;
+	}
+}
+
+static void bench_dim(uint32_t dim_log2, FILE* csv)
+{
+	const uint32_t dim = 1 << dim_log2;
+
+	const uint64_t voxels = static_cast<uint64_t>(dim) * dim * dim;
+
+	const float step = 16.0F / dim;
+
+	std::vector<float> h_volume(voxels);
+
+	//Host noise
+
+	print_result(measure("simplex_3d", "scalar", dim, 1, voxels, sizeof(float), [&]()
+		{
+			float* dst = h_volume.data();
+
+			for (uint32_t z = 0; z != dim; ++z)
+				for (uint32_t y = 0; y != dim; ++y)
+					for (uint32_t x = 0; x != dim; ++x)
+						*dst++ = simplex_3d(x * step, y * step, z * step);
+		}), csv);
+
+	const simd_tier prev_tier = simplex_active_tier();
+
+	const simd_tier fill_tier = simplex_force_tier(simd_tier::avx2);
+
+	print_result(measure("simplex_3d_fill", simd_tier_name(fill_tier), dim, 1, voxels, sizeof(float), [&]()
+		{
+			simplex_3d_fill(h_volume.data(), 0.0F, 0.0F, 0.0F, 16.0F, 16.0F, 16.0F, dim, dim, dim);
+		}), csv);
+
+	print_result(measure("simplex_3d_fill_parallel", simd_tier_name(fill_tier), dim, thread_pool::global().thread_cnt(), voxels, sizeof(float), [&]()
+		{
+			simplex_3d_fill_parallel(h_volume.data(), 0.0F, 0.0F, 0.0F, 16.0F, 16.0F, 16.0F, dim, dim, dim);
+		}), csv);
+
+	simplex_force_tier(prev_tier);
+
+	h_volume = std::vector<float>();
+
+	//Host bit packing. Reads one byte and writes one eighth of a byte per voxel
+
+	std::vector<uint8_t> h_bytes(voxels);
+
+	//Rows are padded to whole words, which also covers the voxels / 8 bytes of the 2x2x2 layout
+	std::vector<uint64_t> h_bits(static_cast<size_t>(occupancy_row_words(dim)) * dim * dim);
+
+	simplex_3d_fill_uint8_parallel(h_bytes.data(), 0.0F, 0.0F, 0.0F, 16.0F, 16.0F, 16.0F, dim, dim, dim);
+
+	const simd_tier prev_pack_tier = pack_bits_active_tier();
+
+	for (const simd_tier tier : { simd_tier::scalar, simd_tier::avx2 })
+	{
+		if (pack_bits_force_tier(tier) != tier)
+			continue;
+
+		print_result(measure("pack_bits_2x2x2", simd_tier_name(tier), dim, thread_pool::global().thread_cnt(), voxels, 1.125, [&]()
+			{
+				pack_bits_2x2x2(reinterpret_cast<uint8_t*>(h_bits.data()), h_bytes.data(), dim, dim, dim, 128);
+			}), csv);
+
+		print_result(measure("pack_bits_rows", simd_tier_name(tier), dim, thread_pool::global().thread_cnt(), voxels, 1.125, [&]()
+			{
+				pack_bits_rows(h_bits.data(), h_bytes.data(), dim, dim, dim, 128);
+			}), csv);
+	}
+
+	pack_bits_force_tier(prev_pack_tier);
+
+	h_bits = std::vector<uint64_t>();
+
+	//CSG on packed volumes. Reads two bits and writes one bit per voxel
+
+	bit_volume world(dim, dim, dim);
+
+	pack_bits_rows(world.data(), h_bytes.data(), dim, dim, dim, 128);
+
+	const bit_volume shifted = world;
+
+	print_result(measure("csg_toggle_misaligned", "cpu", dim, thread_pool::global().thread_cnt(), voxels, 0.375, [&]()
+		{
+			csg_apply(world, shifted, csg_op::toggle, 13, 7, 5);
+		}), csv);
+
+	const uint32_t brush_dim = dim < 64 ? dim : 64;
+
+	bit_volume brush(brush_dim, brush_dim, brush_dim);
+
+	pack_bits_rows(brush.data(), h_bytes.data(), dim, dim * dim, brush_dim, brush_dim, brush_dim, 160);
+
+	print_result(measure("csg_stamp_brush", "cpu", dim, thread_pool::global().thread_cnt(), static_cast<uint64_t>(brush_dim) * brush_dim * brush_dim, 0.375, [&]()
+		{
+			csg_apply(world, brush, csg_op::unite, dim / 3, dim / 5, dim / 7);
+		}), csv);
+
+	//Morphology, against the same dilation on one byte per voxel. Reads and writes one bit, or byte, per voxel and pass
+
+	std::vector<uint8_t> h_occupied(voxels), h_dilated(voxels), h_tmp(voxels);
+
+	for (uint64_t i = 0; i != voxels; ++i)
+		h_occupied[i] = h_bytes[i] > 128;
+
+	print_result(measure("morph_dilate_bytes", "scalar", dim, 1, voxels, 6.0, [&]()
+		{
+			dilate_bytes(h_dilated.data(), h_tmp.data(), h_occupied.data(), dim);
+		}), csv);
+
+	h_occupied = h_dilated = h_tmp = std::vector<uint8_t>();
+
+	bit_volume morphed;
+
+	morph_params cube_params;
+
+	print_result(measure("morph_dilate_cube", "cpu", dim, thread_pool::global().thread_cnt(), voxels, 0.75, [&]()
+		{
+			morph_dilate(morphed, world, cube_params);
+		}), csv);
+
+	morph_params face_params;
+
+	face_params.element = morph_element::face;
+
+	print_result(measure("morph_erode_face", "cpu", dim, thread_pool::global().thread_cnt(), voxels, 0.25, [&]()
+		{
+			morph_erode(morphed, world, face_params);
+		}), csv);
+
+	//Connected components. Reads one bit and writes a 4-byte label per voxel
+
+	ccl_result components;
+
+	print_result(measure("label_components", "cpu", dim, thread_pool::global().thread_cnt(), voxels, 4.125, [&]()
+		{
+			label_components(components, world, ccl_connectivity::vertex);
+		}), csv);
+
+	//Signed distance field. Reads one bit and goes through a 4-byte squared distance per voxel on the way to a float
+
+	std::vector<float> sdf(voxels);
+
+	print_result(measure("signed_distance", "cpu", dim, thread_pool::global().thread_cnt(), voxels, 4.125 + sizeof(float), [&]()
+		{
+			signed_distance(sdf.data(), world, 16.0F);
+		}), csv);
+
+	sdf = std::vector<float>();
+
+	chunked_volume sdf_chunks(255);
+
+	print_result(measure("signed_distance_chunked", "cpu", dim, thread_pool::global().thread_cnt(), voxels, 6.125, [&]()
+		{
+			sdf_chunks.clear();
+
+			signed_distance_chunked(sdf_chunks, { 0, 0, 0 }, world, 16.0F);
+		}), csv);
+
+	h_bytes = std::vector<uint8_t>();
+
+	//Kernels
+
+	cudaPitchedPtr d_floats, d_bytes, d_bits;
+
+	if (cudaMalloc3D(&d_floats, make_cudaExtent(dim * sizeof(float), dim, dim)) != cudaSuccess
+	 || cudaMalloc3D(&d_bytes, make_cudaExtent(dim, dim, dim)) != cudaSuccess
+	 || cudaMalloc3D(&d_bits, make_cudaExtent(dim / 2, dim / 2, dim / 2)) != cudaSuccess)
+	{
+		printf("Could not allocate %u^3 volumes: %s\n", dim, cudaGetErrorString(cudaGetLastError()));
+
+		return;
+	}
+
+	const dim3 block(8, 8, 8);
+	const dim3 grid(dim / 8, dim / 8, dim / 8);
+	const dim3 grid_bits(dim / 16, dim / 16, dim / 16);
+
+	const uint32_t threads = kernel_thread_cnt();
+
+	print_result(measure("d_simplex_3d_float", kernel_backend_name, dim, threads, voxels, sizeof(float), [&]()
+		{
+			OCH_LAUNCH(d_simplex_3d_float, grid, block)(d_floats, make_uint3(dim, dim, dim), make_float3(0.0F, 0.0F, 0.0F), make_float3(step, step, step), 0);
+
+			cudaDeviceSynchronize();
+		}), csv);
+
+	print_result(measure("d_simplex_3d_uint8_t", kernel_backend_name, dim, threads, voxels, sizeof(uint8_t), [&]()
+		{
+			OCH_LAUNCH(d_simplex_3d_uint8_t, grid, block)(d_bytes, make_uint3(dim, dim, dim), make_float3(0.0F, 0.0F, 0.0F), make_float3(step, step, step), 0);
+
+			cudaDeviceSynchronize();
+		}), csv);
+
+	//Reads one byte and writes one eighth of a byte per voxel
+	print_result(measure("d_uint8_to_bit", kernel_backend_name, dim, threads, voxels, 1.125, [&]()
+		{
+			launch_uint8_to_bit(grid_bits, block, d_bits, d_bytes, 128);
+
+			cudaDeviceSynchronize();
+		}), csv);
+
+	cudaFree(d_bits.ptr);
+	cudaFree(d_bytes.ptr);
+	cudaFree(d_floats.ptr);
+
+	//Slices, sweeping every z once per run. Reads one texel, writes one byte and copies that byte back to the host per voxel
+
+	launch_voxels(dim_log2, 0.0F, 0);
+
+	std::vector<uint8_t> h_slice(static_cast<size_t>(dim) * dim);
+
+	print_result(measure("get_slice", kernel_backend_name, dim, threads, voxels, 3.0, [&]()
+		{
+			for (uint32_t z = 0; z != dim; ++z)
+				get_slice(h_slice.data(), z, dim);
+		}), csv);
+
+	release_voxels();
+}
+
+int run_benchmarks(uint32_t min_dim_log2, uint32_t max_dim_log2, const char* csv_path)
+{
+	FILE* csv = nullptr;
+
+	if (csv_path)
+	{
+		csv = fopen(csv_path, "w");
+
+		if (!csv)
+		{
+			printf("Could not open %s\n", csv_path);
+
+			return 1;
+		}
+
+		fprintf(csv, "benchmark,backend,dim,threads,voxels,runs,median_ns,min_ns,rsd,stable,voxels_per_s,cycles_per_voxel,bytes_per_s\n");
+	}
+
+	printf("%-26s %-6s %5s %3s %6s %10s %12s %10s %10s %7s\n", "benchmark", "backend", "dim", "thr", "runs", "median ms", "Mvoxels/s", "cyc/voxel", "GB/s", "rsd");
+
+	for (uint32_t dim_log2 = min_dim_log2; dim_log2 <= max_dim_log2; ++dim_log2)
+	{
+		bench_dim(dim_log2, csv);
+
+		if (csv)
+			fflush(csv);
+	}
+
+	if (csv)
+		fclose(csv);
+
+	return 0;
+}
+
+//Noise shifted down with height, so that the volume is mostly solid at the bottom and mostly empty at the top
+static void fill_terrain(std::vector<uint8_t>& volume, uint32_t dim)
+{
+	volume.resize(static_cast<size_t>(dim) * dim * dim);
+
+	simplex_3d_fill_uint8_parallel(volume.data(), 0.0F, 0.0F, 0.0F, 8.0F, 8.0F, 8.0F, dim, dim, dim);
+
+	const size_t slice_size = static_cast<size_t>(dim) * dim;
+
+	for (uint32_t z = 0; z != dim; ++z)
+	{
+		const int32_t bias = (static_cast<int32_t>(dim / 2) - static_cast<int32_t>(z)) * 512 / static_cast<int32_t>(dim);
+
+		uint8_t* slice = volume.data() + z * slice_size;
+
+		for (size_t i = 0; i != slice_size; ++i)
+		{
+			const int32_t v = slice[i] + bias;
+
+			slice[i] = static_cast<uint8_t>(v < 0 ? 0 : v > 255 ? 255 : v);
+		}
+	}
+}
+
+//Orbit above the terrain, looking slightly down towards the centre
+static raymarch_camera orbit_camera(uint32_t frame, uint32_t dim)
+{
+	const float angle = frame * 0.05F;
+
+	const float centre = dim * 0.5F;
+
+	raymarch_camera cam;
+	cam.pos[0] = centre - cosf(angle) * dim * 0.45F;
+	cam.pos[1] = centre - sinf(angle) * dim * 0.45F;
+	cam.pos[2] = dim * 0.8F;
+	cam.yaw = angle;
+	cam.pitch = -0.35F;
+	cam.fov_y = 1.0F;
+
+	return cam;
+}
+
+int run_render_benchmark(uint32_t width, uint32_t height, uint32_t frame_cnt, uint32_t dim_log2, const char* csv_path)
+{
+	FILE* csv = nullptr;
+
+	if (csv_path)
+	{
+		csv = fopen(csv_path, "w");
+
+		if (!csv)
+		{
+			printf("Could not open %s\n", csv_path);
+
+			return 1;
+		}
+
+		fprintf(csv, "benchmark,traversal,width,height,dim,threads,frames,fps,median_ms,min_ms,max_ms,mrays_per_s\n");
+	}
+
+	const uint32_t dim = 1 << dim_log2;
+
+	std::vector<uint8_t> volume;
+
+	fill_terrain(volume, dim);
+
+	occupancy_pyramid pyramid;
+
+	pyramid.build(volume.data(), dim, static_cast<size_t>(dim) * dim, dim, 128);
+
+	volume = std::vector<uint8_t>();
+
+	std::vector<uint32_t> framebuffer(static_cast<size_t>(width) * height);
+
+	const uint32_t threads = thread_pool::global().thread_cnt();
+
+	printf("raymarch %ux%u, %u^3 voxels, %u threads, %u frames\n", width, height, dim, threads, frame_cnt);
+
+	const simd_tier prev_tier = raymarch_active_tier();
+
+	//Single rays first, then packets if the CPU has them
+	const simd_tier tiers[2]{ simd_tier::scalar, detect_simd_tier() };
+
+	for (uint32_t t = 0; t != 2; ++t)
+	{
+		const simd_tier tier = raymarch_force_tier(tiers[t]);
+
+		if (t != 0 && tier == simd_tier::scalar)
+			break;
+
+		const char* traversal = tier == simd_tier::scalar ? "single" : "packet";
+
+		raymarch_render(pyramid, orbit_camera(0, dim), framebuffer.data(), width, height, width * sizeof(uint32_t));
+
+		std::vector<double> frame_ms(frame_cnt);
+
+		const auto beg = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i != frame_cnt; ++i)
+		{
+			const auto frame_beg = std::chrono::steady_clock::now();
+
+			raymarch_render(pyramid, orbit_camera(i, dim), framebuffer.data(), width, height, width * sizeof(uint32_t));
+
+			frame_ms[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_beg).count();
+		}
+
+		const double total_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - beg).count();
+
+		std::sort(frame_ms.begin(), frame_ms.end());
+
+		const double fps = frame_cnt / total_s;
+
+		const double mrays = static_cast<double>(width) * height * frame_cnt / total_s * 1e-6;
+
+		printf("%-6s %8.2f fps  median %.2f ms  min %.2f ms  max %.2f ms  %.1f Mrays/s\n", traversal, fps, frame_ms[frame_cnt / 2], frame_ms.front(), frame_ms.back(), mrays);
+
+		if (csv)
+			fprintf(csv, "raymarch_render,%s,%u,%u,%u,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f\n", traversal, width, height, dim, threads, frame_cnt, fps, frame_ms[frame_cnt / 2], frame_ms.front(), frame_ms.back(), mrays);
+	}
+
+	raymarch_force_tier(prev_tier);
+
+	if (csv)
+		fclose(csv);
+
+	return 0;
+}
+
+int run_pipeline_benchmark(uint32_t width, uint32_t height, uint32_t frame_cnt, uint32_t present_interval_us, uint32_t dim_log2, const char* csv_path)
+{
+	FILE* csv = nullptr;
+
+	if (csv_path)
+	{
+		csv = fopen(csv_path, "w");
+
+		if (!csv)
+		{
+			printf("Could not open %s\n", csv_path);
+
+			return 1;
+		}
+
+		fprintf(csv, "benchmark,frames_in_flight,width,height,dim,present_interval_us,frames,fps,median_ms,min_ms,max_ms,wait_ms\n");
+	}
+
+	const uint32_t dim = 1 << dim_log2;
+
+	std::vector<uint8_t> volume;
+
+	fill_terrain(volume, dim);
+
+	occupancy_pyramid pyramid;
+
+	pyramid.build(volume.data(), dim, static_cast<size_t>(dim) * dim, dim, 128);
+
+	volume = std::vector<uint8_t>();
+
+	printf("pipeline %ux%u, %u^3 voxels, present interval %u us, %u frames\n", width, height, dim, present_interval_us, frame_cnt);
+
+	//0 stands for the serial pipeline, which waits for every present before generating the next frame
+	for (uint32_t frames_in_flight = 0; frames_in_flight <= frames_in_flight_max; frames_in_flight = frames_in_flight ? frames_in_flight + 1 : frames_in_flight_min)
+	{
+		headless_swapchain swapchain(width, height, frames_in_flight ? frames_in_flight : frames_in_flight_min, present_interval_us);
+
+		uint64_t fence_values[frames_in_flight_max]{};
+
+		std::vector<double> frame_ms(frame_cnt);
+
+		double wait_ms = 0.0;
+
+		//Same steps as render_data::render, with raymarch_render standing in for the cuda kernel
+		const auto frame = [&](uint32_t i)
+		{
+			OCH_FRAME_NEXT();
+
+			OCH_FRAME_PROBE(frame);
+
+			const uint32_t idx = swapchain.current_backbuffer_index();
+
+			{
+				OCH_FRAME_PROBE(wait_for_fence);
+
+				const auto wait_beg = std::chrono::steady_clock::now();
+
+				swapchain.wait_for_value(fence_values[idx]);
+
+				wait_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wait_beg).count();
+			}
+
+			raymarch_render(pyramid, orbit_camera(i, dim), swapchain.backbuffer(idx), width, height, swapchain.pitch());
+
+			{
+				OCH_FRAME_PROBE(present);
+
+				fence_values[idx] = swapchain.present();
+			}
+
+			if (!frames_in_flight)
+			{
+				const auto wait_beg = std::chrono::steady_clock::now();
+
+				swapchain.wait_for_value(fence_values[idx]);
+
+				wait_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wait_beg).count();
+			}
+		};
+
+		frame(0);
+
+		swapchain.wait_for_idle();
+
+		wait_ms = 0.0;
+
+		const auto beg = std::chrono::steady_clock::now();
+
+		auto frame_beg = beg;
+
+		for (uint32_t i = 0; i != frame_cnt; ++i)
+		{
+			frame(i + 1);
+
+			const auto frame_end = std::chrono::steady_clock::now();
+
+			frame_ms[i] = std::chrono::duration<double, std::milli>(frame_end - frame_beg).count();
+
+			frame_beg = frame_end;
+		}
+
+		swapchain.wait_for_idle();
+
+		const double total_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - beg).count();
+
+		std::sort(frame_ms.begin(), frame_ms.end());
+
+		const double fps = frame_cnt / total_s;
+
+		char mode[16];
+
+		if (frames_in_flight)
+			snprintf(mode, sizeof(mode), "%u", frames_in_flight);
+		else
+			snprintf(mode, sizeof(mode), "serial");
+
+		printf("%-6s %8.2f fps  median %.2f ms  min %.2f ms  max %.2f ms  waited %.1f ms\n", mode, fps, frame_ms[frame_cnt / 2], frame_ms.front(), frame_ms.back(), wait_ms);
+
+		if (csv)
+			fprintf(csv, "headless_pipeline,%s,%u,%u,%u,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f\n", mode, width, height, dim, present_interval_us, frame_cnt, fps, frame_ms[frame_cnt / 2], frame_ms.front(), frame_ms.back(), wait_ms);
+	}
+
+	if (csv)
+		fclose(csv);
+
+	return 0;
+}
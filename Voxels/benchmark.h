@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+//Times the noise and volume kernels on cubes of edge 2^min_dim_log2 to 2^max_dim_log2.
+//Every case gets a warm-up run and is then repeated until its run times are stable or its time budget runs out.
+//Prints a table to stdout and, if csv_path is not null, writes one CSV row per case to csv_path.
+//Returns 0 on success and 1 if csv_path could not be opened.
+int run_benchmarks(uint32_t min_dim_log2 = 5, uint32_t max_dim_log2 = 9, const char* csv_path = nullptr);
+
+//Renders frame_cnt frames of a 2^dim_log2 noise terrain with raymarch_render at width x height, orbiting the camera,
+//after one warm-up frame, once with single rays and once with ray packets if the CPU supports them.
+//Prints frames per second and frame times and, if csv_path is not null, writes them as one CSV row per traversal.
+//Returns 0 on success and 1 if csv_path could not be opened.
+int run_render_benchmark(uint32_t width = 1280, uint32_t height = 720, uint32_t frame_cnt = 120, uint32_t dim_log2 = 8, const char* csv_path = nullptr);
+
+//Runs the frame pipeline of render_data against a headless_swapchain, with raymarch_render of a 2^dim_log2 noise terrain
+//standing in for the cuda kernel. Presents are held for present_interval_us to emulate vsync.
+//Renders frame_cnt frames after one warm-up frame, first waiting for every present before starting the next frame and
+//then with each of frames_in_flight_min to frames_in_flight_max frames in flight.
+//Prints frames per second, frame times and the time spent waiting on fences and, if csv_path is not null, writes them as one
+//CSV row per configuration. Returns 0 on success and 1 if csv_path could not be opened.
+int run_pipeline_benchmark(uint32_t width = 640, uint32_t height = 360, uint32_t frame_cnt = 120, uint32_t present_interval_us = 16667, uint32_t dim_log2 = 7, const char* csv_path = nullptr);
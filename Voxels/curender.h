@@ -25,6 +25,8 @@
 
 //#include "och_setints_gpu.cuh"
 #include "och_simplex_noise_gpu.cuh"
+#include "och_frame_pipeline.h"
+#include "och_frame_stats.h"
 
 //DEBUG SWITCH
 #define GRAPHICS_DEBUG
@@ -89,7 +91,9 @@ struct render_data
 	/*//////////////////////////////////DATA//////////////////////////////////*/
 	/*////////////////////////////////////////////////////////////////////////*/
 
-	static constexpr uint8_t m_frame_cnt = 2;
+	//Number of swapchain buffers, each of which can be generated by cuda or queued for presentation independently.
+	//In [frames_in_flight_min, frames_in_flight_max]
+	uint8_t m_frame_cnt;
 
 	static constexpr const wchar_t* m_window_class_name = L"OCHVXWN";
 	const wchar_t* m_window_title;
@@ -100,16 +104,22 @@ struct render_data
 	ID3D12Device2* m_device;
 	ID3D12CommandQueue* m_cmd_queue;
 	IDXGISwapChain4* m_swapchain;
-	ID3D12Resource* m_backbuffers[m_frame_cnt];
+	ID3D12Resource* m_backbuffers[frames_in_flight_max];
 	//ID3D12GraphicsCommandList* m_cmd_list;
-	//ID3D12CommandAllocator* m_cmd_allocators[m_frame_cnt];
+	//ID3D12CommandAllocator* m_cmd_allocators[frames_in_flight_max];
 	ID3D12DescriptorHeap* m_rtv_desc_heap;
 
+	//Signalled by the command queue once a backbuffer's Present has been processed. m_fence_values holds the value
+	//each backbuffer has to reach before cuda may write to it again
 	ID3D12Fence* m_fence;
-	uint64_t m_fence_values[m_frame_cnt]{};
+	uint64_t m_fence_values[frames_in_flight_max]{};
 	uint64_t m_curr_fence_value = 0;
 	HANDLE m_fence_event;
 
+	//Signalled by cuda once the kernels writing a frame have finished; waited on by the command queue before Present
+	ID3D12Fence* m_generated_fence;
+	uint64_t m_generated_fence_value = 0;
+
 	//TEMPORAL RENDER STATE
 	uint16_t m_rtv_desc_size;
 	uint16_t m_window_width = 1280;
@@ -130,10 +140,10 @@ struct render_data
 	int16_t m_mouse_h_scroll;
 
 	//CUDA INTEROP
-	cudaExternalMemory_t m_cu_external_memory_handles[m_frame_cnt];
-	cudaSurfaceObject_t m_cu_surfaces[m_frame_cnt];
+	cudaExternalMemory_t m_cu_external_memory_handles[frames_in_flight_max];
+	cudaSurfaceObject_t m_cu_surfaces[frames_in_flight_max];
 	cudaExternalSemaphore_t m_cu_fence;
-	HANDLE m_cu_backbuffer_shared_handles[m_frame_cnt];
+	HANDLE m_cu_backbuffer_shared_handles[frames_in_flight_max];
 	HANDLE m_cu_fence_shared_handle;
 
 	//D3D12 DEBUG
@@ -145,9 +155,12 @@ struct render_data
 	/*///////////////////////////////CTOR / DTOR//////////////////////////////*/
 	/*////////////////////////////////////////////////////////////////////////*/
 
-	render_data(uint32_t width, uint32_t height, const wchar_t* title)
+	//frame_cnt is clamped to [frames_in_flight_min, frames_in_flight_max]
+	render_data(uint32_t width, uint32_t height, const wchar_t* title, uint32_t frame_cnt = frames_in_flight_min)
 	{
-		och::print("Initializing...\n");
+		m_frame_cnt = static_cast<uint8_t>(frame_cnt < frames_in_flight_min ? frames_in_flight_min : frame_cnt > frames_in_flight_max ? frames_in_flight_max : frame_cnt);
+
+		och::print("Initializing with {} frames in flight...\n", m_frame_cnt);
 
 		//Timer for initialization
 		och::timer initialization_timer;
@@ -461,12 +474,15 @@ struct render_data
 		//Map backbuffers for access by cuda
 		map_backbuffers_for_cuda();
 
-		//Create a shared D3D12 fence which can also be accessed by cuda
-		m_device->CreateFence(0, D3D12_FENCE_FLAG_SHARED, IID_PPV_ARGS(&m_fence));
+		//Create the fence tracking presentation of the backbuffers
+		check(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+
+		//Create a shared D3D12 fence which is signalled by cuda
+		check(m_device->CreateFence(0, D3D12_FENCE_FLAG_SHARED, IID_PPV_ARGS(&m_generated_fence)));
 
 		//Map the previously created fence for access by cuda
 		{
-			check(m_device->CreateSharedHandle(m_fence, nullptr, GENERIC_ALL, nullptr, &m_cu_fence_shared_handle));
+			check(m_device->CreateSharedHandle(m_generated_fence, nullptr, GENERIC_ALL, nullptr, &m_cu_fence_shared_handle));
 
 			cudaExternalSemaphoreHandleDesc fence_desc{};
 			fence_desc.type = cudaExternalSemaphoreHandleTypeD3D12Fence;
@@ -505,6 +521,8 @@ struct render_data
 
 
 		//D3D12/DXGI stuff
+		m_generated_fence->Release();
+
 		m_fence->Release();
 
 		for (int i = 0; i != m_frame_cnt; ++i)
@@ -641,7 +659,8 @@ struct render_data
 		}
 	}
 
-	void count_fps()
+	//Puts the frame rate and the frame-time percentiles from och_frame_stats into the title, once per second
+	void update_title_stats()
 	{
 		static uint64_t elapsed_frames = 0;
 		static och::time last_report_time = och::time::now();
@@ -652,40 +671,14 @@ struct render_data
 
 		if ((now - last_report_time).seconds())
 		{
-			wchar_t buf[64]{};
-			
-			wchar_t* curr = buf + 62;//Leave last char null
-			
-			*curr-- = u']';
-			*curr-- = u's';
-			*curr-- = u'p';
-			*curr-- = u'f';
-			*curr-- = u' ';
-			
-			while (elapsed_frames >= 10)
-			{
-				*curr-- = u'0' + elapsed_frames % 10;
-				elapsed_frames /= 10;
-			}
-			
-			*curr-- = u'0' + static_cast<wchar_t>(elapsed_frames);
-			
-			*curr-- = u'[';
-			*curr = u' ';
-			
-			const wchar_t* prev_title = m_window_title;
-			
-			int prev_len = 0;
-			
-			while (prev_title[prev_len])
-				++prev_len;
-			
-			curr -= prev_len;
-			
-			for (int i = 0; i != prev_len; ++i)
-				curr[i] = prev_title[i];
-			
-			SetWindowTextW(m_window, curr);
+			const frame_stage_summary frame = frame_stats_summary(frame_stage::frame);
+
+			wchar_t buf[256]{};
+
+			swprintf(buf, sizeof(buf) / sizeof(*buf) - 1, L"%ls [%llu fps | p50 %.2f ms | p95 %.2f ms | p99 %.2f ms]",
+				m_window_title, static_cast<unsigned long long>(elapsed_frames), frame.p50_ms, frame.p95_ms, frame.p99_ms);
+
+			SetWindowTextW(m_window, buf);
 
 			elapsed_frames = 0;
 
@@ -693,14 +686,25 @@ struct render_data
 		}
 	}
 
+	//Generates and presents one frame without waiting for the previous ones to be shown. The only wait is for the
+	//Present of the backbuffer about to be overwritten, m_frame_cnt frames ago. Cuda signals m_generated_fence once its
+	//kernels are done and the command queue waits on that before Present, so the host never synchronizes with cuda
 	void render()
 	{
-		//Wait for current buffer to complete. TODO: Could be moved to top of function, to minimize blocking
-		if (m_fence->GetCompletedValue() < m_fence_values[m_curr_frame])
+		OCH_FRAME_NEXT();
+
+		OCH_FRAME_PROBE(frame);
+
+		//Wait until the current backbuffer is no longer queued for presentation
 		{
-			check(m_fence->SetEventOnCompletion(m_fence_values[m_curr_frame], m_fence_event));
+			OCH_FRAME_PROBE(wait_for_fence);
 
-			WaitForSingleObject(m_fence_event, INFINITE);
+			if (m_fence->GetCompletedValue() < m_fence_values[m_curr_frame])
+			{
+				check(m_fence->SetEventOnCompletion(m_fence_values[m_curr_frame], m_fence_event));
+
+				WaitForSingleObject(m_fence_event, INFINITE);
+			}
 		}
 
 		/*////////////////////////////////////////////////////////////////////////*/
@@ -718,16 +722,35 @@ struct render_data
 
 		z_offset += 1.0F / 2048.0F;
 
-		launch_simplex_3d_surface2d_grayscale_argb(threads_per_block, blocks_per_grid, m_cu_surfaces[m_curr_frame], surface_dim, offset, step, 0);
+		{
+			OCH_FRAME_PROBE(kernel_launch);
+
+			launch_simplex_3d_surface2d_grayscale_argb(threads_per_block, blocks_per_grid, m_cu_surfaces[m_curr_frame], surface_dim, offset, step, 0);
+		}
+
+		//Hand the frame over to the command queue once cuda is done with it
+		{
+			OCH_FRAME_PROBE(synchronize);
+
+			cudaExternalSemaphoreSignalParams signal_params{};
+
+			signal_params.params.fence.value = ++m_generated_fence_value;
 
-		cudaDeviceSynchronize();
+			check(cudaSignalExternalSemaphoresAsync(&m_cu_fence, &signal_params, 1, 0));
+
+			check(m_cmd_queue->Wait(m_generated_fence, m_generated_fence_value));
+		}
 
 		/*////////////////////////////////////////////////////////////////////////*/
 		/*////////////////////////////////END CUDA////////////////////////////////*/
 		/*////////////////////////////////////////////////////////////////////////*/
 
 		//TODO: Check for frame occlusion and maybe do some fancy schmancy standby stuff
-		check(m_swapchain->Present(static_cast<int32_t>(m_vsync & !m_supports_tearing), 0 /*m_supports_tearing && m_vsync ? DXGI_PRESENT_ALLOW_TEARING : 0*/));
+		{
+			OCH_FRAME_PROBE(present);
+
+			check(m_swapchain->Present(static_cast<int32_t>(m_vsync & !m_supports_tearing), 0 /*m_supports_tearing && m_vsync ? DXGI_PRESENT_ALLOW_TEARING : 0*/));
+		}
 
 		//Signal fence on completion of 'Present'
 		check(m_cmd_queue->Signal(m_fence, ++m_curr_fence_value));
@@ -800,7 +823,7 @@ LRESULT CALLBACK window_function(HWND window, UINT msg, WPARAM wp, LPARAM lp)
 		switch (msg)
 		{
 		case WM_PAINT:
-			rd.count_fps();
+			rd.update_title_stats();
 			rd.render();
 			break;
 
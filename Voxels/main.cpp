@@ -1,21 +1,279 @@
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 #include "voxels.h"
+#include "benchmark.h"
+#include "och_frame_stats.h"
+#include "och_trace.h"
 
 #include "och_simplex_noise.h"
 #include "och_fmt.h"
 
-#define OLC_PGE_APPLICATION
-#include "olcPixelGameEngine.h"
-
-#include "curender.h"
-
 constexpr int log2_sz = 8;
 
 constexpr int sz = 1 << log2_sz;
 
-uint8_t slice[sz * sz];
+//Samples of och_frame_stats still held on exit are written here
+constexpr const char* frame_stats_csv_path = "frame_stats.csv";
+
+static void dump_frame_stats()
+{
+	och::print("\n");
+
+	frame_stats_print();
+
+	if (!frame_stats_write_csv(frame_stats_csv_path))
+		och::print("Could not write {}\n", frame_stats_csv_path);
+}
+
+//Voxels [--trace <json_path>] [--frames-in-flight <n>] [other arguments]
+//Removes the first occurrence of option and its value from argv, wherever it appears after argv[0], so that options may be given
+//in any order. Returns the value or nullptr if option is absent or has no value following it
+static const char* take_option(int& argc, const char** argv, const char* option) noexcept
+{
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (strcmp(argv[i], option) != 0)
+			continue;
+
+		const char* value = argv[i + 1];
+
+		for (int j = i + 2; j != argc; ++j)
+			argv[j - 2] = argv[j];
+
+		argc -= 2;
+
+		return value;
+	}
+
+	return nullptr;
+}
+
+//Records trace events for its lifetime and writes them to path on destruction. Does nothing if path is nullptr
+struct trace_session
+{
+	explicit trace_session(const char* path) noexcept : m_path{ path }
+	{
+		if (!m_path)
+			return;
+
+		trace_set_thread_name("main");
+
+		trace_start();
+	}
+
+	~trace_session()
+	{
+		if (!m_path)
+			return;
+
+		trace_stop();
+
+		if (trace_write_json(m_path))
+			och::print("\nWrote trace to {}\n", m_path);
+		else
+			och::print("\nCould not write {}\n", m_path);
+	}
+
+	trace_session(const trace_session&) = delete;
+
+	trace_session& operator=(const trace_session&) = delete;
+
+private:
+
+	const char* m_path;
+};
+
+//Voxels --bench [csv_path] [min_dim_log2] [max_dim_log2]
+static bool is_bench_run(int argc, const char** argv) noexcept
+{
+	return argc >= 2 && strcmp(argv[1], "--bench") == 0;
+}
+
+static int bench_main(int argc, const char** argv)
+{
+	const char* csv_path = argc >= 3 ? argv[2] : nullptr;
+
+	const uint32_t min_dim_log2 = argc >= 4 ? static_cast<uint32_t>(atoi(argv[3])) : 5;
+
+	const uint32_t max_dim_log2 = argc >= 5 ? static_cast<uint32_t>(atoi(argv[4])) : 9;
+
+	if (min_dim_log2 < 5 || max_dim_log2 > 10 || min_dim_log2 > max_dim_log2)
+	{
+		printf("Volume sizes must satisfy 5 <= min_dim_log2 <= max_dim_log2 <= 10\n");
+
+		return 1;
+	}
+
+	return run_benchmarks(min_dim_log2, max_dim_log2, csv_path);
+}
+
+//Voxels --render-bench [csv_path] [width] [height] [frame_cnt] [dim_log2]
+static bool is_render_bench_run(int argc, const char** argv) noexcept
+{
+	return argc >= 2 && strcmp(argv[1], "--render-bench") == 0;
+}
+
+static int render_bench_main(int argc, const char** argv)
+{
+	const char* csv_path = argc >= 3 ? argv[2] : nullptr;
+
+	const uint32_t width = argc >= 4 ? static_cast<uint32_t>(atoi(argv[3])) : 1280;
+
+	const uint32_t height = argc >= 5 ? static_cast<uint32_t>(atoi(argv[4])) : 720;
+
+	const uint32_t frame_cnt = argc >= 6 ? static_cast<uint32_t>(atoi(argv[5])) : 120;
+
+	const uint32_t dim_log2 = argc >= 7 ? static_cast<uint32_t>(atoi(argv[6])) : 8;
+
+	if (width == 0 || height == 0 || frame_cnt == 0 || dim_log2 < 1 || dim_log2 > 10)
+	{
+		printf("Width, height and frame_cnt must be positive and 1 <= dim_log2 <= 10\n");
+
+		return 1;
+	}
+
+	return run_render_benchmark(width, height, frame_cnt, dim_log2, csv_path);
+}
+
+//Voxels --pipeline-bench [csv_path] [width] [height] [frame_cnt] [present_interval_us] [dim_log2]
+static bool is_pipeline_bench_run(int argc, const char** argv) noexcept
+{
+	return argc >= 2 && strcmp(argv[1], "--pipeline-bench") == 0;
+}
+
+static int pipeline_bench_main(int argc, const char** argv)
+{
+	const char* csv_path = argc >= 3 ? argv[2] : nullptr;
+
+	const uint32_t width = argc >= 4 ? static_cast<uint32_t>(atoi(argv[3])) : 640;
+
+	const uint32_t height = argc >= 5 ? static_cast<uint32_t>(atoi(argv[4])) : 360;
+
+	const uint32_t frame_cnt = argc >= 6 ? static_cast<uint32_t>(atoi(argv[5])) : 120;
+
+	const uint32_t present_interval_us = argc >= 7 ? static_cast<uint32_t>(atoi(argv[6])) : 16667;
+
+	const uint32_t dim_log2 = argc >= 8 ? static_cast<uint32_t>(atoi(argv[7])) : 7;
+
+	if (width == 0 || height == 0 || frame_cnt == 0 || dim_log2 < 1 || dim_log2 > 10)
+	{
+		printf("Width, height and frame_cnt must be positive and 1 <= dim_log2 <= 10\n");
+
+		return 1;
+	}
+
+	return run_pipeline_benchmark(width, height, frame_cnt, present_interval_us, dim_log2, csv_path);
+}
+
+#ifdef OCH_CPU_BACKEND
+
+#include "och_simplex_noise_gpu.cuh"
+#include "och_bytes_to_bits_gpu.cuh"
+#include "och_setints_gpu.cuh"
+
+//Headless run of every kernel on the host backend, followed by a per-kernel throughput report
+int main(int argc, const char** argv)
+{
+	const trace_session trace(take_option(argc, argv, "--trace"));
+
+	if (is_bench_run(argc, argv))
+		return bench_main(argc, argv);
+
+	if (is_render_bench_run(argc, argv))
+		return render_bench_main(argc, argv);
+
+	if (is_pipeline_bench_run(argc, argv))
+		return pipeline_bench_main(argc, argv);
+
+	launch_voxels(log2_sz, 0, 0);
+
+	uint8_t min = 255, max = 0;
+
+	slice_handle next = request_slice(0, sz);
+
+	for (uint32_t z = 0; z != sz; ++z)
+	{
+		const uint8_t* curr = wait_slice(next);
+
+		//Fetch the following slice while this one is being read
+		if (z + 1 != sz)
+			next = request_slice(z + 1, sz);
+
+		for (uint32_t i = 0; i != sz * sz; ++i)
+		{
+			if (curr[i] < min) min = curr[i];
+			if (curr[i] > max) max = curr[i];
+		}
+	}
+
+	och::print("\nmin: {}, max: {}\n", min, max);
+
+	cudaPitchedPtr d_bytes, d_floats, d_bits;
+
+	cudaMalloc3D(&d_bytes, make_cudaExtent(sz, sz, sz));
+	cudaMalloc3D(&d_floats, make_cudaExtent(sz * sizeof(float), sz, sz));
+	cudaMalloc3D(&d_bits, make_cudaExtent(sz / 2, sz / 2, sz / 2));
+
+	const dim3 block_3d(8, 8, 8);
+	const dim3 grid_3d(sz / 8, sz / 8, sz / 8);
+	const dim3 grid_bits(sz / 16, sz / 16, sz / 16);
+
+	OCH_LAUNCH(d_simplex_3d_uint8_t, grid_3d, block_3d)(d_bytes, make_uint3(sz, sz, sz), make_float3(0.0F, 0.0F, 0.0F), make_float3(16.0F / sz, 16.0F / sz, 16.0F / sz), 0);
+	OCH_LAUNCH(d_simplex_3d_float, grid_3d, block_3d)(d_floats, make_uint3(sz, sz, sz), make_float3(0.0F, 0.0F, 0.0F), make_float3(16.0F / sz, 16.0F / sz, 16.0F / sz), 0);
+
+	launch_uint8_to_bit(grid_bits, block_3d, d_bits, d_bytes, 128);
+	launch_float_to_bit(grid_bits, block_3d, d_bits, d_floats, 0.0F);
+
+	constexpr uint32_t surf_w = 1280, surf_h = 720;
+
+	const cudaChannelFormatDesc surf_desc = cudaCreateChannelDesc<uchar4>();
+
+	cudaArray_t surf_arr;
+
+	cudaMallocArray(&surf_arr, &surf_desc, surf_w, surf_h, cudaArraySurfaceLoadStore);
+
+	cudaResourceDesc res_desc{};
+	res_desc.resType = cudaResourceTypeArray;
+	res_desc.res.array.array = surf_arr;
+
+	cudaSurfaceObject_t surf;
+
+	cudaCreateSurfaceObject(&surf, &res_desc);
+
+	const dim3 block_2d(16, 16);
+	const dim3 grid_2d((surf_w + 15) / 16, (surf_h + 15) / 16);
+
+	launch_set_surface_to(grid_2d, block_2d, 0, surf, surf_w, surf_h);
+	launch_set_memory_to(grid_2d, block_2d, 0, d_floats.ptr, surf_w, surf_w, surf_h);
+
+	for (uint32_t i = 0; i != 16; ++i)
+		launch_simplex_3d_surface2d_grayscale_argb(grid_2d, block_2d, surf, make_uint2(surf_w, surf_h), make_float3(0.0F, 0.0F, i / 16.0F), make_float2(1.0F / 64.0F, 1.0F / 64.0F), 0);
+
+	if (cudaError_t err = cudaGetLastError())
+		och::print("Error: {}\n", cudaGetErrorString(err));
+
+	cudaDestroySurfaceObject(surf);
+	cudaFreeArray(surf_arr);
+	cudaFree(d_bits.ptr);
+	cudaFree(d_floats.ptr);
+	cudaFree(d_bytes.ptr);
+
+	och::print("\n");
+
+	cpu_backend_print_kernel_stats();
+
+	dump_frame_stats();
+}
+
+#else
+
+#define OLC_PGE_APPLICATION
+#include "olcPixelGameEngine.h"
+
+#include "curender.h"
 
 class window : public olc::PixelGameEngine
 {
@@ -25,6 +283,13 @@ public:
 
 	uint8_t max = 0, min = 255;
 
+	//Slice being fetched in the background, and the most recent completed one, which is drawn until the next completes
+	slice_handle pending;
+
+	bool has_pending = false;
+
+	const uint8_t* shown = nullptr;
+
 	window() { sAppName = "Test"; }
 
 	bool OnUserCreate() override
@@ -45,12 +310,30 @@ public:
 			och::print("\nmin: {}, max: {}\n", min, max);
 		}
 
-		get_slice(slice, (uint32_t) total_t, sz);
+		const uint32_t z = (uint32_t) total_t;
+
+		if (!has_pending)
+		{
+			pending = request_slice(z, sz);
+
+			has_pending = true;
+		}
+
+		//Never wait for a copy. Once the pending slice is in, prefetch the one the next frame most likely needs
+		if (const uint8_t* completed = try_get_slice(pending))
+		{
+			shown = completed;
+
+			pending = request_slice(z + 1 == sz ? 0 : z + 1, sz);
+		}
+
+		if (!shown)
+			return true;
 
 		for (int y = 0; y != sz; ++y)
 			for (int x = 0; x != sz; ++x)
 			{
-				uint8_t col = slice[x + y * sz];
+				uint8_t col = shown[x + y * sz];
 
 				if (col < min) min = col;
 				if (col > max) max = col;
@@ -66,13 +349,30 @@ const och::stringview screen_id("screen");
 
 int main(int argc, const char** argv)
 {
+	const trace_session trace(take_option(argc, argv, "--trace"));
+
+	if (is_bench_run(argc, argv))
+		return bench_main(argc, argv);
+
+	if (is_render_bench_run(argc, argv))
+		return render_bench_main(argc, argv);
+
+	if (is_pipeline_bench_run(argc, argv))
+		return pipeline_bench_main(argc, argv);
+
 	//launch_voxels(log2_sz, 0, 0);
 	
 	//window w;
 	//if (w.Construct(sz, sz, 1, 1))
 	//	w.Start();
 
-	render_data r(1280, 720, L"Hello there");
+	const char* frames_in_flight = take_option(argc, argv, "--frames-in-flight");
+
+	render_data r(1280, 720, L"Hello there", frames_in_flight ? static_cast<uint32_t>(atoi(frames_in_flight)) : frames_in_flight_min);
 	
 	r.run();
+
+	dump_frame_stats();
 }
+
+#endif // OCH_CPU_BACKEND
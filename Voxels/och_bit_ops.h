@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//Small bit helpers shared by several modules, so that each is defined once
+
+//Number of set bits among the low 8 bits of v
+inline uint32_t popcount8(uint32_t v) noexcept
+{
+	v = v - ((v >> 1) & 0x55);
+	v = (v & 0x33) + ((v >> 2) & 0x33);
+
+	return (v + (v >> 4)) & 0x0F;
+}
+
+inline uint32_t popcount64(uint64_t v) noexcept
+{
+#ifdef _MSC_VER
+	//__popcnt64 would need the POPCNT instruction, which the scalar tier does not assume
+	v = v - ((v >> 1) & 0x5555'5555'5555'5555ULL);
+	v = (v & 0x3333'3333'3333'3333ULL) + ((v >> 2) & 0x3333'3333'3333'3333ULL);
+	v = (v + (v >> 4)) & 0x0F0F'0F0F'0F0F'0F0FULL;
+
+	return static_cast<uint32_t>((v * 0x0101'0101'0101'0101ULL) >> 56);
+#else
+	return static_cast<uint32_t>(__builtin_popcountll(v));
+#endif
+}
+
+//Index of the lowest set bit of v, which must not be 0
+inline uint32_t ctz64(uint64_t v) noexcept
+{
+#ifdef _MSC_VER
+	unsigned long idx;
+
+	_BitScanForward64(&idx, v);
+
+	return static_cast<uint32_t>(idx);
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(v));
+#endif
+}
+
+//Smallest power of two that is at least n
+inline uint32_t round_up_pow2(uint32_t n) noexcept
+{
+	uint32_t p = 1;
+
+	while (p < n)
+		p <<= 1;
+
+	return p;
+}
+
+//Exponent of p, which must be a power of two
+inline uint32_t log2_of_pow2(uint32_t p) noexcept
+{
+	uint32_t l = 0;
+
+	while ((1u << l) < p)
+		++l;
+
+	return l;
+}
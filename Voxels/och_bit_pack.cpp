@@ -0,0 +1,159 @@
+#include "och_bit_pack.h"
+
+#include <atomic>
+
+#include "och_bit_pack_backends.h"
+
+#include "och_thread_pool.h"
+#include "och_trace.h"
+
+template<typename T>
+static void scalar_2x2x2(uint8_t* dst, const T* r00, const T* r10, const T* r01, const T* r11, uint32_t dst_cnt, T cutoff)
+{
+	for (uint32_t i = 0; i != dst_cnt; ++i)
+	{
+		const uint32_t x = i * 2;
+
+		uint8_t output = 0;
+
+		output |= (r00[x] > cutoff);
+		output |= (r00[x + 1] > cutoff) << 1;
+		output |= (r10[x] > cutoff) << 2;
+		output |= (r10[x + 1] > cutoff) << 3;
+		output |= (r01[x] > cutoff) << 4;
+		output |= (r01[x + 1] > cutoff) << 5;
+		output |= (r11[x] > cutoff) << 6;
+		output |= (r11[x + 1] > cutoff) << 7;
+
+		dst[i] = output;
+	}
+}
+
+template<typename T>
+static void scalar_rows(uint64_t* dst, const T* src, uint32_t x_cnt, T cutoff)
+{
+	for (uint32_t word_beg = 0; word_beg < x_cnt; word_beg += 64)
+	{
+		uint64_t word = 0;
+
+		for (uint32_t b = 0; b != 64 && word_beg + b != x_cnt; ++b)
+			word |= static_cast<uint64_t>(src[word_beg + b] > cutoff) << b;
+
+		dst[word_beg / 64] = word;
+	}
+}
+
+const bit_pack_backend bit_pack_backend_scalar{ simd_tier::scalar, scalar_2x2x2<uint8_t>, scalar_2x2x2<float>, scalar_rows<uint8_t>, scalar_rows<float> };
+
+static const bit_pack_backend* backend_for_tier(simd_tier tier) noexcept
+{
+	return static_cast<uint8_t>(tier) >= static_cast<uint8_t>(simd_tier::avx2) ? &bit_pack_backend_avx2 : &bit_pack_backend_scalar;
+}
+
+static std::atomic<const bit_pack_backend*>& active_backend_ptr() noexcept
+{
+	static std::atomic<const bit_pack_backend*> backend{ backend_for_tier(detect_simd_tier()) };
+
+	return backend;
+}
+
+static const bit_pack_backend& active_backend() noexcept
+{
+	return *active_backend_ptr().load(std::memory_order_relaxed);
+}
+
+simd_tier pack_bits_force_tier(simd_tier tier)
+{
+	const bit_pack_backend* backend = backend_for_tier(clamp_simd_tier(tier));
+
+	active_backend_ptr().store(backend, std::memory_order_relaxed);
+
+	return backend->tier;
+}
+
+simd_tier pack_bits_active_tier()
+{
+	return active_backend().tier;
+}
+
+template<typename T>
+static const T* row_at(const T* src, size_t pitch, size_t slice_pitch, uint32_t y, uint32_t z) noexcept
+{
+	return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(src) + y * pitch + z * slice_pitch);
+}
+
+template<typename T, typename Row_fn>
+static void pack_2x2x2(uint8_t* dst, size_t dst_pitch, size_t dst_slice_pitch, const T* src, size_t src_pitch, size_t src_slice_pitch, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, T cutoff, uint32_t max_threads, Row_fn row_fn)
+{
+	OCH_TRACE_SCOPE("pack_bits_2x2x2", { "x_cnt", x_cnt }, { "y_cnt", y_cnt }, { "z_cnt", z_cnt });
+
+	const uint32_t dst_x_cnt = x_cnt / 2;
+	const uint32_t dst_y_cnt = y_cnt / 2;
+
+	thread_pool::global().parallel_for(z_cnt / 2, [&](uint32_t z, uint32_t)
+		{
+			for (uint32_t y = 0; y != dst_y_cnt; ++y)
+			{
+				const T* const r00 = row_at(src, src_pitch, src_slice_pitch, y * 2, z * 2);
+				const T* const r10 = row_at(src, src_pitch, src_slice_pitch, y * 2 + 1, z * 2);
+				const T* const r01 = row_at(src, src_pitch, src_slice_pitch, y * 2, z * 2 + 1);
+				const T* const r11 = row_at(src, src_pitch, src_slice_pitch, y * 2 + 1, z * 2 + 1);
+
+				row_fn(dst + y * dst_pitch + z * dst_slice_pitch, r00, r10, r01, r11, dst_x_cnt, cutoff);
+			}
+		}, max_threads);
+}
+
+template<typename T, typename Row_fn>
+static void pack_rows(uint64_t* dst, const T* src, size_t src_pitch, size_t src_slice_pitch, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, T cutoff, uint32_t max_threads, Row_fn row_fn)
+{
+	OCH_TRACE_SCOPE("pack_bits_rows", { "x_cnt", x_cnt }, { "y_cnt", y_cnt }, { "z_cnt", z_cnt });
+
+	const uint32_t row_words = occupancy_row_words(x_cnt);
+
+	thread_pool::global().parallel_for(z_cnt, [&](uint32_t z, uint32_t)
+		{
+			for (uint32_t y = 0; y != y_cnt; ++y)
+				row_fn(dst + (y + static_cast<size_t>(z) * y_cnt) * row_words, row_at(src, src_pitch, src_slice_pitch, y, z), x_cnt, cutoff);
+		}, max_threads);
+}
+
+void pack_bits_2x2x2(uint8_t* dst, size_t dst_pitch, size_t dst_slice_pitch, const uint8_t* src, size_t src_pitch, size_t src_slice_pitch, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint8_t cutoff, uint32_t max_threads)
+{
+	pack_2x2x2(dst, dst_pitch, dst_slice_pitch, src, src_pitch, src_slice_pitch, x_cnt, y_cnt, z_cnt, cutoff, max_threads, active_backend().bytes_2x2x2);
+}
+
+void pack_bits_2x2x2(uint8_t* dst, size_t dst_pitch, size_t dst_slice_pitch, const float* src, size_t src_pitch, size_t src_slice_pitch, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, float cutoff, uint32_t max_threads)
+{
+	pack_2x2x2(dst, dst_pitch, dst_slice_pitch, src, src_pitch, src_slice_pitch, x_cnt, y_cnt, z_cnt, cutoff, max_threads, active_backend().floats_2x2x2);
+}
+
+void pack_bits_2x2x2(uint8_t* dst, const uint8_t* src, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint8_t cutoff, uint32_t max_threads)
+{
+	pack_bits_2x2x2(dst, x_cnt / 2, static_cast<size_t>(x_cnt / 2) * (y_cnt / 2), src, x_cnt, static_cast<size_t>(x_cnt) * y_cnt, x_cnt, y_cnt, z_cnt, cutoff, max_threads);
+}
+
+void pack_bits_2x2x2(uint8_t* dst, const float* src, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, float cutoff, uint32_t max_threads)
+{
+	pack_bits_2x2x2(dst, x_cnt / 2, static_cast<size_t>(x_cnt / 2) * (y_cnt / 2), src, x_cnt * sizeof(float), static_cast<size_t>(x_cnt) * y_cnt * sizeof(float), x_cnt, y_cnt, z_cnt, cutoff, max_threads);
+}
+
+void pack_bits_rows(uint64_t* dst, const uint8_t* src, size_t src_pitch, size_t src_slice_pitch, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint8_t cutoff, uint32_t max_threads)
+{
+	pack_rows(dst, src, src_pitch, src_slice_pitch, x_cnt, y_cnt, z_cnt, cutoff, max_threads, active_backend().bytes_rows);
+}
+
+void pack_bits_rows(uint64_t* dst, const float* src, size_t src_pitch, size_t src_slice_pitch, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, float cutoff, uint32_t max_threads)
+{
+	pack_rows(dst, src, src_pitch, src_slice_pitch, x_cnt, y_cnt, z_cnt, cutoff, max_threads, active_backend().floats_rows);
+}
+
+void pack_bits_rows(uint64_t* dst, const uint8_t* src, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint8_t cutoff, uint32_t max_threads)
+{
+	pack_bits_rows(dst, src, x_cnt, static_cast<size_t>(x_cnt) * y_cnt, x_cnt, y_cnt, z_cnt, cutoff, max_threads);
+}
+
+void pack_bits_rows(uint64_t* dst, const float* src, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, float cutoff, uint32_t max_threads)
+{
+	pack_bits_rows(dst, src, x_cnt * sizeof(float), static_cast<size_t>(x_cnt) * y_cnt * sizeof(float), x_cnt, y_cnt, z_cnt, cutoff, max_threads);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "och_cpu_features.h"
+#include "och_simplex_noise.h"
+
+//Host equivalents of d_uint8_to_bit and d_float_to_bit. A voxel is occupied if its density is greater than cutoff.
+//Source pitches are in bytes, as in a cudaPitchedPtr; the overloads without pitches take tightly packed x-major volumes.
+//Slices of the output are spread over the threads of thread_pool::global(), max_threads capping their number (0 meaning no cap).
+
+//Writes one byte per 2x2x2 block of voxels, bit i being the voxel at (i & 1, (i >> 1) & 1, i >> 2) within the block,
+//exactly as d_uint8_to_bit does. x_cnt, y_cnt and z_cnt are the source dimensions and must be even.
+//dst has x_cnt / 2 bytes per row, dst_pitch bytes apart, and dst_slice_pitch bytes between slices
+void pack_bits_2x2x2(uint8_t* dst, size_t dst_pitch, size_t dst_slice_pitch, const uint8_t* src, size_t src_pitch, size_t src_slice_pitch, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint8_t cutoff, uint32_t max_threads = 0);
+
+void pack_bits_2x2x2(uint8_t* dst, size_t dst_pitch, size_t dst_slice_pitch, const float* src, size_t src_pitch, size_t src_slice_pitch, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, float cutoff, uint32_t max_threads = 0);
+
+void pack_bits_2x2x2(uint8_t* dst, const uint8_t* src, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint8_t cutoff, uint32_t max_threads = 0);
+
+void pack_bits_2x2x2(uint8_t* dst, const float* src, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, float cutoff, uint32_t max_threads = 0);
+
+//Writes the row-linear layout of simplex_3d_fill_bits: voxel (x, y, z) is bit x % 64 of
+//dst[x / 64 + (y + z * y_cnt) * occupancy_row_words(x_cnt)]. Unused bits at the end of a row are zero
+void pack_bits_rows(uint64_t* dst, const uint8_t* src, size_t src_pitch, size_t src_slice_pitch, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint8_t cutoff, uint32_t max_threads = 0);
+
+void pack_bits_rows(uint64_t* dst, const float* src, size_t src_pitch, size_t src_slice_pitch, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, float cutoff, uint32_t max_threads = 0);
+
+void pack_bits_rows(uint64_t* dst, const uint8_t* src, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint8_t cutoff, uint32_t max_threads = 0);
+
+void pack_bits_rows(uint64_t* dst, const float* src, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, float cutoff, uint32_t max_threads = 0);
+
+//Forces the pack functions to use scalar code (simd_tier::scalar, sse4) or AVX2 (simd_tier::avx2 and above) for
+//clamp_simd_tier(tier), e.g. for benchmarking. Returns the tier of the backend now in use
+simd_tier pack_bits_force_tier(simd_tier tier);
+
+simd_tier pack_bits_active_tier();
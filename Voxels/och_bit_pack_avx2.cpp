@@ -0,0 +1,120 @@
+#include "och_bit_pack_backends.h"
+
+#include <cstdint>
+
+#include <immintrin.h>
+
+//Compiled with /arch:AVX2 (see Voxels.vcxproj); GCC and Clang get the equivalent target here
+#if defined(__GNUC__) && !defined(__AVX2__)
+#pragma GCC target("avx2,fma")
+#endif
+
+//0xFF in every byte whose source voxel at src[0, 32) is greater than cutoff, 0 elsewhere.
+//Bytes are compared as signed after flipping their top bit, which orders them as unsigned
+static OCH_SIMD_INLINE __m256i occupied_bytes(const uint8_t* src, __m256i cutoff_flipped)
+{
+	const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+
+	return _mm256_cmpgt_epi8(_mm256_xor_si256(v, _mm256_set1_epi8(static_cast<char>(0x80))), cutoff_flipped);
+}
+
+//Same for floats. The four comparisons are narrowed to bytes with two rounds of saturating packs, whose lane-wise
+//interleaving is undone by a single cross-lane permute
+static OCH_SIMD_INLINE __m256i occupied_bytes(const float* src, __m256 cutoff)
+{
+	const __m256i a = _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(src), cutoff, _CMP_GT_OQ));
+	const __m256i b = _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(src + 8), cutoff, _CMP_GT_OQ));
+	const __m256i c = _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(src + 16), cutoff, _CMP_GT_OQ));
+	const __m256i d = _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(src + 24), cutoff, _CMP_GT_OQ));
+
+	const __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+
+	return _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+//Comparand for occupied_bytes
+static OCH_SIMD_INLINE __m256i broadcast_cutoff(uint8_t cutoff)
+{
+	return _mm256_set1_epi8(static_cast<char>(cutoff ^ 0x80));
+}
+
+static OCH_SIMD_INLINE __m256 broadcast_cutoff(float cutoff)
+{
+	return _mm256_set1_ps(cutoff);
+}
+
+//Combines the occupied bytes of 32 source voxels from each of the four rows of a 2x2x2 block into 16 output bytes,
+//returned in the low byte of each 16-bit lane. Every row contributes its even voxels to one bit and its odd voxels to the
+//next, so adding neighbouring bytes yields the block's byte
+static OCH_SIMD_INLINE __m256i combine_2x2x2(__m256i m00, __m256i m10, __m256i m01, __m256i m11)
+{
+	const __m256i bits = _mm256_or_si256(
+		_mm256_or_si256(_mm256_and_si256(m00, _mm256_set1_epi16(0x0201)), _mm256_and_si256(m10, _mm256_set1_epi16(0x0804))),
+		_mm256_or_si256(_mm256_and_si256(m01, _mm256_set1_epi16(0x2010)), _mm256_and_si256(m11, _mm256_set1_epi16(static_cast<short>(0x8040)))));
+
+	return _mm256_maddubs_epi16(bits, _mm256_set1_epi8(1));
+}
+
+template<typename T>
+static OCH_SIMD_INLINE void avx2_2x2x2(uint8_t* dst, const T* r00, const T* r10, const T* r01, const T* r11, uint32_t dst_cnt, T scalar_cutoff, void (*scalar_fn)(uint8_t*, const T*, const T*, const T*, const T*, uint32_t, T))
+{
+	const auto cutoff = broadcast_cutoff(scalar_cutoff);
+
+	uint32_t i = 0;
+
+	for (; i + 32 <= dst_cnt; i += 32)
+	{
+		const uint32_t x = i * 2;
+
+		const __m256i lo = combine_2x2x2(occupied_bytes(r00 + x, cutoff), occupied_bytes(r10 + x, cutoff), occupied_bytes(r01 + x, cutoff), occupied_bytes(r11 + x, cutoff));
+		const __m256i hi = combine_2x2x2(occupied_bytes(r00 + x + 32, cutoff), occupied_bytes(r10 + x + 32, cutoff), occupied_bytes(r01 + x + 32, cutoff), occupied_bytes(r11 + x + 32, cutoff));
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8));
+	}
+
+	if (i != dst_cnt)
+		scalar_fn(dst + i, r00 + i * 2, r10 + i * 2, r01 + i * 2, r11 + i * 2, dst_cnt - i, scalar_cutoff);
+}
+
+template<typename T>
+static OCH_SIMD_INLINE void avx2_rows(uint64_t* dst, const T* src, uint32_t x_cnt, T scalar_cutoff, void (*scalar_fn)(uint64_t*, const T*, uint32_t, T))
+{
+	const auto cutoff = broadcast_cutoff(scalar_cutoff);
+
+	uint32_t x = 0;
+
+	for (; x + 64 <= x_cnt; x += 64)
+	{
+		const uint32_t lo = static_cast<uint32_t>(_mm256_movemask_epi8(occupied_bytes(src + x, cutoff)));
+		const uint32_t hi = static_cast<uint32_t>(_mm256_movemask_epi8(occupied_bytes(src + x + 32, cutoff)));
+
+		dst[x / 64] = lo | static_cast<uint64_t>(hi) << 32;
+	}
+
+	if (x != x_cnt)
+		scalar_fn(dst + x / 64, src + x, x_cnt - x, scalar_cutoff);
+}
+
+//Row tails shorter than one vector step are left to the scalar kernels
+
+static void bytes_2x2x2(uint8_t* dst, const uint8_t* r00, const uint8_t* r10, const uint8_t* r01, const uint8_t* r11, uint32_t dst_cnt, uint8_t cutoff)
+{
+	avx2_2x2x2(dst, r00, r10, r01, r11, dst_cnt, cutoff, bit_pack_backend_scalar.bytes_2x2x2);
+}
+
+static void floats_2x2x2(uint8_t* dst, const float* r00, const float* r10, const float* r01, const float* r11, uint32_t dst_cnt, float cutoff)
+{
+	avx2_2x2x2(dst, r00, r10, r01, r11, dst_cnt, cutoff, bit_pack_backend_scalar.floats_2x2x2);
+}
+
+static void bytes_rows(uint64_t* dst, const uint8_t* src, uint32_t x_cnt, uint8_t cutoff)
+{
+	avx2_rows(dst, src, x_cnt, cutoff, bit_pack_backend_scalar.bytes_rows);
+}
+
+static void floats_rows(uint64_t* dst, const float* src, uint32_t x_cnt, float cutoff)
+{
+	avx2_rows(dst, src, x_cnt, cutoff, bit_pack_backend_scalar.floats_rows);
+}
+
+const bit_pack_backend bit_pack_backend_avx2{ simd_tier::avx2, bytes_2x2x2, floats_2x2x2, bytes_rows, floats_rows };
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+#include "och_cpu_features.h"
+
+//Per-row kernels of the pack functions. r00 to r11 are the source rows at (y, z), (y + 1, z), (y, z + 1) and (y + 1, z + 1),
+//of which dst_cnt * 2 voxels are read. The bits rows read x_cnt voxels and write occupancy_row_words(x_cnt) words
+struct bit_pack_backend
+{
+	simd_tier tier;
+
+	void (*bytes_2x2x2)(uint8_t* dst, const uint8_t* r00, const uint8_t* r10, const uint8_t* r01, const uint8_t* r11, uint32_t dst_cnt, uint8_t cutoff);
+
+	void (*floats_2x2x2)(uint8_t* dst, const float* r00, const float* r10, const float* r01, const float* r11, uint32_t dst_cnt, float cutoff);
+
+	void (*bytes_rows)(uint64_t* dst, const uint8_t* src, uint32_t x_cnt, uint8_t cutoff);
+
+	void (*floats_rows)(uint64_t* dst, const float* src, uint32_t x_cnt, float cutoff);
+};
+
+extern const bit_pack_backend bit_pack_backend_scalar;
+
+extern const bit_pack_backend bit_pack_backend_avx2;
@@ -0,0 +1,214 @@
+#include "och_bit_volume.h"
+
+#include <cstring>
+
+static constexpr int32_t chunk_mask = static_cast<int32_t>(chunked_bit_volume::chunk_dim) - 1;
+
+static bool is_uniform(const uint64_t* words, uint64_t& pattern) noexcept
+{
+	pattern = words[0];
+
+	if (pattern != 0 && pattern != ~0ULL)
+		return false;
+
+	for (uint32_t i = 1; i != chunked_bit_volume::chunk_words; ++i)
+		if (words[i] != pattern)
+			return false;
+
+	return true;
+}
+
+bit_volume::bit_volume(uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt) :
+	m_x_cnt{ x_cnt }, m_y_cnt{ y_cnt }, m_z_cnt{ z_cnt }, m_words(static_cast<size_t>(occupancy_row_words(x_cnt)) * y_cnt * z_cnt) {}
+
+void bit_volume::set(uint32_t x, uint32_t y, uint32_t z, bool value) noexcept
+{
+	uint64_t& word = row(y, z)[x / 64];
+
+	const uint64_t bit = 1ULL << (x % 64);
+
+	word = value ? word | bit : word & ~bit;
+}
+
+uint64_t bit_volume::popcount() const noexcept
+{
+	uint64_t cnt = 0;
+
+	for (const uint64_t word : m_words)
+		cnt += popcount64(word);
+
+	return cnt;
+}
+
+bit_chunk_state chunked_bit_volume::find_chunk(chunk_coord coord, const uint64_t*& words) const noexcept
+{
+	const auto it = m_chunks.find(coord);
+
+	words = nullptr;
+
+	if (it == m_chunks.end())
+		return bit_chunk_state::empty;
+
+	words = it->second.words.get();
+
+	return words ? bit_chunk_state::mixed : bit_chunk_state::full;
+}
+
+bool chunked_bit_volume::get(int32_t x, int32_t y, int32_t z) const noexcept
+{
+	const uint64_t* words;
+
+	const bit_chunk_state state = find_chunk({ x >> chunk_dim_log2, y >> chunk_dim_log2, z >> chunk_dim_log2 }, words);
+
+	if (state != bit_chunk_state::mixed)
+		return state == bit_chunk_state::full;
+
+	return (words[(y & chunk_mask) + (z & chunk_mask) * chunk_dim] >> (x & chunk_mask)) & 1;
+}
+
+void chunked_bit_volume::set(int32_t x, int32_t y, int32_t z, bool value)
+{
+	const chunk_coord coord{ x >> chunk_dim_log2, y >> chunk_dim_log2, z >> chunk_dim_log2 };
+
+	const uint64_t* words;
+
+	const bit_chunk_state state = find_chunk(coord, words);
+
+	if (state == (value ? bit_chunk_state::full : bit_chunk_state::empty))
+		return;
+
+	uint64_t& word = mixed_chunk(coord)[(y & chunk_mask) + (z & chunk_mask) * chunk_dim];
+
+	const uint64_t bit = 1ULL << (x & chunk_mask);
+
+	word = value ? word | bit : word & ~bit;
+}
+
+uint64_t* chunked_bit_volume::mixed_chunk(chunk_coord coord)
+{
+	auto it = m_chunks.find(coord);
+
+	uint64_t fill = ~0ULL;
+
+	if (it == m_chunks.end())
+	{
+		it = m_chunks.emplace(coord, chunk{ nullptr }).first;
+
+		fill = 0;
+	}
+
+	chunk& c = it->second;
+
+	if (!c.words)
+	{
+		c.words.reset(new uint64_t[chunk_words]);
+
+		for (uint32_t i = 0; i != chunk_words; ++i)
+			c.words[i] = fill;
+
+		++m_mixed_cnt;
+	}
+
+	return c.words.get();
+}
+
+void chunked_bit_volume::set_chunk_uniform(chunk_coord coord, bool value)
+{
+	auto it = m_chunks.find(coord);
+
+	if (it != m_chunks.end())
+	{
+		if (it->second.words)
+			--m_mixed_cnt;
+
+		if (!value)
+		{
+			m_chunks.erase(it);
+
+			return;
+		}
+
+		it->second.words.reset();
+	}
+	else if (value)
+	{
+		m_chunks.emplace(coord, chunk{ nullptr });
+	}
+}
+
+void chunked_bit_volume::set_chunk(chunk_coord coord, const uint64_t* src)
+{
+	uint64_t pattern;
+
+	if (is_uniform(src, pattern))
+	{
+		set_chunk_uniform(coord, pattern != 0);
+
+		return;
+	}
+
+	memcpy(mixed_chunk(coord), src, chunk_words * sizeof(uint64_t));
+}
+
+void chunked_bit_volume::collapse_chunk(chunk_coord coord)
+{
+	const uint64_t* words;
+
+	uint64_t pattern;
+
+	if (find_chunk(coord, words) == bit_chunk_state::mixed && is_uniform(words, pattern))
+		set_chunk_uniform(coord, pattern != 0);
+}
+
+std::vector<chunk_coord> chunked_bit_volume::chunk_coords() const
+{
+	std::vector<chunk_coord> coords;
+
+	coords.reserve(m_chunks.size());
+
+	for (const auto& [coord, c] : m_chunks)
+		coords.push_back(coord);
+
+	return coords;
+}
+
+void chunked_bit_volume::compact()
+{
+	for (const chunk_coord coord : chunk_coords())
+		collapse_chunk(coord);
+}
+
+void chunked_bit_volume::clear() noexcept
+{
+	m_chunks.clear();
+
+	m_mixed_cnt = 0;
+}
+
+uint64_t chunked_bit_volume::popcount() const noexcept
+{
+	uint64_t cnt = 0;
+
+	for (const auto& [coord, c] : m_chunks)
+	{
+		if (!c.words)
+		{
+			cnt += static_cast<uint64_t>(chunk_words) * chunk_dim;
+
+			continue;
+		}
+
+		for (uint32_t i = 0; i != chunk_words; ++i)
+			cnt += popcount64(c.words[i]);
+	}
+
+	return cnt;
+}
+
+size_t chunked_bit_volume::memory_bytes() const noexcept
+{
+	//Bucket array plus one heap node (next pointer, cached hash, key, chunk) per stored chunk
+	constexpr size_t node_bytes = sizeof(void*) + sizeof(size_t) + sizeof(chunk_coord) + sizeof(chunk);
+
+	return sizeof(*this) + m_chunks.bucket_count() * sizeof(void*) + m_chunks.size() * node_bytes + m_mixed_cnt * chunk_words * sizeof(uint64_t);
+}
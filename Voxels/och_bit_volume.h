@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "och_bit_ops.h"
+#include "och_chunked_volume.h"
+#include "och_simplex_noise.h"
+
+//Dense binary volume in the row-linear layout of simplex_3d_fill_bits and pack_bits_rows: voxel (x, y, z) is bit x % 64 of
+//word x / 64 of row (y, z), rows being row_words() words long. Unused bits at the end of a row are always zero.
+struct bit_volume
+{
+	bit_volume() = default;
+
+	//All voxels start out empty
+	bit_volume(uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt);
+
+	uint32_t x_cnt() const noexcept { return m_x_cnt; }
+
+	uint32_t y_cnt() const noexcept { return m_y_cnt; }
+
+	uint32_t z_cnt() const noexcept { return m_z_cnt; }
+
+	uint32_t row_words() const noexcept { return occupancy_row_words(m_x_cnt); }
+
+	//All rows back to back, e.g. as dst for pack_bits_rows or simplex_3d_fill_bits
+	uint64_t* data() noexcept { return m_words.data(); }
+
+	const uint64_t* data() const noexcept { return m_words.data(); }
+
+	uint64_t* row(uint32_t y, uint32_t z) noexcept { return m_words.data() + (y + static_cast<size_t>(z) * m_y_cnt) * row_words(); }
+
+	const uint64_t* row(uint32_t y, uint32_t z) const noexcept { return m_words.data() + (y + static_cast<size_t>(z) * m_y_cnt) * row_words(); }
+
+	bool get(uint32_t x, uint32_t y, uint32_t z) const noexcept { return (row(y, z)[x / 64] >> (x % 64)) & 1; }
+
+	void set(uint32_t x, uint32_t y, uint32_t z, bool value) noexcept;
+
+	//Number of set voxels
+	uint64_t popcount() const noexcept;
+
+	size_t memory_bytes() const noexcept { return m_words.size() * sizeof(uint64_t); }
+
+private:
+
+	uint32_t m_x_cnt = 0;
+	uint32_t m_y_cnt = 0;
+	uint32_t m_z_cnt = 0;
+
+	std::vector<uint64_t> m_words;
+};
+
+enum class bit_chunk_state : uint8_t
+{
+	empty,
+	full,
+	mixed,
+};
+
+//Sparse, unbounded binary volume split into 64^3 chunks kept in a hash map keyed by chunk coordinate, as in chunked_volume.
+//Each row of a chunk is a single word, so voxel (x, y, z) of a mixed chunk is bit x of word y + z * 64.
+//Empty chunks are not stored and full chunks are stored without words, so only mixed chunks take up 32 KiB.
+struct chunked_bit_volume
+{
+	static constexpr uint32_t chunk_dim_log2 = 6;
+
+	static constexpr uint32_t chunk_dim = 1 << chunk_dim_log2;
+
+	static constexpr uint32_t chunk_words = chunk_dim * chunk_dim;
+
+	bool get(int32_t x, int32_t y, int32_t z) const noexcept;
+
+	//Splits a full chunk when needed. Chunks that become uniform again are only collapsed by compact
+	void set(int32_t x, int32_t y, int32_t z, bool value);
+
+	//Returns the state of the chunk at coord, setting words to its chunk_words words if it is mixed and to nullptr otherwise
+	bit_chunk_state find_chunk(chunk_coord coord, const uint64_t*& words) const noexcept;
+
+	//Turns the chunk at coord into a mixed chunk holding the same voxels and returns its words. The words stay in place until
+	//the chunk is collapsed or removed, even if other chunks are added
+	uint64_t* mixed_chunk(chunk_coord coord);
+
+	//Replaces the chunk at coord with the chunk_words words at src, storing it without words if they are uniform
+	void set_chunk(chunk_coord coord, const uint64_t* src);
+
+	void set_chunk_uniform(chunk_coord coord, bool value);
+
+	//Collapses the chunk at coord if it is mixed and uniform
+	void collapse_chunk(chunk_coord coord);
+
+	//Coordinates of all stored, i.e. full or mixed, chunks
+	std::vector<chunk_coord> chunk_coords() const;
+
+	//Collapses all mixed chunks that have become uniform
+	void compact();
+
+	void clear() noexcept;
+
+	//Number of set voxels
+	uint64_t popcount() const noexcept;
+
+	size_t stored_chunk_cnt() const noexcept { return m_chunks.size(); }
+
+	size_t mixed_chunk_cnt() const noexcept { return m_mixed_cnt; }
+
+	//Voxel storage plus an estimate of the hash map's own overhead
+	size_t memory_bytes() const noexcept;
+
+private:
+
+	struct chunk
+	{
+		//Null for full chunks
+		std::unique_ptr<uint64_t[]> words;
+	};
+
+	std::unordered_map<chunk_coord, chunk, chunk_coord_hash> m_chunks;
+
+	size_t m_mixed_cnt = 0;
+};
@@ -0,0 +1,320 @@
+#include "och_brick_volume.h"
+
+#include <cstring>
+
+#include "och_bit_ops.h"
+#include "och_simplex_noise.h"
+#include "och_thread_pool.h"
+
+static constexpr size_t cache_line_bytes = 64;
+
+//Spreads the 3 bits of v so that bit i lands on bit 3 * i + axis, i.e. the in-brick Morton contribution of one coordinate
+static uint32_t spread_in_brick(uint32_t v, uint32_t axis) noexcept
+{
+	return ((v & 1) << axis) | (((v >> 1) & 1) << (3 + axis)) | (((v >> 2) & 1) << (6 + axis));
+}
+
+//Morton-interleaves brick coordinates that may have different bit counts per axis. Bits are handed out from the least
+//significant level upwards, skipping axes that have run out of bits, so the codes of a 2^a x 2^b x 2^c grid are dense.
+static void build_brick_parts(uint32_t axis_log2[3], size_t* parts[3], uint32_t brick_cnt[3]) noexcept
+{
+	uint32_t out_bit[3][32]{};
+
+	uint32_t next_bit = 0;
+
+	const uint32_t max_log2 = axis_log2[0] > axis_log2[1] ? (axis_log2[0] > axis_log2[2] ? axis_log2[0] : axis_log2[2]) : (axis_log2[1] > axis_log2[2] ? axis_log2[1] : axis_log2[2]);
+
+	for (uint32_t level = 0; level != max_log2; ++level)
+		for (uint32_t axis = 0; axis != 3; ++axis)
+			if (level < axis_log2[axis])
+				out_bit[axis][level] = next_bit++;
+
+	for (uint32_t axis = 0; axis != 3; ++axis)
+		for (uint32_t b = 0; b != brick_cnt[axis]; ++b)
+		{
+			size_t code = 0;
+
+			for (uint32_t level = 0; level != axis_log2[axis]; ++level)
+				code |= static_cast<size_t>((b >> level) & 1) << out_bit[axis][level];
+
+			parts[axis][b] = code;
+		}
+}
+
+brick_volume::brick_volume(uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt) :
+	m_x_cnt{ (x_cnt + brick_dim - 1) & ~(brick_dim - 1) },
+	m_y_cnt{ (y_cnt + brick_dim - 1) & ~(brick_dim - 1) },
+	m_z_cnt{ (z_cnt + brick_dim - 1) & ~(brick_dim - 1) }
+{
+	uint32_t brick_cnt[3]{ m_x_cnt >> brick_dim_log2, m_y_cnt >> brick_dim_log2, m_z_cnt >> brick_dim_log2 };
+
+	uint32_t axis_log2[3]{ log2_of_pow2(round_up_pow2(brick_cnt[0])), log2_of_pow2(round_up_pow2(brick_cnt[1])), log2_of_pow2(round_up_pow2(brick_cnt[2])) };
+
+	std::unique_ptr<size_t[]> brick_parts[3]{ std::unique_ptr<size_t[]>(new size_t[brick_cnt[0]]), std::unique_ptr<size_t[]>(new size_t[brick_cnt[1]]), std::unique_ptr<size_t[]>(new size_t[brick_cnt[2]]) };
+
+	size_t* parts[3]{ brick_parts[0].get(), brick_parts[1].get(), brick_parts[2].get() };
+
+	build_brick_parts(axis_log2, parts, brick_cnt);
+
+	m_byte_size = (static_cast<size_t>(brick_voxels) << (axis_log2[0] + axis_log2[1] + axis_log2[2]));
+
+	const uint32_t cnts[3]{ m_x_cnt, m_y_cnt, m_z_cnt };
+
+	std::unique_ptr<size_t[]>* offs[3]{ &m_x_off, &m_y_off, &m_z_off };
+
+	for (uint32_t axis = 0; axis != 3; ++axis)
+	{
+		offs[axis]->reset(new size_t[cnts[axis]]);
+
+		for (uint32_t v = 0; v != cnts[axis]; ++v)
+			(*offs[axis])[v] = parts[axis][v >> brick_dim_log2] * brick_voxels + spread_in_brick(v & (brick_dim - 1), axis);
+	}
+
+	m_storage.reset(new uint8_t[m_byte_size + cache_line_bytes - 1]());
+
+	m_data = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(m_storage.get()) + cache_line_bytes - 1) & ~static_cast<uintptr_t>(cache_line_bytes - 1));
+}
+
+void brick_volume::fill_simplex(float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t seed, uint32_t max_threads)
+{
+	const float x_step = x_size / m_x_cnt;
+	const float y_step = y_size / m_y_cnt;
+	const float z_step = z_size / m_z_cnt;
+
+	const uint32_t bx_cnt = m_x_cnt >> brick_dim_log2;
+	const uint32_t by_cnt = m_y_cnt >> brick_dim_log2;
+	const uint32_t bz_cnt = m_z_cnt >> brick_dim_log2;
+
+	//One task per row of bricks along x
+	thread_pool::global().parallel_for(by_cnt * bz_cnt, [&](uint32_t task_idx, uint32_t)
+		{
+			const uint32_t by = task_idx % by_cnt;
+			const uint32_t bz = task_idx / by_cnt;
+
+			alignas(64) uint8_t linear[brick_voxels];
+
+			for (uint32_t bx = 0; bx != bx_cnt; ++bx)
+			{
+				const uint32_t x0 = bx * brick_dim;
+				const uint32_t y0 = by * brick_dim;
+				const uint32_t z0 = bz * brick_dim;
+
+				simplex_3d_fill_uint8(linear, x_beg + x0 * x_step, y_beg + y0 * y_step, z_beg + z0 * z_step, brick_dim * x_step, brick_dim * y_step, brick_dim * z_step, brick_dim, brick_dim, brick_dim, seed);
+
+				uint8_t* brick = m_data + offset(x0, y0, z0);
+
+				for (uint32_t i = 0; i != brick_voxels; ++i)
+					brick[spread_in_brick(i & 7, 0) | spread_in_brick((i >> 3) & 7, 1) | spread_in_brick(i >> 6, 2)] = linear[i];
+			}
+		}, max_threads);
+}
+
+void brick_volume::import_linear(const uint8_t* src, size_t pitch, size_t slice_pitch)
+{
+	for (uint32_t z = 0; z != m_z_cnt; ++z)
+		for (uint32_t y = 0; y != m_y_cnt; ++y)
+		{
+			const uint8_t* row = src + y * pitch + z * slice_pitch;
+
+			const size_t yz_off = m_y_off[y] + m_z_off[z];
+
+			for (uint32_t x = 0; x != m_x_cnt; ++x)
+				m_data[yz_off + m_x_off[x]] = row[x];
+		}
+}
+
+void brick_volume::export_linear(uint8_t* dst, size_t pitch, size_t slice_pitch) const
+{
+	for (uint32_t z = 0; z != m_z_cnt; ++z)
+		for (uint32_t y = 0; y != m_y_cnt; ++y)
+		{
+			uint8_t* row = dst + y * pitch + z * slice_pitch;
+
+			const size_t yz_off = m_y_off[y] + m_z_off[z];
+
+			for (uint32_t x = 0; x != m_x_cnt; ++x)
+				row[x] = m_data[yz_off + m_x_off[x]];
+		}
+}
+
+void brick_volume::get_slice(slice_axis axis, uint32_t idx, uint8_t* dst) const noexcept
+{
+	const size_t* u_off;
+	const size_t* v_off;
+
+	uint32_t u_cnt, v_cnt;
+
+	size_t fixed_off;
+
+	if (axis == slice_axis::z)
+	{
+		u_off = m_x_off.get(), u_cnt = m_x_cnt;
+		v_off = m_y_off.get(), v_cnt = m_y_cnt;
+		fixed_off = m_z_off[idx];
+	}
+	else if (axis == slice_axis::y)
+	{
+		u_off = m_x_off.get(), u_cnt = m_x_cnt;
+		v_off = m_z_off.get(), v_cnt = m_z_cnt;
+		fixed_off = m_y_off[idx];
+	}
+	else
+	{
+		u_off = m_y_off.get(), u_cnt = m_y_cnt;
+		v_off = m_z_off.get(), v_cnt = m_z_cnt;
+		fixed_off = m_x_off[idx];
+	}
+
+	const uint8_t* data = m_data;
+
+	for (uint32_t v = 0; v != v_cnt; ++v)
+	{
+		const uint8_t* base = data + fixed_off + v_off[v];
+
+		uint8_t* out = dst + static_cast<size_t>(v) * u_cnt;
+
+		for (uint32_t u = 0; u != u_cnt; ++u)
+			out[u] = base[u_off[u]];
+	}
+}
+
+void brick_volume::get_slice_region(slice_axis axis, uint32_t idx, uint32_t u_beg, uint32_t v_beg, uint32_t w, uint32_t h, uint8_t* dst, size_t dst_pitch) const noexcept
+{
+	const size_t* u_off = axis == slice_axis::x ? m_y_off.get() : m_x_off.get();
+
+	const size_t* v_off = axis == slice_axis::z ? m_y_off.get() : m_z_off.get();
+
+	const size_t fixed_off = axis == slice_axis::x ? m_x_off[idx] : axis == slice_axis::y ? m_y_off[idx] : m_z_off[idx];
+
+	const uint8_t* data = m_data + fixed_off;
+
+	//End of the tile starting at pos, relative to beg. Tiles are aligned to bricks, so the first and last may be partial
+	const auto tile_end = [](uint32_t beg, uint32_t pos, uint32_t cnt)
+	{
+		const uint32_t brick_end = ((beg + pos) / brick_dim + 1) * brick_dim - beg;
+
+		return brick_end < cnt ? brick_end : cnt;
+	};
+
+	for (uint32_t v0 = 0; v0 != h; v0 = tile_end(v_beg, v0, h))
+	{
+		const uint32_t v1 = tile_end(v_beg, v0, h);
+
+		for (uint32_t u0 = 0; u0 != w; u0 = tile_end(u_beg, u0, w))
+		{
+			const uint32_t u1 = tile_end(u_beg, u0, w);
+
+			for (uint32_t v = v0; v != v1; ++v)
+			{
+				const uint8_t* base = data + v_off[v_beg + v];
+
+				uint8_t* out = dst + v * dst_pitch;
+
+				for (uint32_t u = u0; u != u1; ++u)
+					out[u] = base[u_off[u_beg + u]];
+			}
+		}
+	}
+}
+
+void brick_volume::get_oblique_slice(const slice_plane& plane, uint32_t w, uint32_t h, uint8_t* dst, size_t dst_pitch) const noexcept
+{
+	const int32_t cnt[3]{ static_cast<int32_t>(m_x_cnt), static_cast<int32_t>(m_y_cnt), static_cast<int32_t>(m_z_cnt) };
+
+	const size_t* offs[3]{ m_x_off.get(), m_y_off.get(), m_z_off.get() };
+
+	for (uint32_t v = 0; v != h; ++v)
+	{
+		uint8_t* out = dst + v * dst_pitch;
+
+		for (uint32_t u = 0; u != w; ++u)
+		{
+			int32_t i0[3];
+
+			float f[3];
+
+			//Offsets of the two voxels to either side along each axis, and whether they lie inside the volume
+			size_t off[3][2];
+
+			bool inside[3][2];
+
+			for (uint32_t a = 0; a != 3; ++a)
+			{
+				const float p = plane.origin[a] + plane.u_step[a] * u + plane.v_step[a] * v;
+
+				//Truncation corrected towards -inf, as floorf would be a library call here
+				const int32_t i = static_cast<int32_t>(p);
+
+				i0[a] = p < static_cast<float>(i) ? i - 1 : i;
+
+				f[a] = p - static_cast<float>(i0[a]);
+
+				for (int32_t s = 0; s != 2; ++s)
+				{
+					const int32_t i = i0[a] + s;
+
+					inside[a][s] = i >= 0 && i < cnt[a];
+
+					off[a][s] = inside[a][s] ? offs[a][i] : 0;
+				}
+			}
+
+			float sum = 0.0F;
+
+			for (uint32_t corner = 0; corner != 8; ++corner)
+			{
+				const uint32_t sx = corner & 1, sy = (corner >> 1) & 1, sz = corner >> 2;
+
+				if (!inside[0][sx] || !inside[1][sy] || !inside[2][sz])
+					continue;
+
+				const float weight = (sx ? f[0] : 1.0F - f[0]) * (sy ? f[1] : 1.0F - f[1]) * (sz ? f[2] : 1.0F - f[2]);
+
+				sum += weight * m_data[off[0][sx] + off[1][sy] + off[2][sz]];
+			}
+
+			out[u] = static_cast<uint8_t>(sum + 0.5F);
+		}
+	}
+}
+
+void brick_volume::get_slice(uint8_t* dst, uint32_t z, uint32_t dim) const noexcept
+{
+	const size_t z_off = m_z_off[z];
+
+	for (uint32_t y = 0; y != dim; ++y)
+	{
+		const uint8_t* base = m_data + z_off + m_y_off[y];
+
+		for (uint32_t x = 0; x != dim; ++x)
+			dst[x + static_cast<size_t>(y) * dim] = base[m_x_off[x]];
+	}
+}
+
+void brick_volume::read_region(uint8_t* dst, uint32_t x_beg, uint32_t y_beg, uint32_t z_beg, uint32_t w, uint32_t h, uint32_t d) const noexcept
+{
+	for (uint32_t z = 0; z != d; ++z)
+		for (uint32_t y = 0; y != h; ++y)
+		{
+			const uint8_t* base = m_data + m_z_off[z_beg + z] + m_y_off[y_beg + y];
+
+			uint8_t* out = dst + (static_cast<size_t>(z) * h + y) * w;
+
+			for (uint32_t x = 0; x != w; ++x)
+				out[x] = base[m_x_off[x_beg + x]];
+		}
+}
+
+void brick_volume::write_region(const uint8_t* src, uint32_t x_beg, uint32_t y_beg, uint32_t z_beg, uint32_t w, uint32_t h, uint32_t d) noexcept
+{
+	for (uint32_t z = 0; z != d; ++z)
+		for (uint32_t y = 0; y != h; ++y)
+		{
+			uint8_t* base = m_data + m_z_off[z_beg + z] + m_y_off[y_beg + y];
+
+			const uint8_t* in = src + (static_cast<size_t>(z) * h + y) * w;
+
+			for (uint32_t x = 0; x != w; ++x)
+				base[m_x_off[x_beg + x]] = in[x];
+		}
+}
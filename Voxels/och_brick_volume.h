@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+#include "och_slice_plane.h"
+
+//Dense uint8_t volume stored as 8^3 bricks of 512 bytes instead of x + y * pitch + z * pitch * ysize.
+//Voxels inside a brick and bricks inside the volume are both in Morton (Z-) order, so every aligned 4^3 block is one
+//64-byte cache line and slices along any axis touch the same number of lines. Neighbourhood reads mostly stay inside a
+//brick. Since a Morton offset is the sum of the spread bits of each coordinate, offset(x, y, z) is three table lookups.
+//Dimensions are rounded up to multiples of 8. Brick counts are padded to powers of two per axis for addressing, so
+//power-of-two dimensions waste no memory.
+struct brick_volume
+{
+	static constexpr uint32_t brick_dim_log2 = 3;
+
+	static constexpr uint32_t brick_dim = 1 << brick_dim_log2;
+
+	static constexpr uint32_t brick_voxels = brick_dim * brick_dim * brick_dim;
+
+	brick_volume(uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt);
+
+	uint32_t x_cnt() const noexcept { return m_x_cnt; }
+
+	uint32_t y_cnt() const noexcept { return m_y_cnt; }
+
+	uint32_t z_cnt() const noexcept { return m_z_cnt; }
+
+	size_t byte_size() const noexcept { return m_byte_size; }
+
+	uint8_t* data() noexcept { return m_data; }
+
+	const uint8_t* data() const noexcept { return m_data; }
+
+	size_t offset(uint32_t x, uint32_t y, uint32_t z) const noexcept
+	{
+		return m_x_off[x] + m_y_off[y] + m_z_off[z];
+	}
+
+	uint8_t get(uint32_t x, uint32_t y, uint32_t z) const noexcept
+	{
+		return m_data[offset(x, y, z)];
+	}
+
+	void set(uint32_t x, uint32_t y, uint32_t z, uint8_t value) noexcept
+	{
+		m_data[offset(x, y, z)] = value;
+	}
+
+	//Same mapping as simplex_3d_fill_uint8 over the whole volume, evaluated brick by brick on thread_pool::global()
+	void fill_simplex(float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t seed = 0, uint32_t max_threads = 0);
+
+	//Copies from / to a linear layout with row pitch and slice pitch in bytes, e.g. a cudaPitchedPtr's pitch and pitch * ysize
+	void import_linear(const uint8_t* src, size_t pitch, size_t slice_pitch);
+
+	void export_linear(uint8_t* dst, size_t pitch, size_t slice_pitch) const;
+
+	//Slice at idx along axis. dst[u + v * u_cnt] with (u, v) being (x, y) for z-slices, (x, z) for y-slices and (y, z) for x-slices
+	void get_slice(slice_axis axis, uint32_t idx, uint8_t* dst) const noexcept;
+
+	//Rectangle [u_beg, u_beg + w) x [v_beg, v_beg + h) of the slice at idx along axis, with (u, v) as for get_slice, written to
+	//dst[u + v * dst_pitch]. Walks the rectangle in brick_dim^2 tiles, so every brick is entered once whatever the axis
+	void get_slice_region(slice_axis axis, uint32_t idx, uint32_t u_beg, uint32_t v_beg, uint32_t w, uint32_t h, uint8_t* dst, size_t dst_pitch) const noexcept;
+
+	//w x h samples of plane, trilinearly interpolated, written to dst[u + v * dst_pitch]
+	void get_oblique_slice(const slice_plane& plane, uint32_t w, uint32_t h, uint8_t* dst, size_t dst_pitch) const noexcept;
+
+	//Drop-in for get_slice(dst, z, dim) on the existing linear volume
+	void get_slice(uint8_t* dst, uint32_t z, uint32_t dim) const noexcept;
+
+	//Dense x-major copy of the box [beg, beg + cnt) to / from dst, i.e. dst[x + y * w + z * w * h]
+	void read_region(uint8_t* dst, uint32_t x_beg, uint32_t y_beg, uint32_t z_beg, uint32_t w, uint32_t h, uint32_t d) const noexcept;
+
+	void write_region(const uint8_t* src, uint32_t x_beg, uint32_t y_beg, uint32_t z_beg, uint32_t w, uint32_t h, uint32_t d) noexcept;
+
+private:
+
+	uint32_t m_x_cnt;
+	uint32_t m_y_cnt;
+	uint32_t m_z_cnt;
+
+	size_t m_byte_size;
+
+	std::unique_ptr<size_t[]> m_x_off;
+	std::unique_ptr<size_t[]> m_y_off;
+	std::unique_ptr<size_t[]> m_z_off;
+
+	std::unique_ptr<uint8_t[]> m_storage;
+
+	//m_storage aligned up to a cache line
+	uint8_t* m_data;
+};
@@ -1,7 +1,13 @@
+#pragma once
+
 #include <cstdint>
 
-#include "device_launch_parameters.h"
+#include "och_cuda_compat.cuh"
 
 __global__ void d_uint8_to_bit(cudaPitchedPtr dst, const cudaPitchedPtr src, uint8_t cutoff);
 
 __global__ void d_float_to_bit(cudaPitchedPtr dst, const cudaPitchedPtr src, float cutoff);
+
+cudaError_t launch_uint8_to_bit(dim3 threads_per_block, dim3 blocks_per_grid, cudaPitchedPtr dst, const cudaPitchedPtr src, uint8_t cutoff);
+
+cudaError_t launch_float_to_bit(dim3 threads_per_block, dim3 blocks_per_grid, cudaPitchedPtr dst, const cudaPitchedPtr src, float cutoff);
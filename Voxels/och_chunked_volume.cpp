@@ -0,0 +1,357 @@
+#include "och_chunked_volume.h"
+
+#include <cstring>
+#include <vector>
+
+#include "och_simplex_noise.h"
+#include "och_thread_pool.h"
+
+static constexpr int32_t chunk_mask = static_cast<int32_t>(chunked_volume::chunk_dim) - 1;
+
+static bool is_uniform(const uint8_t* voxels) noexcept
+{
+	const uint8_t first = voxels[0];
+
+	//Compare eight bytes at a time against a broadcast of the first voxel
+	const uint64_t pattern = first * 0x0101'0101'0101'0101ULL;
+
+	for (uint32_t i = 0; i != chunked_volume::chunk_voxels; i += 8)
+	{
+		uint64_t v;
+
+		memcpy(&v, voxels + i, 8);
+
+		if (v != pattern)
+			return false;
+	}
+
+	return true;
+}
+
+chunked_volume::chunked_volume(uint8_t background) : m_background{ background } {}
+
+uint8_t chunked_volume::background() const noexcept
+{
+	return m_background;
+}
+
+size_t chunk_coord_hash::operator()(chunk_coord coord) const noexcept
+{
+	//Folds the three coordinates into one word, then applies Fibonacci-style mixing, so neighbouring chunks do not end up in
+	//neighbouring buckets. Coordinates that share a hash are still told apart by the map's full comparison
+	uint64_t key = static_cast<uint32_t>(coord.x);
+
+	key = key * 0x9E37'79B9'7F4A'7C15ULL + static_cast<uint32_t>(coord.y);
+	key = key * 0x9E37'79B9'7F4A'7C15ULL + static_cast<uint32_t>(coord.z);
+
+	key ^= key >> 31;
+	key *= 0x9E37'79B9'7F4A'7C15ULL;
+	key ^= key >> 29;
+
+	return static_cast<size_t>(key);
+}
+
+const chunked_volume::chunk* chunked_volume::find(chunk_coord coord) const noexcept
+{
+	const auto it = m_chunks.find(coord);
+
+	return it == m_chunks.end() ? nullptr : &it->second;
+}
+
+uint8_t chunked_volume::get(int32_t x, int32_t y, int32_t z) const noexcept
+{
+	const chunk* c = find({ x >> chunk_dim_log2, y >> chunk_dim_log2, z >> chunk_dim_log2 });
+
+	if (!c)
+		return m_background;
+
+	if (!c->voxels)
+		return c->uniform_value;
+
+	return c->voxels[(x & chunk_mask) + (y & chunk_mask) * chunk_dim + (z & chunk_mask) * chunk_dim * chunk_dim];
+}
+
+void chunked_volume::set(int32_t x, int32_t y, int32_t z, uint8_t value)
+{
+	const chunk_coord coord{ x >> chunk_dim_log2, y >> chunk_dim_log2, z >> chunk_dim_log2 };
+
+	auto it = m_chunks.find(coord);
+
+	if (it == m_chunks.end())
+	{
+		if (value == m_background)
+			return;
+
+		it = m_chunks.emplace(coord, chunk{ nullptr, m_background }).first;
+	}
+
+	chunk& c = it->second;
+
+	if (!c.voxels)
+	{
+		if (c.uniform_value == value)
+			return;
+
+		c.voxels.reset(new uint8_t[chunk_voxels]);
+
+		memset(c.voxels.get(), c.uniform_value, chunk_voxels);
+
+		++m_mixed_cnt;
+	}
+
+	c.voxels[(x & chunk_mask) + (y & chunk_mask) * chunk_dim + (z & chunk_mask) * chunk_dim * chunk_dim] = value;
+}
+
+void chunked_volume::set_chunk_uniform(chunk_coord coord, uint8_t value)
+{
+	auto it = m_chunks.find(coord);
+
+	if (it != m_chunks.end())
+	{
+		if (it->second.voxels)
+			--m_mixed_cnt;
+
+		if (value == m_background)
+		{
+			m_chunks.erase(it);
+
+			return;
+		}
+
+		it->second.voxels.reset();
+
+		it->second.uniform_value = value;
+	}
+	else if (value != m_background)
+	{
+		m_chunks.emplace(coord, chunk{ nullptr, value });
+	}
+}
+
+void chunked_volume::set_chunk(chunk_coord coord, const uint8_t* src)
+{
+	if (is_uniform(src))
+	{
+		set_chunk_uniform(coord, src[0]);
+
+		return;
+	}
+
+	chunk& c = m_chunks[coord];
+
+	if (!c.voxels)
+	{
+		c.voxels.reset(new uint8_t[chunk_voxels]);
+
+		++m_mixed_cnt;
+	}
+
+	memcpy(c.voxels.get(), src, chunk_voxels);
+}
+
+void chunked_volume::get_chunk(chunk_coord coord, uint8_t* dst) const noexcept
+{
+	const chunk* c = find(coord);
+
+	if (!c)
+		memset(dst, m_background, chunk_voxels);
+	else if (!c->voxels)
+		memset(dst, c->uniform_value, chunk_voxels);
+	else
+		memcpy(dst, c->voxels.get(), chunk_voxels);
+}
+
+void chunked_volume::generate(chunk_coord beg, chunk_coord cnt, const generate_fn& fn, uint32_t max_threads)
+{
+	const uint32_t task_cnt = static_cast<uint32_t>(cnt.x) * static_cast<uint32_t>(cnt.y) * static_cast<uint32_t>(cnt.z);
+
+	//Chunks are generated in parallel and inserted afterwards, as the map itself is not thread-safe
+	std::vector<chunk> generated(task_cnt);
+
+	thread_pool::global().parallel_for(task_cnt, [&](uint32_t task_idx, uint32_t)
+		{
+			const chunk_coord coord{
+				beg.x + static_cast<int32_t>(task_idx % cnt.x),
+				beg.y + static_cast<int32_t>(task_idx / cnt.x % cnt.y),
+				beg.z + static_cast<int32_t>(task_idx / cnt.x / cnt.y) };
+
+			std::unique_ptr<uint8_t[]> voxels(new uint8_t[chunk_voxels]);
+
+			fn(coord, voxels.get());
+
+			generated[task_idx].uniform_value = voxels[0];
+
+			if (!is_uniform(voxels.get()))
+				generated[task_idx].voxels = std::move(voxels);
+		}, max_threads);
+
+	for (uint32_t i = 0; i != task_cnt; ++i)
+	{
+		const chunk_coord coord{
+			beg.x + static_cast<int32_t>(i % cnt.x),
+			beg.y + static_cast<int32_t>(i / cnt.x % cnt.y),
+			beg.z + static_cast<int32_t>(i / cnt.x / cnt.y) };
+
+		if (!generated[i].voxels)
+		{
+			set_chunk_uniform(coord, generated[i].uniform_value);
+
+			continue;
+		}
+
+		chunk& c = m_chunks[coord];
+
+		if (!c.voxels)
+			++m_mixed_cnt;
+
+		c = std::move(generated[i]);
+	}
+}
+
+void chunked_volume::generate_terrain(chunk_coord beg, chunk_coord cnt, float noise_scale, float ground_z, float falloff, uint32_t seed, uint32_t max_threads)
+{
+	generate(beg, cnt, [=](chunk_coord coord, uint8_t* dst)
+		{
+			const float z_lo = static_cast<float>(coord.z * static_cast<int32_t>(chunk_dim));
+
+			const float z_hi = z_lo + static_cast<float>(chunk_dim - 1);
+
+			//Noise lies in [-1, 1], so a bias of at least 2 saturates every voxel of the chunk either way
+			if ((ground_z - z_hi) / falloff >= 2.0F)
+			{
+				memset(dst, 255, chunk_voxels);
+
+				return;
+			}
+
+			if ((ground_z - z_lo) / falloff <= -2.0F)
+			{
+				memset(dst, 0, chunk_voxels);
+
+				return;
+			}
+
+			std::vector<float> noise(chunk_voxels);
+
+			const float span = chunk_dim * noise_scale;
+
+			simplex_3d_fill(noise.data(), coord.x * span, coord.y * span, coord.z * span, span, span, span, chunk_dim, chunk_dim, chunk_dim, seed);
+
+			for (uint32_t z = 0; z != chunk_dim; ++z)
+			{
+				const float bias = (ground_z - (z_lo + z)) / falloff;
+
+				const uint32_t slab = z * chunk_dim * chunk_dim;
+
+				for (uint32_t i = 0; i != chunk_dim * chunk_dim; ++i)
+				{
+					float v = (noise[slab + i] + bias) * 128.0F + 128.0F;
+
+					v = v < 0.0F ? 0.0F : v > 255.0F ? 255.0F : v;
+
+					dst[slab + i] = static_cast<uint8_t>(v);
+				}
+			}
+		}, max_threads);
+}
+
+void chunked_volume::get_slice(uint8_t* dst, int32_t x_beg, int32_t y_beg, int32_t z, uint32_t w, uint32_t h) const noexcept
+{
+	const int32_t cz = z >> chunk_dim_log2;
+
+	const uint32_t lz = static_cast<uint32_t>(z & chunk_mask);
+
+	//Walk the slice one chunk-sized tile at a time, so each chunk is looked up once
+	for (uint32_t ty = 0; ty < h;)
+	{
+		const int32_t y = y_beg + static_cast<int32_t>(ty);
+
+		const uint32_t ly = static_cast<uint32_t>(y & chunk_mask);
+
+		const uint32_t rows = chunk_dim - ly < h - ty ? chunk_dim - ly : h - ty;
+
+		for (uint32_t tx = 0; tx < w;)
+		{
+			const int32_t x = x_beg + static_cast<int32_t>(tx);
+
+			const uint32_t lx = static_cast<uint32_t>(x & chunk_mask);
+
+			const uint32_t cols = chunk_dim - lx < w - tx ? chunk_dim - lx : w - tx;
+
+			const chunk* c = find({ x >> chunk_dim_log2, y >> chunk_dim_log2, cz });
+
+			uint8_t* out = dst + tx + static_cast<size_t>(ty) * w;
+
+			if (c && c->voxels)
+			{
+				const uint8_t* in = c->voxels.get() + lx + ly * chunk_dim + lz * chunk_dim * chunk_dim;
+
+				for (uint32_t r = 0; r != rows; ++r)
+					memcpy(out + static_cast<size_t>(r) * w, in + r * chunk_dim, cols);
+			}
+			else
+			{
+				const uint8_t value = c ? c->uniform_value : m_background;
+
+				for (uint32_t r = 0; r != rows; ++r)
+					memset(out + static_cast<size_t>(r) * w, value, cols);
+			}
+
+			tx += cols;
+		}
+
+		ty += rows;
+	}
+}
+
+void chunked_volume::get_slice(uint8_t* dst, uint32_t z, uint32_t dim) const noexcept
+{
+	get_slice(dst, 0, 0, static_cast<int32_t>(z), dim, dim);
+}
+
+void chunked_volume::compact()
+{
+	for (auto it = m_chunks.begin(); it != m_chunks.end();)
+	{
+		chunk& c = it->second;
+
+		if (c.voxels && is_uniform(c.voxels.get()))
+		{
+			c.uniform_value = c.voxels[0];
+
+			c.voxels.reset();
+
+			--m_mixed_cnt;
+		}
+
+		if (!c.voxels && c.uniform_value == m_background)
+			it = m_chunks.erase(it);
+		else
+			++it;
+	}
+}
+
+void chunked_volume::clear() noexcept
+{
+	m_chunks.clear();
+
+	m_mixed_cnt = 0;
+}
+
+size_t chunked_volume::stored_chunk_cnt() const noexcept
+{
+	return m_chunks.size();
+}
+
+size_t chunked_volume::mixed_chunk_cnt() const noexcept
+{
+	return m_mixed_cnt;
+}
+
+size_t chunked_volume::memory_bytes() const noexcept
+{
+	//Bucket array plus one heap node (next pointer, cached hash, key, chunk) per stored chunk
+	constexpr size_t node_bytes = sizeof(void*) + sizeof(size_t) + sizeof(chunk_coord) + sizeof(chunk);
+
+	return sizeof(*this) + m_chunks.bucket_count() * sizeof(void*) + m_chunks.size() * node_bytes + m_mixed_cnt * chunk_voxels;
+}
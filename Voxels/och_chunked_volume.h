@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+struct chunk_coord
+{
+	int32_t x, y, z;
+
+	bool operator==(const chunk_coord& rhs) const noexcept { return x == rhs.x && y == rhs.y && z == rhs.z; }
+};
+
+//Hashes all 96 bits of a chunk_coord, so maps keyed by it are exact over the whole int32 range of chunk coordinates
+struct chunk_coord_hash
+{
+	size_t operator()(chunk_coord coord) const noexcept;
+};
+
+//Sparse, unbounded volume of uint8_t densities, split into 32^3 chunks kept in a hash map keyed by chunk coordinate.
+//Chunks in which every voxel has the same value are stored as that single value, and chunks equal to the background
+//value are not stored at all. Only mixed chunks get a full 32 KiB allocation, so memory grows with the surface of a
+//world rather than with its volume. Chunk voxels are x-major, i.e. x + y * 32 + z * 32 * 32.
+struct chunked_volume
+{
+	static constexpr uint32_t chunk_dim_log2 = 5;
+
+	static constexpr uint32_t chunk_dim = 1 << chunk_dim_log2;
+
+	static constexpr uint32_t chunk_voxels = chunk_dim * chunk_dim * chunk_dim;
+
+	//Fills the chunk at coord. dst has chunk_voxels entries and is uninitialized
+	using generate_fn = std::function<void(chunk_coord coord, uint8_t* dst)>;
+
+	explicit chunked_volume(uint8_t background = 0);
+
+	uint8_t background() const noexcept;
+
+	uint8_t get(int32_t x, int32_t y, int32_t z) const noexcept;
+
+	//Splits a uniform chunk when needed. Chunks that become uniform again are only collapsed by compact
+	void set(int32_t x, int32_t y, int32_t z, uint8_t value);
+
+	//Replaces the chunk at coord with the chunk_voxels values at src, storing it as a single value if they are all equal
+	void set_chunk(chunk_coord coord, const uint8_t* src);
+
+	void set_chunk_uniform(chunk_coord coord, uint8_t value);
+
+	//Copies the chunk at coord to dst, which has chunk_voxels entries
+	void get_chunk(chunk_coord coord, uint8_t* dst) const noexcept;
+
+	//Calls fn for every chunk in [beg, beg + cnt) on thread_pool::global() and stores the results
+	void generate(chunk_coord beg, chunk_coord cnt, const generate_fn& fn, uint32_t max_threads = 0);
+
+	//Terrain with its ground at height ground_z: density is simplex noise plus (ground_z - z) / falloff, mapped to [0, 255]
+	//as in simplex_3d_fill_uint8. Chunks further than 2 * falloff from ground_z are uniform air (0) or rock (255) and skip the noise.
+	void generate_terrain(chunk_coord beg, chunk_coord cnt, float noise_scale, float ground_z, float falloff, uint32_t seed = 0, uint32_t max_threads = 0);
+
+	//Same layout as get_slice: dst[x + y * w] = voxel (x_beg + x, y_beg + y, z)
+	void get_slice(uint8_t* dst, int32_t x_beg, int32_t y_beg, int32_t z, uint32_t w, uint32_t h) const noexcept;
+
+	//Drop-in for get_slice(dst, z, dim), reading [0, dim)^2 at z
+	void get_slice(uint8_t* dst, uint32_t z, uint32_t dim) const noexcept;
+
+	//Collapses mixed chunks that have become uniform and drops chunks equal to the background
+	void compact();
+
+	void clear() noexcept;
+
+	size_t stored_chunk_cnt() const noexcept;
+
+	size_t mixed_chunk_cnt() const noexcept;
+
+	//Voxel storage plus an estimate of the hash map's own overhead
+	size_t memory_bytes() const noexcept;
+
+private:
+
+	struct chunk
+	{
+		std::unique_ptr<uint8_t[]> voxels;
+
+		uint8_t uniform_value;
+	};
+
+	const chunk* find(chunk_coord coord) const noexcept;
+
+	std::unordered_map<chunk_coord, chunk, chunk_coord_hash> m_chunks;
+
+	size_t m_mixed_cnt = 0;
+
+	uint8_t m_background;
+};
@@ -0,0 +1,400 @@
+#include "och_components.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "och_thread_pool.h"
+#include "och_trace.h"
+
+//Slabs per participating thread, so that threads finishing early can steal the slabs of others
+static constexpr uint32_t slabs_per_thread = 4;
+
+//Voxels [x_beg, x_end) of one row
+struct ccl_run
+{
+	uint32_t x_beg;
+	uint32_t x_end;
+};
+
+struct ccl_slab
+{
+	uint32_t z_beg;
+	uint32_t z_end;
+
+	//Index of the slab's first run among the runs of all slabs
+	uint32_t base;
+
+	std::vector<ccl_run> runs;
+
+	//Runs of row (y, z) are runs[row_offsets[r]] to runs[row_offsets[r + 1]], r being y + (z - z_beg) * y_cnt
+	std::vector<uint32_t> row_offsets;
+
+	//Union-find forest over runs, holding local run indices
+	std::vector<uint32_t> parent;
+};
+
+//A row that a run can touch, at (y + dy, z + dz), and by how many voxels the runs of that row are widened for the overlap test.
+//Widening by one also connects runs whose ends are only diagonally adjacent
+struct ccl_neighbour
+{
+	int32_t dy;
+	int32_t dz;
+	uint32_t widen;
+};
+
+//Neighbouring rows that come earlier in x-major order. Neighbours within the same row are part of the same run
+static uint32_t earlier_neighbours(ccl_connectivity connectivity, ccl_neighbour* out) noexcept
+{
+	switch (connectivity)
+	{
+	case ccl_connectivity::face:
+		out[0] = { -1,  0, 0 };
+		out[1] = {  0, -1, 0 };
+		return 2;
+
+	case ccl_connectivity::edge:
+		out[0] = { -1,  0, 1 };
+		out[1] = {  0, -1, 1 };
+		out[2] = { -1, -1, 0 };
+		out[3] = {  1, -1, 0 };
+		return 4;
+
+	default:
+		out[0] = { -1,  0, 1 };
+		out[1] = {  0, -1, 1 };
+		out[2] = { -1, -1, 1 };
+		out[3] = {  1, -1, 1 };
+		return 4;
+	}
+}
+
+//Appends the runs of set bits of row ^ invert to runs. Transitions between set and clear bits are found a word at a time
+static void extract_runs(std::vector<ccl_run>& runs, const uint64_t* row, uint32_t row_words, uint32_t x_cnt, uint64_t invert, uint64_t tail_mask)
+{
+	uint64_t carry = 0;
+
+	uint32_t run_beg = 0;
+
+	for (uint32_t w = 0; w != row_words; ++w)
+	{
+		uint64_t v = row[w] ^ invert;
+
+		if (w + 1 == row_words)
+			v &= tail_mask;
+
+		uint64_t transitions = v ^ ((v << 1) | carry);
+
+		carry = v >> 63;
+
+		while (transitions)
+		{
+			const uint32_t x = w * 64 + ctz64(transitions);
+
+			if ((v >> (x & 63)) & 1)
+				run_beg = x;
+			else
+				runs.push_back({ run_beg, x });
+
+			transitions &= transitions - 1;
+		}
+	}
+
+	//Rows ending in a set bit have no transition after it
+	if (carry)
+		runs.push_back({ run_beg, x_cnt });
+}
+
+//Calls unite(i, j) for every pair of a run a[i] and a run b[j] that touch, the runs of b being widened by widen.
+//Both rows are sorted, so one sweep suffices
+template<typename Unite_fn>
+static void connect_rows(const ccl_run* a, uint32_t a_cnt, const ccl_run* b, uint32_t b_cnt, uint32_t widen, Unite_fn&& unite)
+{
+	uint32_t i = 0, j = 0;
+
+	while (i != a_cnt && j != b_cnt)
+	{
+		if (a[i].x_beg < b[j].x_end + widen && b[j].x_beg < a[i].x_end + widen)
+			unite(i, j);
+
+		//On a tie, a[i] may still touch b[j + 1] once widened, while a[i + 1] cannot touch b[j]
+		if (a[i].x_end < b[j].x_end + widen)
+			++i;
+		else
+			++j;
+	}
+}
+
+static uint32_t find_local(std::vector<uint32_t>& parent, uint32_t i) noexcept
+{
+	while (parent[i] != i)
+	{
+		parent[i] = parent[parent[i]];
+
+		i = parent[i];
+	}
+
+	return i;
+}
+
+//Links the larger root below the smaller, so the root of every set is its smallest index
+static void unite_local(std::vector<uint32_t>& parent, uint32_t a, uint32_t b) noexcept
+{
+	a = find_local(parent, a);
+	b = find_local(parent, b);
+
+	if (a < b)
+		parent[b] = a;
+	else if (b < a)
+		parent[a] = b;
+}
+
+//Path halving with compare-exchange. Concurrent unions only ever move a parent closer to its root, so a failed exchange
+//just means another thread already shortened the path
+static uint32_t find_global(std::atomic<uint32_t>* parent, uint32_t i) noexcept
+{
+	while (true)
+	{
+		uint32_t p = parent[i].load(std::memory_order_relaxed);
+
+		if (p == i)
+			return i;
+
+		const uint32_t gp = parent[p].load(std::memory_order_relaxed);
+
+		if (gp != p)
+			parent[i].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+
+		i = gp;
+	}
+}
+
+//Lock-free union, linking the larger root below the smaller. Retries if the larger root got linked elsewhere in the meantime
+static void unite_global(std::atomic<uint32_t>* parent, uint32_t a, uint32_t b) noexcept
+{
+	while (true)
+	{
+		a = find_global(parent, a);
+		b = find_global(parent, b);
+
+		if (a == b)
+			return;
+
+		if (a < b)
+			std::swap(a, b);
+
+		uint32_t expected = a;
+
+		if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+			return;
+	}
+}
+
+void label_components(ccl_result& result, const bit_volume& volume, ccl_connectivity connectivity, bool label_empty, uint32_t max_threads)
+{
+	OCH_TRACE_SCOPE("label_components", { "voxels", static_cast<uint64_t>(volume.x_cnt()) * volume.y_cnt() * volume.z_cnt() }, { "connectivity", static_cast<uint32_t>(connectivity) }, { "label_empty", label_empty });
+
+	const uint32_t x_cnt = volume.x_cnt();
+	const uint32_t y_cnt = volume.y_cnt();
+	const uint32_t z_cnt = volume.z_cnt();
+
+	const uint32_t row_words = volume.row_words();
+
+	const uint64_t invert = label_empty ? ~0ULL : 0;
+
+	const uint64_t tail_mask = x_cnt % 64 ? (1ULL << (x_cnt % 64)) - 1 : ~0ULL;
+
+	//Every label is written below, so a buffer of the right size from an earlier call is reused as is
+	result.labels.resize(static_cast<size_t>(x_cnt) * y_cnt * z_cnt);
+
+	result.components.clear();
+
+	if (result.labels.empty())
+		return;
+
+	ccl_neighbour neighbours[4];
+
+	const uint32_t neighbour_cnt = earlier_neighbours(connectivity, neighbours);
+
+	thread_pool& pool = thread_pool::global();
+
+	const uint32_t thread_cnt = max_threads == 0 || max_threads > pool.thread_cnt() ? pool.thread_cnt() : max_threads;
+
+	const uint32_t slab_cnt = std::min(z_cnt, thread_cnt * slabs_per_thread);
+
+	const uint32_t slab_slices = (z_cnt + slab_cnt - 1) / slab_cnt;
+
+	std::vector<ccl_slab> slabs((z_cnt + slab_slices - 1) / slab_slices);
+
+	//Runs of every slab, connected within the slab
+
+	pool.parallel_for(static_cast<uint32_t>(slabs.size()), [&](uint32_t s, uint32_t)
+		{
+			ccl_slab& slab = slabs[s];
+
+			slab.z_beg = s * slab_slices;
+			slab.z_end = std::min(z_cnt, slab.z_beg + slab_slices);
+
+			slab.row_offsets.resize(static_cast<size_t>(slab.z_end - slab.z_beg) * y_cnt + 1);
+
+			slab.row_offsets[0] = 0;
+
+			for (uint32_t z = slab.z_beg; z != slab.z_end; ++z)
+				for (uint32_t y = 0; y != y_cnt; ++y)
+				{
+					const size_t r = y + static_cast<size_t>(z - slab.z_beg) * y_cnt;
+
+					extract_runs(slab.runs, volume.row(y, z), row_words, x_cnt, invert, tail_mask);
+
+					const uint32_t row_beg = slab.row_offsets[r];
+					const uint32_t row_end = static_cast<uint32_t>(slab.runs.size());
+
+					slab.row_offsets[r + 1] = row_end;
+
+					for (uint32_t i = row_beg; i != row_end; ++i)
+						slab.parent.push_back(i);
+
+					for (uint32_t n = 0; n != neighbour_cnt; ++n)
+					{
+						const int64_t ny = static_cast<int64_t>(y) + neighbours[n].dy;
+						const int64_t nz = static_cast<int64_t>(z) + neighbours[n].dz;
+
+						if (ny < 0 || ny >= y_cnt || nz < slab.z_beg)
+							continue;
+
+						const size_t nr = static_cast<size_t>(ny) + static_cast<size_t>(nz - slab.z_beg) * y_cnt;
+
+						const uint32_t n_beg = slab.row_offsets[nr];
+
+						connect_rows(slab.runs.data() + row_beg, row_end - row_beg, slab.runs.data() + n_beg, slab.row_offsets[nr + 1] - n_beg, neighbours[n].widen, [&](uint32_t i, uint32_t j)
+							{
+								unite_local(slab.parent, row_beg + i, n_beg + j);
+							});
+					}
+				}
+		}, max_threads);
+
+	//One forest over the runs of all slabs
+
+	uint32_t total_runs = 0;
+
+	for (ccl_slab& slab : slabs)
+	{
+		slab.base = total_runs;
+
+		total_runs += static_cast<uint32_t>(slab.runs.size());
+	}
+
+	const std::unique_ptr<std::atomic<uint32_t>[]> parent(new std::atomic<uint32_t>[total_runs]);
+
+	pool.parallel_for(static_cast<uint32_t>(slabs.size()), [&](uint32_t s, uint32_t)
+		{
+			ccl_slab& slab = slabs[s];
+
+			for (uint32_t i = 0; i != slab.runs.size(); ++i)
+				parent[slab.base + i].store(slab.base + find_local(slab.parent, i), std::memory_order_relaxed);
+
+			slab.parent = std::vector<uint32_t>();
+		}, max_threads);
+
+	//Runs touching across the border between slab s - 1 and slab s
+
+	pool.parallel_for(static_cast<uint32_t>(slabs.size() - 1), [&](uint32_t task_idx, uint32_t)
+		{
+			const ccl_slab& below = slabs[task_idx];
+			const ccl_slab& above = slabs[task_idx + 1];
+
+			const size_t below_slice = static_cast<size_t>(below.z_end - 1 - below.z_beg) * y_cnt;
+
+			for (uint32_t y = 0; y != y_cnt; ++y)
+			{
+				const uint32_t row_beg = above.row_offsets[y];
+				const uint32_t row_end = above.row_offsets[y + 1];
+
+				for (uint32_t n = 0; n != neighbour_cnt; ++n)
+				{
+					const int64_t ny = static_cast<int64_t>(y) + neighbours[n].dy;
+
+					if (neighbours[n].dz != -1 || ny < 0 || ny >= y_cnt)
+						continue;
+
+					const uint32_t n_beg = below.row_offsets[below_slice + ny];
+					const uint32_t n_end = below.row_offsets[below_slice + ny + 1];
+
+					connect_rows(above.runs.data() + row_beg, row_end - row_beg, below.runs.data() + n_beg, n_end - n_beg, neighbours[n].widen, [&](uint32_t i, uint32_t j)
+						{
+							unite_global(parent.get(), above.base + row_beg + i, below.base + n_beg + j);
+						});
+				}
+			}
+		}, max_threads);
+
+	//Component labels and statistics. Roots are the smallest index of their set, so they are numbered before their members
+
+	std::vector<uint32_t> run_labels(total_runs);
+
+	for (const ccl_slab& slab : slabs)
+		for (uint32_t z = slab.z_beg; z != slab.z_end; ++z)
+			for (uint32_t y = 0; y != y_cnt; ++y)
+			{
+				const size_t r = y + static_cast<size_t>(z - slab.z_beg) * y_cnt;
+
+				for (uint32_t i = slab.row_offsets[r]; i != slab.row_offsets[r + 1]; ++i)
+				{
+					const uint32_t run_idx = slab.base + i;
+
+					const uint32_t root = find_global(parent.get(), run_idx);
+
+					const ccl_run& run = slab.runs[i];
+
+					if (root == run_idx)
+					{
+						result.components.push_back({ 0, { run.x_beg, y, z }, { run.x_end - 1, y, z } });
+
+						run_labels[run_idx] = static_cast<uint32_t>(result.components.size());
+					}
+					else
+					{
+						run_labels[run_idx] = run_labels[root];
+					}
+
+					ccl_component& c = result.components[run_labels[run_idx] - 1];
+
+					c.voxel_cnt += run.x_end - run.x_beg;
+
+					c.min[0] = std::min(c.min[0], run.x_beg);
+					c.max[0] = std::max(c.max[0], run.x_end - 1);
+					c.min[1] = std::min(c.min[1], y);
+					c.max[1] = std::max(c.max[1], y);
+					c.max[2] = z;
+				}
+			}
+
+	//Label volume
+
+	pool.parallel_for(static_cast<uint32_t>(slabs.size()), [&](uint32_t s, uint32_t)
+		{
+			const ccl_slab& slab = slabs[s];
+
+			for (uint32_t z = slab.z_beg; z != slab.z_end; ++z)
+				for (uint32_t y = 0; y != y_cnt; ++y)
+				{
+					const size_t r = y + static_cast<size_t>(z - slab.z_beg) * y_cnt;
+
+					uint32_t* const dst = result.labels.data() + (y + static_cast<size_t>(z) * y_cnt) * x_cnt;
+
+					uint32_t x = 0;
+
+					for (uint32_t i = slab.row_offsets[r]; i != slab.row_offsets[r + 1]; ++i)
+					{
+						std::fill(dst + x, dst + slab.runs[i].x_beg, 0);
+
+						std::fill(dst + slab.runs[i].x_beg, dst + slab.runs[i].x_end, run_labels[slab.base + i]);
+
+						x = slab.runs[i].x_end;
+					}
+
+					std::fill(dst + x, dst + x_cnt, 0);
+				}
+		}, max_threads);
+}
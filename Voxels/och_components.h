@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "och_bit_volume.h"
+
+enum class ccl_connectivity : uint8_t
+{
+	face = 6,		//Voxels sharing a face
+	edge = 18,		//Voxels sharing a face or an edge
+	vertex = 26,	//Voxels sharing a face, an edge or a corner
+};
+
+struct ccl_component
+{
+	uint64_t voxel_cnt;
+
+	//Inclusive bounding box
+	uint32_t min[3];
+	uint32_t max[3];
+};
+
+struct ccl_result
+{
+	//One label per voxel, x-major as in the source volume. 0 marks voxels that are not labelled, component l has label l
+	std::vector<uint32_t> labels;
+
+	//components[l - 1] describes the component with label l
+	std::vector<ccl_component> components;
+
+	uint32_t label(uint32_t x, uint32_t y, uint32_t z, uint32_t x_cnt, uint32_t y_cnt) const noexcept
+	{
+		return labels[x + (y + static_cast<size_t>(z) * y_cnt) * x_cnt];
+	}
+};
+
+//Labels the connected components of the occupied voxels of volume, or of the empty ones if label_empty is set.
+//Floating islands are the occupied components whose bounding box does not reach the ground; sealed caves are the empty
+//components whose bounding box does not reach the border of the volume.
+//Every row is split into runs of equal voxels with bit scans, so the work grows with the number of runs rather than voxels.
+//The volume is cut into slabs of slices that are labelled in parallel, each with its own union-find over its runs.
+//The slabs' forests are then joined into one over all runs, and runs touching across slab borders are merged in parallel
+//with lock-free unions. Roots are always the run that comes first in x-major order, so components are numbered by their
+//first voxel in that order, independent of the number of threads. Threads come from thread_pool::global(), max_threads
+//capping their number (0 meaning no cap).
+void label_components(ccl_result& result, const bit_volume& volume, ccl_connectivity connectivity = ccl_connectivity::face, bool label_empty = false, uint32_t max_threads = 0);
@@ -0,0 +1,111 @@
+#include "och_cpu_features.h"
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t (&regs)[4]) noexcept
+{
+#ifdef _MSC_VER
+	int raw[4];
+
+	__cpuidex(raw, static_cast<int>(leaf), static_cast<int>(subleaf));
+
+	for (int i = 0; i != 4; ++i)
+		regs[i] = static_cast<uint32_t>(raw[i]);
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t xgetbv0() noexcept
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32_t lo, hi;
+
+	__asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+
+	return static_cast<uint64_t>(hi) << 32 | lo;
+#endif
+}
+
+static simd_tier query_simd_tier() noexcept
+{
+	uint32_t regs[4];
+
+	cpuid(0, 0, regs);
+
+	const uint32_t max_leaf = regs[0];
+
+	if (max_leaf < 1)
+		return simd_tier::scalar;
+
+	cpuid(1, 0, regs);
+
+	const uint32_t ecx1 = regs[2];
+
+	if (!(ecx1 & (1 << 19)))		//SSE4.1
+		return simd_tier::scalar;
+
+	//AVX needs OSXSAVE and the OS saving XMM and YMM state
+	const bool has_osxsave = ecx1 & (1 << 27);
+	const bool has_avx     = ecx1 & (1 << 28);
+	const bool has_fma     = ecx1 & (1 << 12);
+
+	if (!has_osxsave || !has_avx || !has_fma || max_leaf < 7)
+		return simd_tier::sse4;
+
+	const uint64_t xcr0 = xgetbv0();
+
+	if ((xcr0 & 0x06) != 0x06)
+		return simd_tier::sse4;
+
+	cpuid(7, 0, regs);
+
+	const uint32_t ebx7 = regs[1];
+
+	if (!(ebx7 & (1 << 5)))			//AVX2
+		return simd_tier::sse4;
+
+	//F, DQ, CD, BW, VL, as all of these may be emitted when compiling for AVX-512
+	constexpr uint32_t avx512_bits = (1u << 16) | (1u << 17) | (1u << 28) | (1u << 30) | (1u << 31);
+
+	//Opmask, upper halves of ZMM0-15 and ZMM16-31 must be saved by the OS
+	if ((ebx7 & avx512_bits) != avx512_bits || (xcr0 & 0xE0) != 0xE0)
+		return simd_tier::avx2;
+
+	return simd_tier::avx512;
+}
+
+simd_tier detect_simd_tier() noexcept
+{
+	static const simd_tier tier = query_simd_tier();
+
+	return tier;
+}
+
+simd_tier clamp_simd_tier(simd_tier tier) noexcept
+{
+	const simd_tier supported = detect_simd_tier();
+
+	return static_cast<uint8_t>(tier) > static_cast<uint8_t>(supported) ? supported : tier;
+}
+
+const char* simd_tier_name(simd_tier tier) noexcept
+{
+	switch (tier)
+	{
+	case simd_tier::scalar: return "scalar";
+	case simd_tier::sse4:   return "sse4";
+	case simd_tier::avx2:   return "avx2";
+	case simd_tier::avx512: return "avx512";
+	}
+
+	return "unknown";
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+//Instruction set tiers for which SIMD kernels exist, ordered by vector width
+enum class simd_tier : uint8_t
+{
+	scalar = 0,
+	sse4   = 1,	//SSE4.1, 4 lanes
+	avx2   = 2,	//AVX2 + FMA, 8 lanes
+	avx512 = 3,	//AVX-512 F/CD/BW/DQ/VL, 16 lanes
+};
+
+//Inlining of the small helpers of the SIMD kernels, which compilers may otherwise keep out of line
+#ifdef _MSC_VER
+#define OCH_SIMD_INLINE __forceinline
+#else
+#define OCH_SIMD_INLINE inline __attribute__((always_inline))
+#endif
+
+//Widest tier supported by both the CPU and the OS (checked via CPUID and XGETBV). The result is computed once and cached.
+simd_tier detect_simd_tier() noexcept;
+
+//Lowers a tier the CPU cannot run to detect_simd_tier() and returns supported tiers unchanged.
+//The force_tier functions of the SIMD modules pass the requested tier through this.
+simd_tier clamp_simd_tier(simd_tier tier) noexcept;
+
+const char* simd_tier_name(simd_tier tier) noexcept;
@@ -0,0 +1,366 @@
+#include "och_cpu_raymarch.h"
+
+#include <atomic>
+#include <cmath>
+
+#include "och_cpu_raymarch_backends.h"
+
+#include "och_thread_pool.h"
+#include "och_trace.h"
+
+static constexpr float no_hit_inv = 1e30F;
+
+//Brightness of a face by the axis it was entered through and whether the ray travelled in the negative direction.
+//Light comes from above and slightly from +x
+static constexpr float face_light[3][2]{ { 0.55F, 0.75F }, { 0.6F, 0.65F }, { 0.35F, 1.0F } };
+
+static uint32_t pack_argb(float r, float g, float b) noexcept
+{
+	const uint32_t r8 = static_cast<uint32_t>(r * 255.0F);
+	const uint32_t g8 = static_cast<uint32_t>(g * 255.0F);
+	const uint32_t b8 = static_cast<uint32_t>(b * 255.0F);
+
+	return 0xFF000000 | (r8 << 16) | (g8 << 8) | b8;
+}
+
+static void sky_colour(const float dir[3], float& r, float& g, float& b) noexcept
+{
+	const float up = dir[2] < 0.0F ? 0.0F : dir[2];
+
+	r = 0.6F - 0.3F * up;
+	g = 0.75F - 0.25F * up;
+	b = 0.95F;
+}
+
+static uint32_t shade(const occupancy_pyramid& volume, const float dir[3], bool is_hit, const raymarch_hit& hit) noexcept
+{
+	float sky_r, sky_g, sky_b;
+
+	sky_colour(dir, sky_r, sky_g, sky_b);
+
+	if (!is_hit)
+		return pack_argb(sky_r, sky_g, sky_b);
+
+	const float dim = static_cast<float>(volume.dim());
+
+	const float height = static_cast<float>(hit.z) / dim;
+
+	const float density = static_cast<float>(volume.density(hit.x, hit.y, hit.z)) * (1.0F / 255.0F);
+
+	const float light = face_light[hit.axis][dir[hit.axis] < 0.0F] * (0.75F + 0.25F * density);
+
+	//Linear fog over the volume's diagonal
+	float fog = hit.t / (dim * 1.7F);
+
+	if (fog > 1.0F)
+		fog = 1.0F;
+
+	const float r = (0.35F + 0.4F * height) * light;
+	const float g = (0.5F + 0.3F * height) * light;
+	const float b = (0.25F + 0.5F * height) * light;
+
+	return pack_argb(r + (sky_r - r) * fog, g + (sky_g - g) * fog, b + (sky_b - b) * fog);
+}
+
+static bool is_occupied_at(const occupancy_pyramid& volume, int32_t level, const int32_t v[3]) noexcept
+{
+	return volume.is_occupied(level, v[0] >> level, v[1] >> level, v[2] >> level);
+}
+
+bool raymarch_begin(const occupancy_pyramid& volume, const float origin[3], const float dir[3], float max_t, raymarch_state& s) noexcept
+{
+	const int32_t dim = static_cast<int32_t>(volume.dim());
+
+	float inv[3];
+
+	for (uint32_t a = 0; a != 3; ++a)
+		inv[a] = dir[a] != 0.0F ? 1.0F / dir[a] : no_hit_inv;
+
+	//Clip against the volume's bounds
+	float t = 0.0F;
+	float t_end = max_t;
+
+	uint8_t axis = 0;
+
+	for (uint8_t a = 0; a != 3; ++a)
+	{
+		float ta = (0.0F - origin[a]) * inv[a];
+		float tb = (static_cast<float>(dim) - origin[a]) * inv[a];
+
+		if (ta > tb)
+		{
+			const float tmp = ta;
+			ta = tb;
+			tb = tmp;
+		}
+
+		if (ta > t)
+		{
+			t = ta;
+			axis = a;
+		}
+
+		if (tb < t_end)
+			t_end = tb;
+	}
+
+	if (t > t_end)
+		return false;
+
+	s.t = t;
+	s.t_end = t_end;
+
+	//Coordinates are truncated instead of floored, which only differs in (-1, 0) and is clamped to 0 either way
+	for (uint32_t a = 0; a != 3; ++a)
+	{
+		const int32_t p = static_cast<int32_t>(origin[a] + dir[a] * t);
+
+		s.v[a] = p < 0 ? 0 : p >= dim ? dim - 1 : p;
+	}
+
+	s.level = static_cast<int32_t>(volume.level_cnt()) - 1;
+
+	s.axis = axis;
+
+	s.steps = 0;
+
+	return true;
+}
+
+bool raymarch_continue(const occupancy_pyramid& volume, const float origin[3], const float dir[3], raymarch_state& s, raymarch_hit& hit) noexcept
+{
+	const int32_t dim = static_cast<int32_t>(volume.dim());
+
+	float inv[3];
+
+	for (uint32_t a = 0; a != 3; ++a)
+		inv[a] = dir[a] != 0.0F ? 1.0F / dir[a] : no_hit_inv;
+
+	const int32_t top_level = static_cast<int32_t>(volume.level_cnt()) - 1;
+
+	int32_t* const v = s.v;
+
+	//Level of the largest empty cell around v, or -1 once v is occupied. Neighbouring cells tend to be empty at similar
+	//levels, so it is carried from step to step instead of being searched for from the root every time
+	int32_t level = s.level;
+
+	while (true)
+	{
+		if (is_occupied_at(volume, level, v))
+		{
+			do
+				--level;
+			while (level >= 0 && is_occupied_at(volume, level, v));
+		}
+		else
+		{
+			while (level != top_level && !is_occupied_at(volume, level + 1, v))
+				++level;
+		}
+
+		if (level < 0)
+		{
+			hit = { s.t, static_cast<uint32_t>(v[0]), static_cast<uint32_t>(v[1]), static_cast<uint32_t>(v[2]), s.axis, s.steps };
+
+			return true;
+		}
+
+		const int32_t size = 1 << level;
+
+		int32_t lo[3];
+
+		float t_exit = no_hit_inv;
+
+		uint8_t exit_axis = 0;
+
+		for (uint8_t a = 0; a != 3; ++a)
+		{
+			lo[a] = v[a] & ~(size - 1);
+
+			if (dir[a] == 0.0F)
+				continue;
+
+			const float bound = static_cast<float>(dir[a] > 0.0F ? lo[a] + size : lo[a]);
+
+			const float te = (bound - origin[a]) * inv[a];
+
+			if (te < t_exit)
+			{
+				t_exit = te;
+				exit_axis = a;
+			}
+		}
+
+		if (t_exit > s.t_end)
+			return false;
+
+		s.t = t_exit;
+
+		s.axis = exit_axis;
+
+		++s.steps;
+
+		//Step across the exit face, keeping the other coordinates inside the cell that was just left
+		for (uint8_t a = 0; a != 3; ++a)
+		{
+			if (a == exit_axis)
+			{
+				v[a] = dir[a] > 0.0F ? lo[a] + size : lo[a] - 1;
+			}
+			else
+			{
+				const int32_t p = static_cast<int32_t>(origin[a] + dir[a] * s.t);
+
+				v[a] = p < lo[a] ? lo[a] : p >= lo[a] + size ? lo[a] + size - 1 : p;
+			}
+		}
+
+		if (v[exit_axis] < 0 || v[exit_axis] >= dim)
+			return false;
+
+		s.level = level;
+	}
+}
+
+bool raymarch_ray(const occupancy_pyramid& volume, const float origin[3], const float dir[3], float max_t, raymarch_hit& hit) noexcept
+{
+	raymarch_state s;
+
+	return raymarch_begin(volume, origin, dir, max_t, s) && raymarch_continue(volume, origin, dir, s, hit);
+}
+
+static simd_tier packet_tier_for(simd_tier tier) noexcept
+{
+	return static_cast<uint8_t>(tier) >= static_cast<uint8_t>(simd_tier::avx2) ? simd_tier::avx2 : simd_tier::scalar;
+}
+
+static std::atomic<simd_tier>& active_tier() noexcept
+{
+	static std::atomic<simd_tier> tier{ packet_tier_for(detect_simd_tier()) };
+
+	return tier;
+}
+
+simd_tier raymarch_force_tier(simd_tier tier)
+{
+	tier = packet_tier_for(clamp_simd_tier(tier));
+
+	active_tier().store(tier, std::memory_order_relaxed);
+
+	return tier;
+}
+
+simd_tier raymarch_active_tier()
+{
+	return active_tier().load(std::memory_order_relaxed);
+}
+
+void raymarch_render(const occupancy_pyramid& volume, const raymarch_camera& cam, uint32_t* dst, uint32_t width, uint32_t height, size_t pitch, uint32_t max_threads)
+{
+	OCH_TRACE_SCOPE("raymarch_render", { "width", width }, { "height", height }, { "dim", volume.dim() });
+
+	const float cos_yaw = cosf(cam.yaw), sin_yaw = sinf(cam.yaw);
+	const float cos_pitch = cosf(cam.pitch), sin_pitch = sinf(cam.pitch);
+
+	const float forward[3]{ cos_yaw * cos_pitch, sin_yaw * cos_pitch, sin_pitch };
+	const float right[3]{ sin_yaw, -cos_yaw, 0.0F };
+	const float up[3]{ -cos_yaw * sin_pitch, -sin_yaw * sin_pitch, cos_pitch };
+
+	const float half_h = tanf(cam.fov_y * 0.5F);
+	const float half_w = half_h * static_cast<float>(width) / static_cast<float>(height);
+
+	const float max_t = static_cast<float>(volume.dim()) * 4.0F;
+
+	const uint32_t tiles_x = (width + raymarch_tile_dim - 1) / raymarch_tile_dim;
+	const uint32_t tiles_y = (height + raymarch_tile_dim - 1) / raymarch_tile_dim;
+
+	const bool use_packets = raymarch_active_tier() == simd_tier::avx2 && volume.level_cnt() >= 2;
+
+	const auto ray_dir = [&](uint32_t x, uint32_t y, float* dir)
+	{
+		const float sx = (2.0F * (static_cast<float>(x) + 0.5F) / static_cast<float>(width) - 1.0F) * half_w;
+		const float sy = (1.0F - 2.0F * (static_cast<float>(y) + 0.5F) / static_cast<float>(height)) * half_h;
+
+		for (uint32_t a = 0; a != 3; ++a)
+			dir[a] = forward[a] + right[a] * sx + up[a] * sy;
+
+		const float inv_len = 1.0F / sqrtf(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+
+		for (uint32_t a = 0; a != 3; ++a)
+			dir[a] *= inv_len;
+	};
+
+	const auto pixel = [&](uint32_t x, uint32_t y) -> uint32_t&
+	{
+		return reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(dst) + y * pitch)[x];
+	};
+
+	thread_pool::global().parallel_for(tiles_x * tiles_y, [&](uint32_t tile, uint32_t)
+		{
+			const uint32_t x_beg = tile % tiles_x * raymarch_tile_dim;
+			const uint32_t y_beg = tile / tiles_x * raymarch_tile_dim;
+
+			const uint32_t x_end = x_beg + raymarch_tile_dim < width ? x_beg + raymarch_tile_dim : width;
+			const uint32_t y_end = y_beg + raymarch_tile_dim < height ? y_beg + raymarch_tile_dim : height;
+
+			if (!use_packets)
+			{
+				for (uint32_t y = y_beg; y != y_end; ++y)
+					for (uint32_t x = x_beg; x != x_end; ++x)
+					{
+						float dir[3];
+
+						ray_dir(x, y, dir);
+
+						raymarch_hit hit;
+
+						const bool is_hit = raymarch_ray(volume, cam.pos, dir, max_t, hit);
+
+						pixel(x, y) = shade(volume, dir, is_hit, hit);
+					}
+
+				return;
+			}
+
+			for (uint32_t py = y_beg; py < y_end; py += raymarch_packet_h)
+				for (uint32_t px = x_beg; px < x_end; px += raymarch_packet_w)
+				{
+					float dir_x[raymarch_packet_width], dir_y[raymarch_packet_width], dir_z[raymarch_packet_width];
+
+					uint32_t lane_mask = 0;
+
+					for (uint32_t i = 0; i != raymarch_packet_width; ++i)
+					{
+						const uint32_t x = px + i % raymarch_packet_w;
+						const uint32_t y = py + i / raymarch_packet_w;
+
+						float dir[3]{ 1.0F, 0.0F, 0.0F };
+
+						if (x < x_end && y < y_end)
+						{
+							ray_dir(x, y, dir);
+
+							lane_mask |= 1 << i;
+						}
+
+						dir_x[i] = dir[0];
+						dir_y[i] = dir[1];
+						dir_z[i] = dir[2];
+					}
+
+					raymarch_hit hits[raymarch_packet_width];
+
+					const uint32_t hit_mask = raymarch_packet_avx2(volume, cam.pos, dir_x, dir_y, dir_z, lane_mask, max_t, hits);
+
+					for (uint32_t i = 0; i != raymarch_packet_width; ++i)
+					{
+						if (!(lane_mask & (1 << i)))
+							continue;
+
+						const float dir[3]{ dir_x[i], dir_y[i], dir_z[i] };
+
+						pixel(px + i % raymarch_packet_w, py + i / raymarch_packet_w) = shade(volume, dir, (hit_mask >> i) & 1, hits[i]);
+					}
+				}
+		}, max_threads);
+}
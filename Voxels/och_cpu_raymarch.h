@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "och_occupancy_pyramid.h"
+#include "och_cpu_features.h"
+
+struct raymarch_camera
+{
+	//Position in voxels
+	float pos[3];
+
+	//Radians. yaw 0 looks along +x, positive pitch looks up (+z)
+	float yaw;
+	float pitch;
+
+	//Vertical field of view in radians
+	float fov_y;
+};
+
+struct raymarch_hit
+{
+	float t;
+
+	uint32_t x, y, z;
+
+	//Axis (0 = x, 1 = y, 2 = z) of the face the ray entered the hit voxel through
+	uint8_t axis;
+
+	//Number of cells stepped through before the hit
+	uint32_t steps;
+};
+
+//Side of the square screen tiles that are handed out to the threads
+static constexpr uint32_t raymarch_tile_dim = 16;
+
+//First voxel above the volume's threshold along origin + t * dir for t in [0, max_t], walking the voxel grid with a 3D DDA.
+//Whenever the current voxel is empty the walk jumps to the exit of the largest empty pyramid cell containing it
+bool raymarch_ray(const occupancy_pyramid& volume, const float origin[3], const float dir[3], float max_t, raymarch_hit& hit) noexcept;
+
+//Renders the volume from cam into dst, whose rows are pitch bytes apart. Pixels are 0xAARRGGBB, i.e. uchar4 {b, g, r, a}
+//as written by d_simplex_3d_surface2d_grayscale_argb. Tiles of raymarch_tile_dim^2 pixels are spread over thread_pool::global().
+//On the avx2 tier, rays are traced in packets of 4x2 that step together, falling back to single rays once they diverge
+void raymarch_render(const occupancy_pyramid& volume, const raymarch_camera& cam, uint32_t* dst, uint32_t width, uint32_t height, size_t pitch, uint32_t max_threads = 0);
+
+//Forces raymarch_render to trace single rays (simd_tier::scalar, sse4) or packets (simd_tier::avx2 and above) for
+//clamp_simd_tier(tier), e.g. for benchmarking. Returns the tier used from now on
+simd_tier raymarch_force_tier(simd_tier tier);
+
+simd_tier raymarch_active_tier();
@@ -0,0 +1,307 @@
+#include "och_cpu_raymarch_backends.h"
+
+#include <cstdint>
+
+#include <immintrin.h>
+
+//Compiled with /arch:AVX2 (see Voxels.vcxproj); GCC and Clang get the equivalent target here
+#if defined(__GNUC__) && !defined(__AVX2__)
+#pragma GCC target("avx2,fma")
+#endif
+
+static constexpr float no_hit_inv = 1e30F;
+
+//Per-packet constants for occupancy lookups
+struct packet_pyramid
+{
+	const int32_t* masks;
+
+	//Offsets of the child masks of levels 1 to 8 and 9 to 16, looked up with a permute instead of a gather
+	__m256i offsets_lo;
+	__m256i offsets_hi;
+
+	__m256i top_level;
+};
+
+//Lanes in lane_mask whose voxel v is occupied at level (>= 0), read through the child mask of level max(level, 1).
+//Level 0 tests one bit of the parent's mask, higher levels test whether any bit is set
+static OCH_SIMD_INLINE __m256i occupied(const packet_pyramid& p, __m256i level, __m256i vx, __m256i vy, __m256i vz, __m256i lane_mask)
+{
+	const __m256i one = _mm256_set1_epi32(1);
+
+	const __m256i mask_level = _mm256_max_epi32(level, one);
+
+	const __m256i row_log2 = _mm256_sub_epi32(p.top_level, mask_level);
+
+	const __m256i cx = _mm256_srlv_epi32(vx, mask_level);
+	const __m256i cy = _mm256_srlv_epi32(vy, mask_level);
+	const __m256i cz = _mm256_srlv_epi32(vz, mask_level);
+
+	const __m256i idx = _mm256_or_si256(cx, _mm256_or_si256(_mm256_sllv_epi32(cy, row_log2), _mm256_sllv_epi32(cz, _mm256_add_epi32(row_log2, row_log2))));
+
+	const __m256i table_idx = _mm256_sub_epi32(mask_level, one);
+
+	const __m256i base = _mm256_blendv_epi8(_mm256_permutevar8x32_epi32(p.offsets_lo, table_idx), _mm256_permutevar8x32_epi32(p.offsets_hi, table_idx), _mm256_cmpgt_epi32(table_idx, _mm256_set1_epi32(7)));
+
+	const __m256i word = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), p.masks, _mm256_add_epi32(base, idx), lane_mask, 1);
+
+	const __m256i bit = _mm256_or_si256(_mm256_and_si256(vx, one), _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(vy, one), 1), _mm256_slli_epi32(_mm256_and_si256(vz, one), 2)));
+
+	const __m256i is_level_0 = _mm256_cmpeq_epi32(level, _mm256_setzero_si256());
+
+	const __m256i select = _mm256_blendv_epi8(_mm256_set1_epi32(0xFF), _mm256_sllv_epi32(one, bit), is_level_0);
+
+	const __m256i is_empty = _mm256_cmpeq_epi32(_mm256_and_si256(word, select), _mm256_setzero_si256());
+
+	return _mm256_andnot_si256(is_empty, lane_mask);
+}
+
+static OCH_SIMD_INLINE bool none(__m256i m)
+{
+	return _mm256_testz_si256(m, m);
+}
+
+static OCH_SIMD_INLINE __m256i as_int(__m256 m)
+{
+	return _mm256_castps_si256(m);
+}
+
+uint32_t raymarch_packet_avx2(const occupancy_pyramid& volume, const float origin[3], const float* dir_x, const float* dir_y, const float* dir_z, uint32_t lane_mask, float max_t, raymarch_hit* hits) noexcept
+{
+	const int32_t top = static_cast<int32_t>(volume.level_cnt()) - 1;
+
+	packet_pyramid p;
+
+	p.masks = reinterpret_cast<const int32_t*>(volume.child_masks());
+
+	alignas(32) int32_t offsets[16]{};
+
+	for (int32_t level = 1; level <= top; ++level)
+		offsets[level - 1] = static_cast<int32_t>(volume.child_mask_offset(level));
+
+	p.offsets_lo = _mm256_load_si256(reinterpret_cast<const __m256i*>(offsets));
+	p.offsets_hi = _mm256_load_si256(reinterpret_cast<const __m256i*>(offsets + 8));
+
+	p.top_level = _mm256_set1_epi32(top);
+
+	const float* const dirs[3]{ dir_x, dir_y, dir_z };
+
+	//Set up every lane with the single-ray code, so that packet and single rays start from identical states
+	raymarch_state lanes[raymarch_packet_width];
+
+	alignas(32) float t_init[raymarch_packet_width], t_end_init[raymarch_packet_width];
+
+	alignas(32) int32_t v_init[3][raymarch_packet_width], axis_init[raymarch_packet_width], active_init[raymarch_packet_width];
+
+	for (uint32_t i = 0; i != raymarch_packet_width; ++i)
+	{
+		const float dir[3]{ dir_x[i], dir_y[i], dir_z[i] };
+
+		const bool is_active = ((lane_mask >> i) & 1) && raymarch_begin(volume, origin, dir, max_t, lanes[i]);
+
+		active_init[i] = is_active ? -1 : 0;
+
+		t_init[i] = is_active ? lanes[i].t : 0.0F;
+		t_end_init[i] = is_active ? lanes[i].t_end : 0.0F;
+		axis_init[i] = is_active ? lanes[i].axis : 0;
+
+		for (uint32_t a = 0; a != 3; ++a)
+			v_init[a][i] = is_active ? lanes[i].v[a] : 0;
+	}
+
+	__m256i active = _mm256_load_si256(reinterpret_cast<const __m256i*>(active_init));
+
+	__m256 t = _mm256_load_ps(t_init);
+
+	const __m256 t_end = _mm256_load_ps(t_end_init);
+
+	__m256i v[3];
+
+	for (uint32_t a = 0; a != 3; ++a)
+		v[a] = _mm256_load_si256(reinterpret_cast<const __m256i*>(v_init[a]));
+
+	__m256i axis = _mm256_load_si256(reinterpret_cast<const __m256i*>(axis_init));
+
+	__m256i level = p.top_level;
+
+	__m256i steps = _mm256_setzero_si256();
+
+	__m256 o[3], d[3], inv[3];
+
+	__m256i is_positive[3], is_zero[3];
+
+	for (uint32_t a = 0; a != 3; ++a)
+	{
+		o[a] = _mm256_set1_ps(origin[a]);
+
+		d[a] = _mm256_loadu_ps(dirs[a]);
+
+		is_zero[a] = as_int(_mm256_cmp_ps(d[a], _mm256_setzero_ps(), _CMP_EQ_OQ));
+
+		is_positive[a] = as_int(_mm256_cmp_ps(d[a], _mm256_setzero_ps(), _CMP_GT_OQ));
+
+		inv[a] = _mm256_blendv_ps(_mm256_div_ps(_mm256_set1_ps(1.0F), d[a]), _mm256_set1_ps(no_hit_inv), _mm256_castsi256_ps(is_zero[a]));
+	}
+
+	const __m256i one = _mm256_set1_epi32(1);
+
+	const __m256i dim = _mm256_set1_epi32(static_cast<int32_t>(volume.dim()));
+
+	const __m256 no_exit = _mm256_set1_ps(no_hit_inv);
+
+	uint32_t hit_mask = 0;
+
+	alignas(32) float t_out[raymarch_packet_width];
+
+	alignas(32) int32_t v_out[3][raymarch_packet_width], axis_out[raymarch_packet_width], steps_out[raymarch_packet_width], level_out[raymarch_packet_width];
+
+	const auto store_lanes = [&]()
+	{
+		_mm256_store_ps(t_out, t);
+
+		for (uint32_t a = 0; a != 3; ++a)
+			_mm256_store_si256(reinterpret_cast<__m256i*>(v_out[a]), v[a]);
+
+		_mm256_store_si256(reinterpret_cast<__m256i*>(axis_out), axis);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(steps_out), steps);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(level_out), level);
+	};
+
+	while (true)
+	{
+		const uint32_t active_bits = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(active)));
+
+		if (static_cast<uint32_t>(_mm_popcnt_u32(active_bits)) < raymarch_packet_min_lanes)
+		{
+			if (!active_bits)
+				return hit_mask;
+
+			store_lanes();
+
+			for (uint32_t i = 0; i != raymarch_packet_width; ++i)
+			{
+				if (!((active_bits >> i) & 1))
+					continue;
+
+				raymarch_state& s = lanes[i];
+
+				s.t = t_out[i];
+				s.level = level_out[i];
+				s.axis = static_cast<uint8_t>(axis_out[i]);
+				s.steps = static_cast<uint32_t>(steps_out[i]);
+
+				for (uint32_t a = 0; a != 3; ++a)
+					s.v[a] = v_out[a][i];
+
+				const float dir[3]{ dir_x[i], dir_y[i], dir_z[i] };
+
+				if (raymarch_continue(volume, origin, dir, s, hits[i]))
+					hit_mask |= 1 << i;
+			}
+
+			return hit_mask;
+		}
+
+		//Same level search as the single-ray walk: descend while occupied, otherwise climb while the parent is empty.
+		//The cell and its parent are looked up together, so that the common case of a single step costs one memory round trip
+		const __m256i can_climb = _mm256_and_si256(active, _mm256_cmpgt_epi32(p.top_level, level));
+
+		__m256i pending = occupied(p, level, v[0], v[1], v[2], active);
+
+		const __m256i parent_occupied = occupied(p, _mm256_add_epi32(level, one), v[0], v[1], v[2], can_climb);
+
+		__m256i climbing = _mm256_andnot_si256(_mm256_or_si256(pending, parent_occupied), can_climb);
+
+		while (!none(pending))
+		{
+			level = _mm256_add_epi32(level, pending);
+
+			pending = occupied(p, level, v[0], v[1], v[2], _mm256_and_si256(pending, _mm256_cmpgt_epi32(level, _mm256_set1_epi32(-1))));
+		}
+
+		while (!none(climbing))
+		{
+			level = _mm256_sub_epi32(level, climbing);
+
+			climbing = _mm256_and_si256(climbing, _mm256_cmpgt_epi32(p.top_level, level));
+
+			climbing = _mm256_andnot_si256(occupied(p, _mm256_add_epi32(level, one), v[0], v[1], v[2], climbing), climbing);
+		}
+
+		const __m256i hit_lanes = _mm256_and_si256(active, _mm256_cmpgt_epi32(_mm256_setzero_si256(), level));
+
+		if (!none(hit_lanes))
+		{
+			const uint32_t hit_bits = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(hit_lanes)));
+
+			store_lanes();
+
+			for (uint32_t i = 0; i != raymarch_packet_width; ++i)
+				if ((hit_bits >> i) & 1)
+					hits[i] = { t_out[i], static_cast<uint32_t>(v_out[0][i]), static_cast<uint32_t>(v_out[1][i]), static_cast<uint32_t>(v_out[2][i]), static_cast<uint8_t>(axis_out[i]), static_cast<uint32_t>(steps_out[i]) };
+
+			hit_mask |= hit_bits;
+
+			active = _mm256_andnot_si256(hit_lanes, active);
+		}
+
+		//Exit of the empty cell of size 2^level around v
+		const __m256i size = _mm256_sllv_epi32(one, level);
+
+		__m256i lo[3], hi[3];
+
+		__m256 te[3];
+
+		for (uint32_t a = 0; a != 3; ++a)
+		{
+			lo[a] = _mm256_andnot_si256(_mm256_sub_epi32(size, one), v[a]);
+
+			hi[a] = _mm256_add_epi32(lo[a], size);
+
+			const __m256 bound = _mm256_cvtepi32_ps(_mm256_blendv_epi8(lo[a], hi[a], is_positive[a]));
+
+			te[a] = _mm256_blendv_ps(_mm256_mul_ps(_mm256_sub_ps(bound, o[a]), inv[a]), no_exit, _mm256_castsi256_ps(is_zero[a]));
+		}
+
+		//First minimum wins, as in the single-ray walk
+		const __m256i exit_x = as_int(_mm256_and_ps(_mm256_cmp_ps(te[0], te[1], _CMP_LE_OQ), _mm256_cmp_ps(te[0], te[2], _CMP_LE_OQ)));
+
+		const __m256i exit_y = _mm256_andnot_si256(exit_x, as_int(_mm256_cmp_ps(te[1], te[2], _CMP_LE_OQ)));
+
+		const __m256i exit_z = _mm256_andnot_si256(_mm256_or_si256(exit_x, exit_y), _mm256_set1_epi32(-1));
+
+		const __m256 t_exit = _mm256_min_ps(te[0], _mm256_min_ps(te[1], te[2]));
+
+		active = _mm256_andnot_si256(as_int(_mm256_cmp_ps(t_exit, t_end, _CMP_GT_OQ)), active);
+
+		t = _mm256_blendv_ps(t, t_exit, _mm256_castsi256_ps(active));
+
+		const __m256i exit_axis = _mm256_or_si256(_mm256_and_si256(exit_y, one), _mm256_and_si256(exit_z, _mm256_set1_epi32(2)));
+
+		axis = _mm256_blendv_epi8(axis, exit_axis, active);
+
+		steps = _mm256_sub_epi32(steps, active);
+
+		const __m256i exits[3]{ exit_x, exit_y, exit_z };
+
+		__m256i out_of_bounds = _mm256_setzero_si256();
+
+		for (uint32_t a = 0; a != 3; ++a)
+		{
+			const __m256i stepped = _mm256_blendv_epi8(_mm256_sub_epi32(lo[a], one), hi[a], is_positive[a]);
+
+			const __m256i along = _mm256_cvttps_epi32(_mm256_add_ps(o[a], _mm256_mul_ps(d[a], t)));
+
+			const __m256i clamped = _mm256_min_epi32(_mm256_max_epi32(along, lo[a]), _mm256_sub_epi32(hi[a], one));
+
+			const __m256i next = _mm256_blendv_epi8(clamped, stepped, exits[a]);
+
+			v[a] = _mm256_blendv_epi8(v[a], next, active);
+
+			//Negative coordinates compare as large unsigned values, so one test covers both ends
+			out_of_bounds = _mm256_or_si256(out_of_bounds, _mm256_cmpeq_epi32(_mm256_max_epu32(v[a], dim), v[a]));
+		}
+
+		active = _mm256_andnot_si256(out_of_bounds, active);
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+#include "och_cpu_raymarch.h"
+
+//Rays traced together by the packet traversal, laid out as 4x2 pixels
+static constexpr uint32_t raymarch_packet_width = 8;
+
+static constexpr uint32_t raymarch_packet_w = 4;
+
+static constexpr uint32_t raymarch_packet_h = 2;
+
+//Once fewer lanes than this are still marching, the packet hands them over to the single-ray walk
+static constexpr uint32_t raymarch_packet_min_lanes = 3;
+
+//Progress of one ray between two steps of the DDA, so that packet lanes can be finished one at a time
+struct raymarch_state
+{
+	float t;
+	float t_end;
+
+	int32_t v[3];
+
+	//Level of the empty cell around v from the last step. Only a starting point for the next step's search
+	int32_t level;
+
+	uint8_t axis;
+
+	uint32_t steps;
+};
+
+//Clips the ray against the volume and sets up s at the first voxel inside it. Returns false if the ray misses the volume
+bool raymarch_begin(const occupancy_pyramid& volume, const float origin[3], const float dir[3], float max_t, raymarch_state& s) noexcept;
+
+//Walks from s until the first occupied voxel, returning false if the ray leaves the volume or passes s.t_end first
+bool raymarch_continue(const occupancy_pyramid& volume, const float origin[3], const float dir[3], raymarch_state& s, raymarch_hit& hit) noexcept;
+
+//Traces the lanes set in lane_mask of a packet of raymarch_packet_width rays sharing origin, with directions given as
+//SoA arrays. Steps all lanes together with AVX2 and finishes stragglers with raymarch_continue.
+//Writes hits[i] for every lane i that hits and returns the mask of those lanes. The volume must have at least two levels
+uint32_t raymarch_packet_avx2(const occupancy_pyramid& volume, const float origin[3], const float* dir_x, const float* dir_y, const float* dir_z, uint32_t lane_mask, float max_t, raymarch_hit* hits) noexcept;
@@ -0,0 +1,450 @@
+#include "och_csg.h"
+
+#include <algorithm>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "och_thread_pool.h"
+#include "och_trace.h"
+
+static constexpr int64_t chunk_dim = chunked_bit_volume::chunk_dim;
+
+static int64_t floor_div_chunk(int64_t v) noexcept
+{
+	return v >> chunked_bit_volume::chunk_dim_log2;
+}
+
+template<csg_op Op>
+static uint64_t combine(uint64_t dst, uint64_t src) noexcept
+{
+	if constexpr (Op == csg_op::unite)
+		return dst | src;
+	else if constexpr (Op == csg_op::intersect)
+		return dst & src;
+	else if constexpr (Op == csg_op::subtract)
+		return dst & ~src;
+	else
+		return dst ^ src;
+}
+
+//Voxels [p, p + 64) of lo and hi, two consecutive 64-voxel words starting at a multiple of 64 below p, with 0 <= p % 64 == s
+static uint64_t merge_shifted(uint64_t lo, uint64_t hi, uint32_t s) noexcept
+{
+	return s == 0 ? lo : (lo >> s) | (hi << (64 - s));
+}
+
+//A bit_volume placed at an offset. row returns a cursor over row (y, z) in destination coordinates, whose word returns the
+//64 voxels starting at x, a multiple of 64, and whose apply combines a range of destination words with the row
+struct dense_source
+{
+	const bit_volume& src;
+
+	int64_t off[3];
+
+	void bounds(int64_t beg[3], int64_t end[3]) const noexcept
+	{
+		const int64_t cnt[3]{ src.x_cnt(), src.y_cnt(), src.z_cnt() };
+
+		for (uint32_t a = 0; a != 3; ++a)
+		{
+			beg[a] = off[a];
+			end[a] = off[a] + cnt[a];
+		}
+	}
+
+	std::vector<chunk_coord> covered_chunks() const
+	{
+		int64_t beg[3], end[3];
+
+		bounds(beg, end);
+
+		std::vector<chunk_coord> coords;
+
+		if (beg[0] == end[0] || beg[1] == end[1] || beg[2] == end[2])
+			return coords;
+
+		for (int64_t cz = floor_div_chunk(beg[2]); cz <= floor_div_chunk(end[2] - 1); ++cz)
+			for (int64_t cy = floor_div_chunk(beg[1]); cy <= floor_div_chunk(end[1] - 1); ++cy)
+				for (int64_t cx = floor_div_chunk(beg[0]); cx <= floor_div_chunk(end[0] - 1); ++cx)
+					coords.push_back({ static_cast<int32_t>(cx), static_cast<int32_t>(cy), static_cast<int32_t>(cz) });
+
+		return coords;
+	}
+
+	//Row (y, z) of src in destination coordinates
+	struct row_cursor
+	{
+		const uint64_t* row;
+
+		int64_t row_words;
+
+		int64_t x_off;
+
+		//64 voxels starting at x, a multiple of 64
+		uint64_t word(int64_t x) const noexcept
+		{
+			if (!row)
+				return 0;
+
+			const int64_t sx = x - x_off;
+
+			const int64_t w = sx >> 6;
+
+			const uint64_t lo = w >= 0 && w < row_words ? row[w] : 0;
+			const uint64_t hi = w + 1 >= 0 && w + 1 < row_words ? row[w + 1] : 0;
+
+			return merge_shifted(lo, hi, static_cast<uint32_t>(sx & 63));
+		}
+
+		//Combines words [w_beg, w_end) of dst_row with this row. Words whose source words are both inside the row take a
+		//loop without bounds checks
+		template<csg_op Op>
+		void apply(uint64_t* dst_row, int64_t w_beg, int64_t w_end) const noexcept
+		{
+			if (!row)
+			{
+				for (int64_t w = w_beg; w != w_end; ++w)
+					dst_row[w] = combine<Op>(dst_row[w], 0);
+
+				return;
+			}
+
+			//Destination word w starts at source word w + k, shifted down by s bits
+			const int64_t k = (-x_off) >> 6;
+
+			const uint32_t s = static_cast<uint32_t>((-x_off) & 63);
+
+			const int64_t fast_beg = std::clamp(-k, w_beg, w_end);
+			const int64_t fast_end = std::clamp(row_words - k - (s != 0), fast_beg, w_end);
+
+			for (int64_t w = w_beg; w != fast_beg; ++w)
+				dst_row[w] = combine<Op>(dst_row[w], word(w * 64));
+
+			if (s == 0)
+			{
+				for (int64_t w = fast_beg; w != fast_end; ++w)
+					dst_row[w] = combine<Op>(dst_row[w], row[w + k]);
+			}
+			else
+			{
+				for (int64_t w = fast_beg; w != fast_end; ++w)
+					dst_row[w] = combine<Op>(dst_row[w], (row[w + k] >> s) | (row[w + k + 1] << (64 - s)));
+			}
+
+			for (int64_t w = fast_end; w != w_end; ++w)
+				dst_row[w] = combine<Op>(dst_row[w], word(w * 64));
+		}
+	};
+
+	row_cursor row(int64_t y, int64_t z) const noexcept
+	{
+		const int64_t sy = y - off[1];
+		const int64_t sz = z - off[2];
+
+		if (sy < 0 || sz < 0 || sy >= src.y_cnt() || sz >= src.z_cnt())
+			return { nullptr, 0, 0 };
+
+		return { src.row(static_cast<uint32_t>(sy), static_cast<uint32_t>(sz)), src.row_words(), off[0] };
+	}
+};
+
+//A chunked_bit_volume placed at an offset, with the same interface as dense_source. The last two chunks looked up are
+//cached, which serves every word of a row after the first. Copies are made per task, so that the cache is not shared
+struct chunked_source
+{
+	struct cached_chunk
+	{
+		chunk_coord coord;
+
+		bit_chunk_state state;
+
+		const uint64_t* words;
+	};
+
+	const chunked_bit_volume& src;
+
+	int64_t off[3];
+
+	cached_chunk cache[2]{ { { INT32_MIN, 0, 0 }, bit_chunk_state::empty, nullptr }, { { INT32_MIN, 0, 0 }, bit_chunk_state::empty, nullptr } };
+
+	uint32_t next_slot = 0;
+
+	void bounds(int64_t beg[3], int64_t end[3]) const
+	{
+		const std::vector<chunk_coord> coords = src.chunk_coords();
+
+		if (coords.empty())
+		{
+			for (uint32_t a = 0; a != 3; ++a)
+				beg[a] = end[a] = 0;
+
+			return;
+		}
+
+		for (uint32_t a = 0; a != 3; ++a)
+		{
+			beg[a] = INT64_MAX;
+			end[a] = INT64_MIN;
+		}
+
+		for (const chunk_coord c : coords)
+		{
+			const int64_t xyz[3]{ c.x, c.y, c.z };
+
+			for (uint32_t a = 0; a != 3; ++a)
+			{
+				beg[a] = std::min(beg[a], xyz[a] * chunk_dim + off[a]);
+				end[a] = std::max(end[a], (xyz[a] + 1) * chunk_dim + off[a]);
+			}
+		}
+	}
+
+	std::vector<chunk_coord> covered_chunks() const
+	{
+		std::vector<chunk_coord> coords;
+
+		for (const chunk_coord c : src.chunk_coords())
+		{
+			const int64_t beg[3]{ c.x * chunk_dim + off[0], c.y * chunk_dim + off[1], c.z * chunk_dim + off[2] };
+
+			for (int64_t cz = floor_div_chunk(beg[2]); cz <= floor_div_chunk(beg[2] + chunk_dim - 1); ++cz)
+				for (int64_t cy = floor_div_chunk(beg[1]); cy <= floor_div_chunk(beg[1] + chunk_dim - 1); ++cy)
+					for (int64_t cx = floor_div_chunk(beg[0]); cx <= floor_div_chunk(beg[0] + chunk_dim - 1); ++cx)
+						coords.push_back({ static_cast<int32_t>(cx), static_cast<int32_t>(cy), static_cast<int32_t>(cz) });
+		}
+
+		const auto as_tuple = [](const chunk_coord& c) { return std::make_tuple(c.z, c.y, c.x); };
+
+		std::sort(coords.begin(), coords.end(), [&](const chunk_coord& l, const chunk_coord& r) { return as_tuple(l) < as_tuple(r); });
+
+		coords.erase(std::unique(coords.begin(), coords.end(), [&](const chunk_coord& l, const chunk_coord& r) { return as_tuple(l) == as_tuple(r); }), coords.end());
+
+		return coords;
+	}
+
+	uint64_t chunk_word(chunk_coord coord, uint32_t word_idx) noexcept
+	{
+		const cached_chunk* c = nullptr;
+
+		for (const cached_chunk& e : cache)
+			if (e.coord.x == coord.x && e.coord.y == coord.y && e.coord.z == coord.z)
+				c = &e;
+
+		if (!c)
+		{
+			cached_chunk& e = cache[next_slot];
+
+			next_slot ^= 1;
+
+			e.coord = coord;
+
+			e.state = src.find_chunk(coord, e.words);
+
+			c = &e;
+		}
+
+		if (c->state == bit_chunk_state::mixed)
+			return c->words[word_idx];
+
+		return c->state == bit_chunk_state::full ? ~0ULL : 0;
+	}
+
+	struct row_cursor
+	{
+		chunked_source& source;
+
+		int32_t cy, cz;
+
+		uint32_t word_idx;
+
+		int64_t x_off;
+
+		uint64_t word(int64_t x) const noexcept
+		{
+			const int64_t sx = x - x_off;
+
+			const int32_t cx = static_cast<int32_t>(floor_div_chunk(sx));
+
+			const uint32_t s = static_cast<uint32_t>(sx & 63);
+
+			const uint64_t lo = source.chunk_word({ cx, cy, cz }, word_idx);
+
+			return s == 0 ? lo : merge_shifted(lo, source.chunk_word({ cx + 1, cy, cz }, word_idx), s);
+		}
+
+		template<csg_op Op>
+		void apply(uint64_t* dst_row, int64_t w_beg, int64_t w_end) const noexcept
+		{
+			for (int64_t w = w_beg; w != w_end; ++w)
+				dst_row[w] = combine<Op>(dst_row[w], word(w * 64));
+		}
+	};
+
+	row_cursor row(int64_t y, int64_t z) noexcept
+	{
+		const int64_t sy = y - off[1];
+		const int64_t sz = z - off[2];
+
+		return { *this, static_cast<int32_t>(floor_div_chunk(sy)), static_cast<int32_t>(floor_div_chunk(sz)), static_cast<uint32_t>((sy & (chunk_dim - 1)) + (sz & (chunk_dim - 1)) * chunk_dim), off[0] };
+	}
+};
+
+template<csg_op Op, typename Source>
+static void apply_dense(bit_volume& dst, const Source& src, uint32_t max_threads)
+{
+	const int64_t cnt[3]{ dst.x_cnt(), dst.y_cnt(), dst.z_cnt() };
+
+	int64_t beg[3]{ 0, 0, 0 };
+	int64_t end[3]{ cnt[0], cnt[1], cnt[2] };
+
+	//Outside src, only intersect changes dst
+	if constexpr (Op != csg_op::intersect)
+	{
+		src.bounds(beg, end);
+
+		for (uint32_t a = 0; a != 3; ++a)
+		{
+			beg[a] = std::clamp<int64_t>(beg[a], 0, cnt[a]);
+			end[a] = std::clamp<int64_t>(end[a], 0, cnt[a]);
+		}
+	}
+
+	if (beg[0] >= end[0] || beg[1] >= end[1] || beg[2] >= end[2])
+		return;
+
+	const int64_t row_words = dst.row_words();
+
+	const int64_t w_beg = beg[0] / 64;
+	const int64_t w_end = (end[0] + 63) / 64;
+
+	//src may have voxels beyond the end of dst's rows, which must not end up in the unused bits
+	const uint64_t tail_mask = dst.x_cnt() % 64 ? (1ULL << (dst.x_cnt() % 64)) - 1 : ~0ULL;
+
+	thread_pool::global().parallel_for(static_cast<uint32_t>(end[2] - beg[2]), [&](uint32_t task_idx, uint32_t)
+		{
+			Source s = src;
+
+			const int64_t z = beg[2] + task_idx;
+
+			for (int64_t y = beg[1]; y != end[1]; ++y)
+			{
+				uint64_t* const row = dst.row(static_cast<uint32_t>(y), static_cast<uint32_t>(z));
+
+				s.row(y, z).template apply<Op>(row, w_beg, w_end);
+
+				if (w_end == row_words)
+					row[row_words - 1] &= tail_mask;
+			}
+		}, max_threads);
+}
+
+template<csg_op Op, typename Source>
+static void apply_chunked(chunked_bit_volume& dst, const Source& src, uint32_t max_threads)
+{
+	//Outside src, only intersect changes dst, and it only changes stored chunks
+	std::vector<chunk_coord> coords = Op == csg_op::intersect ? dst.chunk_coords() : src.covered_chunks();
+
+	//Chunks are made mixed up front, so that the tasks never modify the hash map. Chunks that cannot change are dropped
+	std::vector<uint64_t*> targets;
+
+	targets.reserve(coords.size());
+
+	size_t target_cnt = 0;
+
+	for (const chunk_coord c : coords)
+	{
+		const uint64_t* words;
+
+		const bit_chunk_state state = dst.find_chunk(c, words);
+
+		if ((Op == csg_op::unite && state == bit_chunk_state::full) || (Op == csg_op::subtract && state == bit_chunk_state::empty))
+			continue;
+
+		coords[target_cnt++] = c;
+
+		targets.push_back(dst.mixed_chunk(c));
+	}
+
+	coords.resize(target_cnt);
+
+	thread_pool::global().parallel_for(static_cast<uint32_t>(target_cnt), [&](uint32_t task_idx, uint32_t)
+		{
+			Source s = src;
+
+			const chunk_coord c = coords[task_idx];
+
+			uint64_t* const words = targets[task_idx];
+
+			for (int64_t z = 0; z != chunk_dim; ++z)
+				for (int64_t y = 0; y != chunk_dim; ++y)
+				{
+					uint64_t& word = words[y + z * chunk_dim];
+
+					word = combine<Op>(word, s.row(c.y * chunk_dim + y, c.z * chunk_dim + z).word(c.x * chunk_dim));
+				}
+		}, max_threads);
+
+	for (const chunk_coord c : coords)
+		dst.collapse_chunk(c);
+}
+
+template<typename Fn>
+static void dispatch(csg_op op, Fn&& fn)
+{
+	switch (op)
+	{
+	case csg_op::unite:     fn(std::integral_constant<csg_op, csg_op::unite>{});     break;
+	case csg_op::intersect: fn(std::integral_constant<csg_op, csg_op::intersect>{}); break;
+	case csg_op::subtract:  fn(std::integral_constant<csg_op, csg_op::subtract>{});  break;
+	case csg_op::toggle:    fn(std::integral_constant<csg_op, csg_op::toggle>{});    break;
+	}
+}
+
+const char* csg_op_name(csg_op op) noexcept
+{
+	switch (op)
+	{
+	case csg_op::unite:     return "unite";
+	case csg_op::intersect: return "intersect";
+	case csg_op::subtract:  return "subtract";
+	case csg_op::toggle:    return "toggle";
+	default:                return "unknown";
+	}
+}
+
+void csg_apply(bit_volume& dst, const bit_volume& src, csg_op op, int32_t x_off, int32_t y_off, int32_t z_off, uint32_t max_threads)
+{
+	OCH_TRACE_SCOPE("csg_apply", { "op", static_cast<uint32_t>(op) }, { "src_voxels", static_cast<uint64_t>(src.x_cnt()) * src.y_cnt() * src.z_cnt() });
+
+	const dense_source source{ src, { x_off, y_off, z_off } };
+
+	dispatch(op, [&](auto op_c) { apply_dense<decltype(op_c)::value>(dst, source, max_threads); });
+}
+
+void csg_apply(bit_volume& dst, const chunked_bit_volume& src, csg_op op, int32_t x_off, int32_t y_off, int32_t z_off, uint32_t max_threads)
+{
+	OCH_TRACE_SCOPE("csg_apply", { "op", static_cast<uint32_t>(op) }, { "src_chunks", static_cast<uint64_t>(src.stored_chunk_cnt()) });
+
+	const chunked_source source{ src, { x_off, y_off, z_off } };
+
+	dispatch(op, [&](auto op_c) { apply_dense<decltype(op_c)::value>(dst, source, max_threads); });
+}
+
+void csg_apply(chunked_bit_volume& dst, const bit_volume& src, csg_op op, int32_t x_off, int32_t y_off, int32_t z_off, uint32_t max_threads)
+{
+	OCH_TRACE_SCOPE("csg_apply", { "op", static_cast<uint32_t>(op) }, { "src_voxels", static_cast<uint64_t>(src.x_cnt()) * src.y_cnt() * src.z_cnt() });
+
+	const dense_source source{ src, { x_off, y_off, z_off } };
+
+	dispatch(op, [&](auto op_c) { apply_chunked<decltype(op_c)::value>(dst, source, max_threads); });
+}
+
+void csg_apply(chunked_bit_volume& dst, const chunked_bit_volume& src, csg_op op, int32_t x_off, int32_t y_off, int32_t z_off, uint32_t max_threads)
+{
+	OCH_TRACE_SCOPE("csg_apply", { "op", static_cast<uint32_t>(op) }, { "src_chunks", static_cast<uint64_t>(src.stored_chunk_cnt()) });
+
+	const chunked_source source{ src, { x_off, y_off, z_off } };
+
+	dispatch(op, [&](auto op_c) { apply_chunked<decltype(op_c)::value>(dst, source, max_threads); });
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+#include "och_bit_volume.h"
+
+enum class csg_op : uint8_t
+{
+	unite,		//dst | src
+	intersect,	//dst & src
+	subtract,	//dst & ~src
+	toggle,		//dst ^ src
+};
+
+const char* csg_op_name(csg_op op) noexcept;
+
+//Combines src into dst as dst = dst op src, with voxel (x, y, z) of src placed at (x + x_off, y + y_off, z + z_off) of dst.
+//Voxels outside src count as empty, so intersect clears all of dst outside src, while the other operations only touch the
+//words that src overlaps. Every destination word is computed at once, from at most two source words that are shifted into
+//place when x_off is not a multiple of 64. Rows, or chunks for a chunked_bit_volume destination, are spread over the threads
+//of thread_pool::global(), max_threads capping their number (0 meaning no cap). dst and src must be different volumes.
+//Dense destinations are clipped to their extent. Chunked destinations grow as needed and have chunks that became uniform collapsed.
+void csg_apply(bit_volume& dst, const bit_volume& src, csg_op op, int32_t x_off = 0, int32_t y_off = 0, int32_t z_off = 0, uint32_t max_threads = 0);
+
+void csg_apply(bit_volume& dst, const chunked_bit_volume& src, csg_op op, int32_t x_off = 0, int32_t y_off = 0, int32_t z_off = 0, uint32_t max_threads = 0);
+
+void csg_apply(chunked_bit_volume& dst, const bit_volume& src, csg_op op, int32_t x_off = 0, int32_t y_off = 0, int32_t z_off = 0, uint32_t max_threads = 0);
+
+void csg_apply(chunked_bit_volume& dst, const chunked_bit_volume& src, csg_op op, int32_t x_off = 0, int32_t y_off = 0, int32_t z_off = 0, uint32_t max_threads = 0);
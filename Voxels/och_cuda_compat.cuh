@@ -0,0 +1,24 @@
+#pragma once
+
+//Selects between the CUDA toolkit and the host-only stand-in from och_cuda_cpu.h.
+//Kernels are launched as OCH_LAUNCH(kernel, grid, block)(args...), which becomes kernel<<<grid, block>>>(args...) under nvcc.
+//OCH_LAUNCH_STREAM(kernel, grid, block, stream)(args...) launches on stream instead of the default stream.
+
+#ifdef OCH_CPU_BACKEND
+
+#include "och_cuda_cpu.h"
+
+#define OCH_LAUNCH(kernel, grid, block) cpu_backend_launch(kernel, #kernel, grid, block)
+
+#define OCH_LAUNCH_STREAM(kernel, grid, block, stream) cpu_backend_launch(kernel, #kernel, grid, block, stream)
+
+#else
+
+#include "cuda_runtime.h"
+#include "device_launch_parameters.h"
+
+#define OCH_LAUNCH(kernel, grid, block) kernel<<<grid, block>>>
+
+#define OCH_LAUNCH_STREAM(kernel, grid, block, stream) kernel<<<grid, block, 0, stream>>>
+
+#endif
@@ -0,0 +1,710 @@
+#include "och_cuda_cpu.h"
+
+#include "och_thread_pool.h"
+#include "och_trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+thread_local uint3 threadIdx;
+thread_local uint3 blockIdx;
+thread_local dim3 blockDim;
+thread_local dim3 gridDim;
+
+static thread_local cudaError_t tl_last_error = cudaSuccess;
+
+/*////////////////////////////////////////////////////////////////////////*/
+/*/////////////////////////////////ERRORS/////////////////////////////////*/
+/*////////////////////////////////////////////////////////////////////////*/
+
+const char* cudaGetErrorName(cudaError_t err) noexcept
+{
+	switch (err)
+	{
+	case cudaSuccess: return "cudaSuccess";
+	case cudaErrorInvalidValue: return "cudaErrorInvalidValue";
+	case cudaErrorMemoryAllocation: return "cudaErrorMemoryAllocation";
+	case cudaErrorInvalidConfiguration: return "cudaErrorInvalidConfiguration";
+	case cudaErrorInvalidResourceHandle: return "cudaErrorInvalidResourceHandle";
+	case cudaErrorNotReady: return "cudaErrorNotReady";
+	default: return "cudaErrorUnknown";
+	}
+}
+
+const char* cudaGetErrorString(cudaError_t err) noexcept
+{
+	switch (err)
+	{
+	case cudaSuccess: return "no error";
+	case cudaErrorInvalidValue: return "invalid argument";
+	case cudaErrorMemoryAllocation: return "out of memory";
+	case cudaErrorInvalidConfiguration: return "invalid configuration argument";
+	case cudaErrorInvalidResourceHandle: return "invalid resource handle";
+	case cudaErrorNotReady: return "device not ready";
+	default: return "unknown error";
+	}
+}
+
+static cudaError_t set_error(cudaError_t err) noexcept
+{
+	if (err != cudaSuccess)
+		tl_last_error = err;
+
+	return err;
+}
+
+cudaError_t cudaGetLastError() noexcept
+{
+	cudaError_t err = tl_last_error;
+
+	tl_last_error = cudaSuccess;
+
+	return err;
+}
+
+cudaError_t cudaPeekAtLastError() noexcept
+{
+	return tl_last_error;
+}
+
+/*////////////////////////////////////////////////////////////////////////*/
+/*/////////////////////////////////MEMORY/////////////////////////////////*/
+/*////////////////////////////////////////////////////////////////////////*/
+
+static constexpr size_t pitch_alignment = 64;
+
+static void* aligned_alloc_bytes(size_t bytes) noexcept
+{
+	return ::operator new(bytes ? bytes : 1, std::align_val_t{ pitch_alignment }, std::nothrow);
+}
+
+static void aligned_free_bytes(void* ptr) noexcept
+{
+	::operator delete(ptr, std::align_val_t{ pitch_alignment }, std::nothrow);
+}
+
+cudaError_t cudaMalloc(void** ptr, size_t bytes) noexcept
+{
+	if (!ptr)
+		return set_error(cudaErrorInvalidValue);
+
+	*ptr = aligned_alloc_bytes(bytes);
+
+	return *ptr ? cudaSuccess : set_error(cudaErrorMemoryAllocation);
+}
+
+cudaError_t cudaFree(void* ptr) noexcept
+{
+	aligned_free_bytes(ptr);
+
+	return cudaSuccess;
+}
+
+cudaError_t cudaMalloc3D(cudaPitchedPtr* pitched_ptr, cudaExtent extent) noexcept
+{
+	if (!pitched_ptr)
+		return set_error(cudaErrorInvalidValue);
+
+	const size_t pitch = (extent.width + pitch_alignment - 1) & ~(pitch_alignment - 1);
+
+	void* ptr = aligned_alloc_bytes(pitch * extent.height * extent.depth);
+
+	if (!ptr)
+		return set_error(cudaErrorMemoryAllocation);
+
+	*pitched_ptr = make_cudaPitchedPtr(ptr, pitch, extent.width, extent.height);
+
+	return cudaSuccess;
+}
+
+cudaError_t cudaMalloc3DArray(cudaArray_t* arr, const cudaChannelFormatDesc* desc, cudaExtent extent, unsigned int) noexcept
+{
+	if (!arr || !desc)
+		return set_error(cudaErrorInvalidValue);
+
+	const size_t elem_bytes = static_cast<size_t>(desc->x + desc->y + desc->z + desc->w) / 8;
+
+	if (!elem_bytes)
+		return set_error(cudaErrorInvalidValue);
+
+	//A height or depth of 0 denotes a 1D or 2D array
+	const cudaExtent ext{ extent.width, extent.height ? extent.height : 1, extent.depth ? extent.depth : 1 };
+
+	cudaArray* a = new(std::nothrow) cudaArray;
+
+	if (!a)
+		return set_error(cudaErrorMemoryAllocation);
+
+	a->data = static_cast<uint8_t*>(aligned_alloc_bytes(ext.width * ext.height * ext.depth * elem_bytes));
+
+	if (!a->data)
+	{
+		delete a;
+
+		return set_error(cudaErrorMemoryAllocation);
+	}
+
+	memset(a->data, 0, ext.width * ext.height * ext.depth * elem_bytes);
+
+	a->extent = ext;
+	a->elem_bytes = elem_bytes;
+	a->desc = *desc;
+
+	*arr = a;
+
+	return cudaSuccess;
+}
+
+cudaError_t cudaMallocArray(cudaArray_t* arr, const cudaChannelFormatDesc* desc, size_t width, size_t height, unsigned int flags) noexcept
+{
+	return cudaMalloc3DArray(arr, desc, make_cudaExtent(width, height, 0), flags);
+}
+
+cudaError_t cudaFreeArray(cudaArray_t arr) noexcept
+{
+	if (arr)
+	{
+		aligned_free_bytes(arr->data);
+
+		delete arr;
+	}
+
+	return cudaSuccess;
+}
+
+cudaError_t cudaMemcpy(void* dst, const void* src, size_t bytes, cudaMemcpyKind) noexcept
+{
+	if (bytes && (!dst || !src))
+		return set_error(cudaErrorInvalidValue);
+
+	memmove(dst, src, bytes);
+
+	return cudaSuccess;
+}
+
+cudaError_t cudaMemset(void* dst, int value, size_t bytes) noexcept
+{
+	if (bytes && !dst)
+		return set_error(cudaErrorInvalidValue);
+
+	memset(dst, value, bytes);
+
+	return cudaSuccess;
+}
+
+//Byte-addressed view of either side of a cudaMemcpy3D
+struct copy_side
+{
+	uint8_t* base;
+	size_t row_pitch;
+	size_t slice_pitch;
+};
+
+static copy_side make_copy_side(cudaArray_t arr, cudaPitchedPtr ptr, cudaPos pos, size_t elem_bytes) noexcept
+{
+	if (arr)
+	{
+		const size_t row_pitch = arr->extent.width * arr->elem_bytes;
+		const size_t slice_pitch = row_pitch * arr->extent.height;
+
+		return { arr->data + pos.x * arr->elem_bytes + pos.y * row_pitch + pos.z * slice_pitch, row_pitch, slice_pitch };
+	}
+
+	const size_t slice_pitch = ptr.pitch * ptr.ysize;
+
+	return { static_cast<uint8_t*>(ptr.ptr) + pos.x * elem_bytes + pos.y * ptr.pitch + pos.z * slice_pitch, ptr.pitch, slice_pitch };
+}
+
+cudaError_t cudaMemcpy3D(const cudaMemcpy3DParms* params) noexcept
+{
+	if (!params || (!params->srcArray && !params->srcPtr.ptr) || (!params->dstArray && !params->dstPtr.ptr))
+		return set_error(cudaErrorInvalidValue);
+
+	const cudaArray_t arr = params->srcArray ? params->srcArray : params->dstArray;
+
+	if (params->srcArray && params->dstArray && params->srcArray->elem_bytes != params->dstArray->elem_bytes)
+		return set_error(cudaErrorInvalidValue);
+
+	//Positions and widths are in elements when an array is involved and in bytes otherwise
+	const size_t elem_bytes = arr ? arr->elem_bytes : 1;
+
+	const copy_side src = make_copy_side(params->srcArray, params->srcPtr, params->srcPos, elem_bytes);
+
+	const copy_side dst = make_copy_side(params->dstArray, params->dstPtr, params->dstPos, elem_bytes);
+
+	const size_t row_bytes = params->extent.width * elem_bytes;
+
+	for (size_t z = 0; z != params->extent.depth; ++z)
+		for (size_t y = 0; y != params->extent.height; ++y)
+			memcpy(dst.base + y * dst.row_pitch + z * dst.slice_pitch, src.base + y * src.row_pitch + z * src.slice_pitch, row_bytes);
+
+	return cudaSuccess;
+}
+
+cudaError_t cudaMemcpy2D(void* dst, size_t dst_pitch, const void* src, size_t src_pitch, size_t width, size_t height, cudaMemcpyKind) noexcept
+{
+	if (width && height && (!dst || !src || width > dst_pitch || width > src_pitch))
+		return set_error(cudaErrorInvalidValue);
+
+	for (size_t y = 0; y != height; ++y)
+		memmove(static_cast<uint8_t*>(dst) + y * dst_pitch, static_cast<const uint8_t*>(src) + y * src_pitch, width);
+
+	return cudaSuccess;
+}
+
+cudaError_t cudaMemcpy2DFromArray(void* dst, size_t dst_pitch, cudaArray_const_t src, size_t w_offset, size_t h_offset, size_t width, size_t height, cudaMemcpyKind) noexcept
+{
+	if (!dst || !src)
+		return set_error(cudaErrorInvalidValue);
+
+	const size_t src_pitch = src->extent.width * src->elem_bytes;
+
+	if (w_offset + width > src_pitch || h_offset + height > src->extent.height * src->extent.depth)
+		return set_error(cudaErrorInvalidValue);
+
+	for (size_t y = 0; y != height; ++y)
+		memcpy(static_cast<uint8_t*>(dst) + y * dst_pitch, src->data + (y + h_offset) * src_pitch + w_offset, width);
+
+	return cudaSuccess;
+}
+
+/*////////////////////////////////////////////////////////////////////////*/
+/*////////////////////////////////SURFACES////////////////////////////////*/
+/*////////////////////////////////////////////////////////////////////////*/
+
+cudaError_t cudaCreateSurfaceObject(cudaSurfaceObject_t* surf, const cudaResourceDesc* res_desc) noexcept
+{
+	if (!surf || !res_desc || res_desc->resType != cudaResourceTypeArray || !res_desc->res.array.array)
+		return set_error(cudaErrorInvalidValue);
+
+	*surf = reinterpret_cast<cudaSurfaceObject_t>(res_desc->res.array.array);
+
+	return cudaSuccess;
+}
+
+cudaError_t cudaDestroySurfaceObject(cudaSurfaceObject_t) noexcept
+{
+	return cudaSuccess;
+}
+
+/*////////////////////////////////////////////////////////////////////////*/
+/*////////////////////////////STREAMS / EVENTS////////////////////////////*/
+/*////////////////////////////////////////////////////////////////////////*/
+
+struct cpu_stream
+{
+	std::mutex mtx;
+	std::condition_variable work_cv;
+	std::condition_variable done_cv;
+
+	std::deque<std::function<void()>> ops;
+
+	//Operations issued and completed so far. Events capture issued and are complete once completed reaches it
+	uint64_t issued = 0;
+	uint64_t completed = 0;
+
+	//First error raised by an operation since the last synchronization
+	cudaError_t error = cudaSuccess;
+
+	bool is_stopping = false;
+
+	std::thread worker;
+};
+
+struct cpu_event
+{
+	cpu_stream* stream;
+
+	uint64_t target;
+};
+
+static std::mutex s_streams_mtx;
+
+static std::vector<cpu_stream*> s_streams;
+
+static void stream_loop(cpu_stream* stream)
+{
+	std::unique_lock<std::mutex> lock(stream->mtx);
+
+	while (true)
+	{
+		stream->work_cv.wait(lock, [stream] { return stream->is_stopping || !stream->ops.empty(); });
+
+		if (stream->ops.empty())
+			return;
+
+		std::function<void()> op = std::move(stream->ops.front());
+
+		stream->ops.pop_front();
+
+		lock.unlock();
+
+		op();
+
+		const cudaError_t err = cudaGetLastError();
+
+		lock.lock();
+
+		if (err != cudaSuccess && stream->error == cudaSuccess)
+			stream->error = err;
+
+		++stream->completed;
+
+		stream->done_cv.notify_all();
+	}
+}
+
+static cudaError_t wait_for_stream(cpu_stream* stream, uint64_t target) noexcept
+{
+	std::unique_lock<std::mutex> lock(stream->mtx);
+
+	stream->done_cv.wait(lock, [&] { return stream->completed >= target; });
+
+	const cudaError_t err = stream->error;
+
+	stream->error = cudaSuccess;
+
+	return set_error(err);
+}
+
+void cpu_backend_enqueue(cudaStream_t stream, std::function<void()> op)
+{
+	if (!stream)
+	{
+		op();
+
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(stream->mtx);
+
+		stream->ops.push_back(std::move(op));
+
+		++stream->issued;
+	}
+
+	stream->work_cv.notify_one();
+}
+
+cudaError_t cudaStreamCreate(cudaStream_t* stream) noexcept
+{
+	if (!stream)
+		return set_error(cudaErrorInvalidValue);
+
+	cpu_stream* s = new(std::nothrow) cpu_stream;
+
+	if (!s)
+		return set_error(cudaErrorMemoryAllocation);
+
+	s->worker = std::thread(stream_loop, s);
+
+	{
+		std::lock_guard<std::mutex> lock(s_streams_mtx);
+
+		s_streams.push_back(s);
+	}
+
+	*stream = s;
+
+	return cudaSuccess;
+}
+
+cudaError_t cudaStreamDestroy(cudaStream_t stream) noexcept
+{
+	if (!stream)
+		return set_error(cudaErrorInvalidResourceHandle);
+
+	{
+		std::lock_guard<std::mutex> lock(s_streams_mtx);
+
+		for (size_t i = 0; i != s_streams.size(); ++i)
+			if (s_streams[i] == stream)
+			{
+				s_streams[i] = s_streams.back();
+
+				s_streams.pop_back();
+
+				break;
+			}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(stream->mtx);
+
+		stream->is_stopping = true;
+	}
+
+	stream->work_cv.notify_one();
+
+	stream->worker.join();
+
+	delete stream;
+
+	return cudaSuccess;
+}
+
+cudaError_t cudaStreamSynchronize(cudaStream_t stream) noexcept
+{
+	if (!stream)
+		return cudaSuccess;
+
+	uint64_t target;
+
+	{
+		std::lock_guard<std::mutex> lock(stream->mtx);
+
+		target = stream->issued;
+	}
+
+	return wait_for_stream(stream, target);
+}
+
+cudaError_t cudaDeviceSynchronize() noexcept
+{
+	std::lock_guard<std::mutex> lock(s_streams_mtx);
+
+	cudaError_t first_err = cudaSuccess;
+
+	for (cpu_stream* stream : s_streams)
+	{
+		const cudaError_t err = cudaStreamSynchronize(stream);
+
+		if (first_err == cudaSuccess)
+			first_err = err;
+	}
+
+	return first_err;
+}
+
+cudaError_t cudaEventCreate(cudaEvent_t* event) noexcept
+{
+	if (!event)
+		return set_error(cudaErrorInvalidValue);
+
+	*event = new(std::nothrow) cpu_event{ nullptr, 0 };
+
+	return *event ? cudaSuccess : set_error(cudaErrorMemoryAllocation);
+}
+
+cudaError_t cudaEventDestroy(cudaEvent_t event) noexcept
+{
+	delete event;
+
+	return cudaSuccess;
+}
+
+cudaError_t cudaEventRecord(cudaEvent_t event, cudaStream_t stream) noexcept
+{
+	if (!event)
+		return set_error(cudaErrorInvalidResourceHandle);
+
+	event->stream = stream;
+
+	if (stream)
+	{
+		std::lock_guard<std::mutex> lock(stream->mtx);
+
+		event->target = stream->issued;
+	}
+
+	return cudaSuccess;
+}
+
+cudaError_t cudaEventQuery(cudaEvent_t event) noexcept
+{
+	if (!event)
+		return set_error(cudaErrorInvalidResourceHandle);
+
+	if (!event->stream)
+		return cudaSuccess;
+
+	std::lock_guard<std::mutex> lock(event->stream->mtx);
+
+	return event->stream->completed >= event->target ? cudaSuccess : cudaErrorNotReady;
+}
+
+cudaError_t cudaEventSynchronize(cudaEvent_t event) noexcept
+{
+	if (!event)
+		return set_error(cudaErrorInvalidResourceHandle);
+
+	if (!event->stream)
+		return cudaSuccess;
+
+	return wait_for_stream(event->stream, event->target);
+}
+
+cudaError_t cudaMallocHost(void** ptr, size_t bytes) noexcept
+{
+	return cudaMalloc(ptr, bytes);
+}
+
+cudaError_t cudaFreeHost(void* ptr) noexcept
+{
+	return cudaFree(ptr);
+}
+
+cudaError_t cudaMemcpyAsync(void* dst, const void* src, size_t bytes, cudaMemcpyKind kind, cudaStream_t stream) noexcept
+{
+	if (bytes && (!dst || !src))
+		return set_error(cudaErrorInvalidValue);
+
+	if (!stream)
+		return cudaMemcpy(dst, src, bytes, kind);
+
+	cpu_backend_enqueue(stream, [=]() { cudaMemcpy(dst, src, bytes, kind); });
+
+	return cudaSuccess;
+}
+
+/*////////////////////////////////////////////////////////////////////////*/
+/*////////////////////////////////EXECUTOR////////////////////////////////*/
+/*////////////////////////////////////////////////////////////////////////*/
+
+static std::atomic<uint32_t> s_max_threads{ 0 };
+
+static std::mutex s_stats_mtx;
+
+static std::vector<cpu_kernel_stats> s_stats;
+
+//Blocks handed to a worker in one go. Keeps per-task overhead low for grids of many small blocks
+static constexpr uint64_t blocks_per_task_min = 4;
+
+//Tasks per participating thread, leaving room for work-stealing to even out uneven blocks
+static constexpr uint64_t tasks_per_thread = 8;
+
+static void record_launch(const char* kernel_name, uint64_t thread_cnt, double seconds)
+{
+	std::lock_guard<std::mutex> lock(s_stats_mtx);
+
+	//Kernel names are string-literals from OCH_LAUNCH, but compare contents in case of duplicates across translation units
+	for (cpu_kernel_stats& s : s_stats)
+		if (s.name == kernel_name || strcmp(s.name, kernel_name) == 0)
+		{
+			++s.launches;
+			s.threads += thread_cnt;
+			s.seconds += seconds;
+
+			return;
+		}
+
+	s_stats.push_back({ kernel_name, 1, thread_cnt, seconds });
+}
+
+void cpu_backend_run_grid(const char* kernel_name, dim3 grid, dim3 block, const std::function<void()>& thread_fn)
+{
+	const uint64_t threads_per_block = static_cast<uint64_t>(block.x) * block.y * block.z;
+
+	const uint64_t block_cnt = static_cast<uint64_t>(grid.x) * grid.y * grid.z;
+
+	//Same limits as a CUDA device of compute capability 3.0 and up
+	if (!threads_per_block || !block_cnt || threads_per_block > 1024 || block.z > 64 || grid.y > 65535 || grid.z > 65535)
+	{
+		set_error(cudaErrorInvalidConfiguration);
+
+		return;
+	}
+
+	OCH_TRACE_SCOPE(kernel_name, { "blocks", block_cnt }, { "threads", block_cnt * threads_per_block });
+
+	const auto beg = std::chrono::steady_clock::now();
+
+	thread_pool& pool = thread_pool::global();
+
+	const uint32_t max_threads = s_max_threads.load(std::memory_order_relaxed);
+
+	const uint64_t thread_cnt = max_threads && max_threads < pool.thread_cnt() ? max_threads : pool.thread_cnt();
+
+	uint64_t blocks_per_task = (block_cnt + thread_cnt * tasks_per_thread - 1) / (thread_cnt * tasks_per_thread);
+
+	if (blocks_per_task < blocks_per_task_min)
+		blocks_per_task = blocks_per_task_min;
+
+	const uint32_t task_cnt = static_cast<uint32_t>((block_cnt + blocks_per_task - 1) / blocks_per_task);
+
+	pool.parallel_for(task_cnt, [&](uint32_t task_idx, uint32_t)
+		{
+			gridDim = grid;
+			blockDim = block;
+
+			const uint64_t block_beg = task_idx * blocks_per_task;
+
+			const uint64_t block_end = block_beg + blocks_per_task < block_cnt ? block_beg + blocks_per_task : block_cnt;
+
+			OCH_TRACE_SCOPE("blocks", { "first_block", block_beg }, { "block_cnt", block_end - block_beg });
+
+			for (uint64_t b = block_beg; b != block_end; ++b)
+			{
+				blockIdx.x = static_cast<uint32_t>(b % grid.x);
+				blockIdx.y = static_cast<uint32_t>(b / grid.x % grid.y);
+				blockIdx.z = static_cast<uint32_t>(b / grid.x / grid.y);
+
+				for (uint32_t z = 0; z != block.z; ++z)
+					for (uint32_t y = 0; y != block.y; ++y)
+						for (uint32_t x = 0; x != block.x; ++x)
+						{
+							threadIdx.x = x;
+							threadIdx.y = y;
+							threadIdx.z = z;
+
+							thread_fn();
+						}
+			}
+		}, static_cast<uint32_t>(thread_cnt));
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - beg).count();
+
+	record_launch(kernel_name, block_cnt * threads_per_block, seconds);
+}
+
+void cpu_backend_set_max_threads(uint32_t max_threads) noexcept
+{
+	s_max_threads.store(max_threads, std::memory_order_relaxed);
+}
+
+uint32_t cpu_backend_thread_cnt() noexcept
+{
+	const uint32_t max_threads = s_max_threads.load(std::memory_order_relaxed);
+
+	const uint32_t pool_threads = thread_pool::global().thread_cnt();
+
+	return max_threads && max_threads < pool_threads ? max_threads : pool_threads;
+}
+
+uint32_t cpu_backend_kernel_stats(cpu_kernel_stats* dst, uint32_t max_cnt)
+{
+	std::lock_guard<std::mutex> lock(s_stats_mtx);
+
+	for (uint32_t i = 0; i != max_cnt && i != s_stats.size(); ++i)
+		dst[i] = s_stats[i];
+
+	return static_cast<uint32_t>(s_stats.size());
+}
+
+void cpu_backend_print_kernel_stats()
+{
+	std::lock_guard<std::mutex> lock(s_stats_mtx);
+
+	printf("CPU backend, %u threads\n", cpu_backend_thread_cnt());
+
+	printf("%-48s %10s %14s %12s %14s\n", "kernel", "launches", "threads", "ms", "Mthreads/s");
+
+	for (const cpu_kernel_stats& s : s_stats)
+		printf("%-48s %10llu %14llu %12.3f %14.2f\n", s.name, static_cast<unsigned long long>(s.launches), static_cast<unsigned long long>(s.threads), s.seconds * 1e3, s.seconds > 0.0 ? s.threads / s.seconds * 1e-6 : 0.0);
+}
+
+void cpu_backend_reset_kernel_stats()
+{
+	std::lock_guard<std::mutex> lock(s_stats_mtx);
+
+	s_stats.clear();
+}
@@ -0,0 +1,462 @@
+#pragma once
+
+//Host-only stand-in for the parts of the CUDA runtime used by this project.
+//With OCH_CPU_BACKEND defined, the .cu files compile as plain C++ (e.g. g++ -x c++ -DOCH_CPU_BACKEND) against this header instead of the CUDA toolkit.
+//Kernels launched through OCH_LAUNCH then run their dim3 grid / block index space on thread_pool::global(), one task per run of blocks.
+//Device memory, pitched allocations and cudaArrays are plain host memory, so pointers can be read directly by the caller.
+//Launches and copies on the default stream complete before they return. Those issued to a stream from cudaStreamCreate run in
+//issue order on a host thread owned by that stream, so the issuing thread continues at once; cudaDeviceSynchronize waits for all streams.
+//__syncthreads and shared memory are not supported, as threads of a block run one after another on the same host thread.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+
+/*////////////////////////////////////////////////////////////////////////*/
+/*////////////////////////////////QUALIFIERS//////////////////////////////*/
+/*////////////////////////////////////////////////////////////////////////*/
+
+#define __global__
+#define __device__
+#define __host__
+#define __constant__
+#define __forceinline__ inline
+
+/*////////////////////////////////////////////////////////////////////////*/
+/*//////////////////////////////VECTOR TYPES//////////////////////////////*/
+/*////////////////////////////////////////////////////////////////////////*/
+
+struct uint2 { uint32_t x, y; };
+struct uint3 { uint32_t x, y, z; };
+struct float2 { float x, y; };
+struct float3 { float x, y, z; };
+struct uchar4 { uint8_t x, y, z, w; };
+
+struct dim3
+{
+	uint32_t x, y, z;
+
+	constexpr dim3(uint32_t vx = 1, uint32_t vy = 1, uint32_t vz = 1) noexcept : x{ vx }, y{ vy }, z{ vz } {}
+
+	constexpr dim3(uint3 v) noexcept : x{ v.x }, y{ v.y }, z{ v.z } {}
+};
+
+inline uint2 make_uint2(uint32_t x, uint32_t y) noexcept { return { x, y }; }
+inline uint3 make_uint3(uint32_t x, uint32_t y, uint32_t z) noexcept { return { x, y, z }; }
+inline float2 make_float2(float x, float y) noexcept { return { x, y }; }
+inline float3 make_float3(float x, float y, float z) noexcept { return { x, y, z }; }
+inline uchar4 make_uchar4(uint8_t x, uint8_t y, uint8_t z, uint8_t w) noexcept { return { x, y, z, w }; }
+
+//Built-in index variables, set by the executor before each simulated thread runs
+extern thread_local uint3 threadIdx;
+extern thread_local uint3 blockIdx;
+extern thread_local dim3 blockDim;
+extern thread_local dim3 gridDim;
+
+inline int __float_as_int(float f) noexcept { int i; memcpy(&i, &f, sizeof(i)); return i; }
+inline float __int_as_float(int i) noexcept { float f; memcpy(&f, &i, sizeof(f)); return f; }
+
+/*////////////////////////////////////////////////////////////////////////*/
+/*/////////////////////////////////ERRORS/////////////////////////////////*/
+/*////////////////////////////////////////////////////////////////////////*/
+
+enum cudaError_t
+{
+	cudaSuccess = 0,
+	cudaErrorInvalidValue = 1,
+	cudaErrorMemoryAllocation = 2,
+	cudaErrorInvalidConfiguration = 9,
+	cudaErrorInvalidResourceHandle = 400,
+	cudaErrorNotReady = 600,
+};
+
+const char* cudaGetErrorName(cudaError_t err) noexcept;
+
+const char* cudaGetErrorString(cudaError_t err) noexcept;
+
+//Returns and clears the last error of the calling thread
+cudaError_t cudaGetLastError() noexcept;
+
+cudaError_t cudaPeekAtLastError() noexcept;
+
+cudaError_t cudaDeviceSynchronize() noexcept;
+
+/*////////////////////////////////////////////////////////////////////////*/
+/*/////////////////////////////////MEMORY/////////////////////////////////*/
+/*////////////////////////////////////////////////////////////////////////*/
+
+enum cudaMemcpyKind
+{
+	cudaMemcpyHostToHost = 0,
+	cudaMemcpyHostToDevice = 1,
+	cudaMemcpyDeviceToHost = 2,
+	cudaMemcpyDeviceToDevice = 3,
+	cudaMemcpyDefault = 4,
+};
+
+struct cudaExtent
+{
+	size_t width, height, depth;
+};
+
+struct cudaPos
+{
+	size_t x, y, z;
+};
+
+//pitch is in bytes, as with the CUDA runtime
+struct cudaPitchedPtr
+{
+	void* ptr;
+	size_t pitch;
+	size_t xsize;
+	size_t ysize;
+};
+
+inline cudaExtent make_cudaExtent(size_t w, size_t h, size_t d) noexcept { return { w, h, d }; }
+inline cudaPos make_cudaPos(size_t x, size_t y, size_t z) noexcept { return { x, y, z }; }
+inline cudaPitchedPtr make_cudaPitchedPtr(void* ptr, size_t pitch, size_t xsize, size_t ysize) noexcept { return { ptr, pitch, xsize, ysize }; }
+
+enum cudaChannelFormatKind
+{
+	cudaChannelFormatKindSigned = 0,
+	cudaChannelFormatKindUnsigned = 1,
+	cudaChannelFormatKindFloat = 2,
+};
+
+struct cudaChannelFormatDesc
+{
+	int x, y, z, w;
+	cudaChannelFormatKind f;
+};
+
+template<typename T>
+cudaChannelFormatDesc cudaCreateChannelDesc() noexcept
+{
+	return { static_cast<int>(sizeof(T) * 8), 0, 0, 0, T(-1) < T(0) ? cudaChannelFormatKindSigned : cudaChannelFormatKindUnsigned };
+}
+
+template<>
+inline cudaChannelFormatDesc cudaCreateChannelDesc<float>() noexcept
+{
+	return { 32, 0, 0, 0, cudaChannelFormatKindFloat };
+}
+
+template<>
+inline cudaChannelFormatDesc cudaCreateChannelDesc<uchar4>() noexcept
+{
+	return { 8, 8, 8, 8, cudaChannelFormatKindUnsigned };
+}
+
+//Dense host array of depth slices of height rows of width elements
+struct cudaArray
+{
+	uint8_t* data;
+	cudaExtent extent;
+	size_t elem_bytes;
+	cudaChannelFormatDesc desc;
+};
+
+using cudaArray_t = cudaArray*;
+using cudaArray_const_t = const cudaArray*;
+
+enum
+{
+	cudaArrayDefault = 0,
+	cudaArraySurfaceLoadStore = 2,
+};
+
+cudaError_t cudaMalloc(void** ptr, size_t bytes) noexcept;
+
+template<typename T>
+cudaError_t cudaMalloc(T** ptr, size_t bytes) noexcept
+{
+	return cudaMalloc(reinterpret_cast<void**>(ptr), bytes);
+}
+
+cudaError_t cudaFree(void* ptr) noexcept;
+
+//Rows are padded to a multiple of 64 bytes, so each row starts on its own cache line
+cudaError_t cudaMalloc3D(cudaPitchedPtr* pitched_ptr, cudaExtent extent) noexcept;
+
+cudaError_t cudaMalloc3DArray(cudaArray_t* arr, const cudaChannelFormatDesc* desc, cudaExtent extent, unsigned int flags = 0) noexcept;
+
+cudaError_t cudaMallocArray(cudaArray_t* arr, const cudaChannelFormatDesc* desc, size_t width, size_t height = 0, unsigned int flags = 0) noexcept;
+
+cudaError_t cudaFreeArray(cudaArray_t arr) noexcept;
+
+cudaError_t cudaMemcpy(void* dst, const void* src, size_t bytes, cudaMemcpyKind kind) noexcept;
+
+cudaError_t cudaMemset(void* dst, int value, size_t bytes) noexcept;
+
+struct cudaMemcpy3DParms
+{
+	cudaArray_t srcArray;
+	cudaPos srcPos;
+	cudaPitchedPtr srcPtr;
+	cudaArray_t dstArray;
+	cudaPos dstPos;
+	cudaPitchedPtr dstPtr;
+	cudaExtent extent;
+	cudaMemcpyKind kind;
+};
+
+//extent.width is in elements if an array is involved and in bytes otherwise, as with the CUDA runtime
+cudaError_t cudaMemcpy3D(const cudaMemcpy3DParms* params) noexcept;
+
+//Copies height rows of width bytes between pitched buffers
+cudaError_t cudaMemcpy2D(void* dst, size_t dst_pitch, const void* src, size_t src_pitch, size_t width, size_t height, cudaMemcpyKind kind) noexcept;
+
+cudaError_t cudaMemcpy2DFromArray(void* dst, size_t dst_pitch, cudaArray_const_t src, size_t w_offset, size_t h_offset, size_t width, size_t height, cudaMemcpyKind kind) noexcept;
+
+/*////////////////////////////////////////////////////////////////////////*/
+/*////////////////////////////TEXTURES / SURFACES/////////////////////////*/
+/*////////////////////////////////////////////////////////////////////////*/
+
+enum
+{
+	cudaTextureType1D = 0x01,
+	cudaTextureType2D = 0x02,
+	cudaTextureType3D = 0x03,
+};
+
+enum cudaTextureReadMode
+{
+	cudaReadModeElementType = 0,
+	cudaReadModeNormalizedFloat = 1,
+};
+
+enum cudaTextureFilterMode
+{
+	cudaFilterModePoint = 0,
+	cudaFilterModeLinear = 1,
+};
+
+enum cudaTextureAddressMode
+{
+	cudaAddressModeWrap = 0,
+	cudaAddressModeClamp = 1,
+	cudaAddressModeMirror = 2,
+	cudaAddressModeBorder = 3,
+};
+
+//Texture reference. Only unnormalized point sampling with clamp or border addressing is emulated
+template<typename T, int dim = cudaTextureType1D, cudaTextureReadMode mode = cudaReadModeElementType>
+struct texture
+{
+	int normalized = 0;
+	cudaTextureFilterMode filterMode = cudaFilterModePoint;
+	cudaTextureAddressMode addressMode[3]{};
+	cudaArray_const_t array = nullptr;
+};
+
+template<typename T, int dim, cudaTextureReadMode mode>
+cudaError_t cudaBindTextureToArray(texture<T, dim, mode>* tex, cudaArray_const_t arr, const cudaChannelFormatDesc*) noexcept
+{
+	if (!tex || !arr || arr->elem_bytes != sizeof(T))
+		return cudaErrorInvalidValue;
+
+	tex->array = arr;
+
+	return cudaSuccess;
+}
+
+template<typename T, int dim, cudaTextureReadMode mode>
+cudaError_t cudaUnbindTexture(texture<T, dim, mode>* tex) noexcept
+{
+	tex->array = nullptr;
+
+	return cudaSuccess;
+}
+
+template<typename T, int dim, cudaTextureReadMode mode>
+T tex3D(const texture<T, dim, mode>& tex, float x, float y, float z) noexcept
+{
+	const cudaArray* arr = tex.array;
+
+	int64_t ix = static_cast<int64_t>(x >= 0.0F ? x : x - 1.0F);
+	int64_t iy = static_cast<int64_t>(y >= 0.0F ? y : y - 1.0F);
+	int64_t iz = static_cast<int64_t>(z >= 0.0F ? z : z - 1.0F);
+
+	const int64_t w = static_cast<int64_t>(arr->extent.width);
+	const int64_t h = static_cast<int64_t>(arr->extent.height);
+	const int64_t d = static_cast<int64_t>(arr->extent.depth);
+
+	if (tex.addressMode[0] == cudaAddressModeBorder)
+	{
+		if (ix < 0 || iy < 0 || iz < 0 || ix >= w || iy >= h || iz >= d)
+			return T{};
+	}
+	else
+	{
+		ix = ix < 0 ? 0 : ix >= w ? w - 1 : ix;
+		iy = iy < 0 ? 0 : iy >= h ? h - 1 : iy;
+		iz = iz < 0 ? 0 : iz >= d ? d - 1 : iz;
+	}
+
+	T val;
+
+	memcpy(&val, arr->data + (ix + iy * w + iz * w * h) * sizeof(T), sizeof(T));
+
+	return val;
+}
+
+//Handle to a host-side surface, which is a pointer to its cudaArray
+using cudaSurfaceObject_t = uint64_t;
+
+enum cudaResourceType
+{
+	cudaResourceTypeArray = 0,
+};
+
+struct cudaResourceDesc
+{
+	cudaResourceType resType;
+
+	union
+	{
+		struct
+		{
+			cudaArray_t array;
+		} array;
+	} res;
+};
+
+enum cudaSurfaceBoundaryMode
+{
+	cudaBoundaryModeZero = 0,
+	cudaBoundaryModeClamp = 1,
+	cudaBoundaryModeTrap = 2,
+};
+
+cudaError_t cudaCreateSurfaceObject(cudaSurfaceObject_t* surf, const cudaResourceDesc* res_desc) noexcept;
+
+cudaError_t cudaDestroySurfaceObject(cudaSurfaceObject_t surf) noexcept;
+
+//x is in bytes, as with the CUDA runtime. Out-of-bounds writes are dropped
+template<typename T>
+void surf2Dwrite(T data, cudaSurfaceObject_t surf, int x, int y, cudaSurfaceBoundaryMode = cudaBoundaryModeTrap) noexcept
+{
+	cudaArray* arr = reinterpret_cast<cudaArray*>(surf);
+
+	const size_t row_bytes = arr->extent.width * arr->elem_bytes;
+
+	if (x < 0 || y < 0 || static_cast<size_t>(x) + sizeof(T) > row_bytes || static_cast<size_t>(y) >= arr->extent.height)
+		return;
+
+	memcpy(arr->data + static_cast<size_t>(y) * row_bytes + x, &data, sizeof(T));
+}
+
+/*////////////////////////////////////////////////////////////////////////*/
+/*////////////////////////////STREAMS / EVENTS////////////////////////////*/
+/*////////////////////////////////////////////////////////////////////////*/
+
+struct cpu_stream;
+
+//nullptr is the default stream
+using cudaStream_t = cpu_stream*;
+
+struct cpu_event;
+
+using cudaEvent_t = cpu_event*;
+
+cudaError_t cudaStreamCreate(cudaStream_t* stream) noexcept;
+
+//Waits for the work still queued on stream
+cudaError_t cudaStreamDestroy(cudaStream_t stream) noexcept;
+
+//Waits for the work queued on stream and returns the first error raised by it since the last synchronization
+cudaError_t cudaStreamSynchronize(cudaStream_t stream) noexcept;
+
+cudaError_t cudaEventCreate(cudaEvent_t* event) noexcept;
+
+cudaError_t cudaEventDestroy(cudaEvent_t event) noexcept;
+
+//Captures the work issued to stream so far. The stream must outlive the event's last query
+cudaError_t cudaEventRecord(cudaEvent_t event, cudaStream_t stream = nullptr) noexcept;
+
+//cudaErrorNotReady while work captured by the last cudaEventRecord is still pending. Does not set the last error
+cudaError_t cudaEventQuery(cudaEvent_t event) noexcept;
+
+cudaError_t cudaEventSynchronize(cudaEvent_t event) noexcept;
+
+//Page-locked memory is plain host memory here
+cudaError_t cudaMallocHost(void** ptr, size_t bytes) noexcept;
+
+template<typename T>
+cudaError_t cudaMallocHost(T** ptr, size_t bytes) noexcept
+{
+	return cudaMallocHost(reinterpret_cast<void**>(ptr), bytes);
+}
+
+cudaError_t cudaFreeHost(void* ptr) noexcept;
+
+cudaError_t cudaMemcpyAsync(void* dst, const void* src, size_t bytes, cudaMemcpyKind kind, cudaStream_t stream = nullptr) noexcept;
+
+//Queues op on stream, or runs it right away on the default stream
+void cpu_backend_enqueue(cudaStream_t stream, std::function<void()> op);
+
+/*////////////////////////////////////////////////////////////////////////*/
+/*////////////////////////////////EXECUTOR////////////////////////////////*/
+/*////////////////////////////////////////////////////////////////////////*/
+
+//Runs thread_fn once for every thread of the grid, setting the built-in index variables beforehand.
+//Blocks are spread over thread_pool::global(); threads inside a block run in x-fastest order on the same host thread.
+//Sets cudaErrorInvalidConfiguration, without running anything, for configurations CUDA would reject.
+void cpu_backend_run_grid(const char* kernel_name, dim3 grid, dim3 block, const std::function<void()>& thread_fn);
+
+//Caps the number of host threads used per launch, 0 meaning all threads of the pool
+void cpu_backend_set_max_threads(uint32_t max_threads) noexcept;
+
+uint32_t cpu_backend_thread_cnt() noexcept;
+
+//Accumulated per-kernel launch statistics, collected for every launch through OCH_LAUNCH
+struct cpu_kernel_stats
+{
+	const char* name;
+	uint64_t launches;
+	uint64_t threads;
+	double seconds;
+};
+
+//Copies up to max_cnt entries into dst and returns the number of kernels launched so far
+uint32_t cpu_backend_kernel_stats(cpu_kernel_stats* dst, uint32_t max_cnt);
+
+//Prints launches, simulated threads, time and threads per second for every kernel launched so far
+void cpu_backend_print_kernel_stats();
+
+void cpu_backend_reset_kernel_stats();
+
+template<typename... Params>
+struct cpu_launcher
+{
+	void (*kernel)(Params...);
+	const char* name;
+	dim3 grid;
+	dim3 block;
+	cudaStream_t stream;
+
+	//Launches on a stream keep copies of args, as they run after the caller has moved on
+	template<typename... Args>
+	void operator()(Args&&... args) const
+	{
+		if (!stream)
+		{
+			cpu_backend_run_grid(name, grid, block, [&]() { kernel(args...); });
+
+			return;
+		}
+
+		cpu_backend_enqueue(stream, [kernel = kernel, name = name, grid = grid, block = block, args...]()
+			{
+				cpu_backend_run_grid(name, grid, block, [&]() { kernel(args...); });
+			});
+	}
+};
+
+template<typename... Params>
+cpu_launcher<Params...> cpu_backend_launch(void (*kernel)(Params...), const char* name, dim3 grid, dim3 block, cudaStream_t stream = nullptr) noexcept
+{
+	return { kernel, name, grid, block, stream };
+}
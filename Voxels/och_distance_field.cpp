@@ -0,0 +1,359 @@
+#include "och_distance_field.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "och_thread_pool.h"
+#include "och_trace.h"
+
+//Columns transformed together, filling a 64-byte cache line of distances. Divides 64, so a block never straddles a packed word
+static constexpr uint32_t column_block = 16;
+
+//Buffers for the columns of one task: a block of columns of the longest length, and the sites of one run plus the two bordering it
+struct edt_scratch
+{
+	std::vector<uint32_t> f;
+	std::vector<uint8_t> state;
+	std::vector<int64_t> site_pos;
+	std::vector<int64_t> site_g;
+	std::vector<int64_t> starts;
+
+	explicit edt_scratch(uint32_t n) : f(n * column_block), state(n * column_block), site_pos(n + 2), site_g(n + 2), starts(n + 2) {}
+};
+
+//Squared distance from every voxel of a row to the closest voxel of the other state in the same row. Transitions between
+//states are found a word at a time, and every run between two of them is filled from its ends
+static void row_distances(uint32_t* dst, const uint64_t* row, uint32_t row_words, uint32_t x_cnt, uint64_t tail_mask, std::vector<uint32_t>& edges)
+{
+	edges.clear();
+
+	//Bit x of transitions is set if voxel x differs from voxel x - 1. Seeding the carry with voxel 0 leaves x = 0 clear
+	uint64_t carry = row[0] & 1;
+
+	for (uint32_t w = 0; w != row_words; ++w)
+	{
+		const uint64_t v = row[w];
+
+		uint64_t transitions = v ^ ((v << 1) | carry);
+
+		carry = v >> 63;
+
+		if (w + 1 == row_words)
+			transitions &= tail_mask;
+
+		while (transitions)
+		{
+			edges.push_back(w * 64 + ctz64(transitions));
+
+			transitions &= transitions - 1;
+		}
+	}
+
+	edges.push_back(x_cnt);
+
+	uint32_t run_beg = 0;
+
+	for (const uint32_t run_end : edges)
+	{
+		//The voxels just outside the run are of the other state, unless the run reaches the end of the row
+		const bool has_lo = run_beg != 0;
+		const bool has_hi = run_end != x_cnt;
+
+		for (uint32_t x = run_beg; x != run_end; ++x)
+		{
+			uint32_t d = edt_infinite;
+
+			if (has_lo)
+				d = x - run_beg + 1;
+
+			if (has_hi && run_end - x < d)
+				d = run_end - x;
+
+			dst[x] = d == edt_infinite ? edt_infinite : d * d;
+		}
+
+		run_beg = run_end;
+	}
+}
+
+//Lower envelope of the parabolas (x - i)^2 + g(i) (Felzenszwalb and Huttenlocher), evaluated over the run [beg, end) of a column of
+//n voxels of one state and written back to f. The sites are the voxels of the run, with g(i) = f[i] from the previous passes
+//unless that is infinite, and the voxels of the other state on either side of the run, with g(i) = 0. Sites of other runs of the
+//same state never win, as one of these two lies between them and the run. Every site is pushed and popped at most once
+static void envelope(uint32_t* f, uint32_t beg, uint32_t end, uint32_t n, edt_scratch& scratch) noexcept
+{
+	int64_t* const site_pos = scratch.site_pos.data();
+	int64_t* const site_g = scratch.site_g.data();
+
+	//site_pos[k] is lowest on [starts[k], starts[k + 1])
+	int64_t* const starts = scratch.starts.data();
+
+	int64_t top = -1;
+
+	const auto push = [&](int64_t u, int64_t g) noexcept
+	{
+		while (top >= 0)
+		{
+			const int64_t d_top = starts[top] - site_pos[top];
+			const int64_t d_u = starts[top] - u;
+
+			if (d_top * d_top + site_g[top] <= d_u * d_u + g)
+				break;
+
+			--top;
+		}
+
+		if (top < 0)
+		{
+			top = 0;
+
+			site_pos[0] = u;
+			site_g[0] = g;
+			starts[0] = beg;
+
+			return;
+		}
+
+		//Last x at which the parabola of the top site is not above that of u. It is at least starts[top], so integer division floors
+		const int64_t i = site_pos[top];
+
+		const int64_t sep = (u * u - i * i + g - site_g[top]) / (2 * (u - i));
+
+		if (sep + 1 < end)
+		{
+			++top;
+
+			site_pos[top] = u;
+			site_g[top] = g;
+			starts[top] = sep + 1;
+		}
+	};
+
+	if (beg != 0)
+		push(static_cast<int64_t>(beg) - 1, 0);
+
+	for (uint32_t u = beg; u != end; ++u)
+		if (f[u] != edt_infinite)
+			push(u, f[u]);
+
+	if (end != n)
+		push(end, 0);
+
+	if (top < 0)
+		return;
+
+	for (int64_t x = end; x-- != beg;)
+	{
+		const int64_t d = x - site_pos[top];
+
+		f[x] = static_cast<uint32_t>(d * d + site_g[top]);
+
+		if (x == starts[top])
+			--top;
+	}
+}
+
+//Transforms cnt <= column_block adjacent columns of n voxels at once, starting at x within the same packed word. Column c starts at
+//dst + c and its entries are stride apart, so gathering and scattering them touches whole cache lines. Voxel i of the columns lies
+//in the packed row first_row + i * row_stride. Every column is then handled one run of equal voxels at a time
+static void transform_columns(uint32_t* dst, size_t stride, uint32_t n, const uint64_t* first_row, size_t row_stride, uint32_t x, uint32_t cnt, edt_scratch& scratch) noexcept
+{
+	const uint32_t word = x >> 6;
+
+	const uint32_t bit = x & 63;
+
+	uint32_t* const f = scratch.f.data();
+
+	uint8_t* const state = scratch.state.data();
+
+	for (uint32_t i = 0; i != n; ++i)
+	{
+		const uint32_t* const src = dst + i * stride;
+
+		const uint64_t bits = first_row[i * row_stride + word] >> bit;
+
+		for (uint32_t c = 0; c != cnt; ++c)
+		{
+			f[c * n + i] = src[c];
+
+			state[c * n + i] = static_cast<uint8_t>((bits >> c) & 1);
+		}
+	}
+
+	for (uint32_t c = 0; c != cnt; ++c)
+	{
+		uint32_t* const column_f = f + c * n;
+
+		const uint8_t* const column_state = state + c * n;
+
+		uint32_t run_beg = 0;
+
+		for (uint32_t i = 1; i <= n; ++i)
+			if (i == n || column_state[i] != column_state[run_beg])
+			{
+				envelope(column_f, run_beg, i, n, scratch);
+
+				run_beg = i;
+			}
+	}
+
+	for (uint32_t i = 0; i != n; ++i)
+	{
+		uint32_t* const out = dst + i * stride;
+
+		for (uint32_t c = 0; c != cnt; ++c)
+			out[c] = f[c * n + i];
+	}
+}
+
+void distance_transform_sq(uint32_t* dst, const bit_volume& occupancy, uint32_t max_threads)
+{
+	OCH_TRACE_SCOPE("distance_transform_sq", { "x_cnt", occupancy.x_cnt() }, { "y_cnt", occupancy.y_cnt() }, { "z_cnt", occupancy.z_cnt() });
+
+	const uint32_t x_cnt = occupancy.x_cnt();
+	const uint32_t y_cnt = occupancy.y_cnt();
+	const uint32_t z_cnt = occupancy.z_cnt();
+
+	if (x_cnt == 0 || y_cnt == 0 || z_cnt == 0)
+		return;
+
+	const uint32_t row_words = occupancy.row_words();
+
+	const uint64_t tail_mask = x_cnt % 64 ? (1ULL << (x_cnt % 64)) - 1 : ~0ULL;
+
+	const size_t slice = static_cast<size_t>(x_cnt) * y_cnt;
+
+	thread_pool& pool = thread_pool::global();
+
+	//Along x, one slice per task
+	pool.parallel_for(z_cnt, [&](uint32_t z, uint32_t)
+		{
+			std::vector<uint32_t> edges;
+
+			for (uint32_t y = 0; y != y_cnt; ++y)
+				row_distances(dst + y * x_cnt + z * slice, occupancy.row(y, z), row_words, x_cnt, tail_mask, edges);
+		}, max_threads);
+
+	//Along y, the columns of one slice per task
+	if (y_cnt > 1)
+		pool.parallel_for(z_cnt, [&](uint32_t z, uint32_t)
+			{
+				edt_scratch scratch(y_cnt);
+
+				for (uint32_t x = 0; x < x_cnt; x += column_block)
+					transform_columns(dst + x + z * slice, x_cnt, y_cnt, occupancy.row(0, z), row_words, x, std::min(column_block, x_cnt - x), scratch);
+			}, max_threads);
+
+	//Along z, the columns of one row of every slice per task
+	if (z_cnt > 1)
+		pool.parallel_for(y_cnt, [&](uint32_t y, uint32_t)
+			{
+				edt_scratch scratch(z_cnt);
+
+				for (uint32_t x = 0; x < x_cnt; x += column_block)
+					transform_columns(dst + x + static_cast<size_t>(y) * x_cnt, slice, z_cnt, occupancy.row(y, 0), static_cast<size_t>(row_words) * y_cnt, x, std::min(column_block, x_cnt - x), scratch);
+			}, max_threads);
+}
+
+//Calls fn(dst_idx, distance, occupied) for every voxel, spreading slices over the threads
+template<typename Fn>
+static void for_each_distance(const bit_volume& occupancy, uint32_t max_threads, Fn&& fn)
+{
+	const uint32_t x_cnt = occupancy.x_cnt();
+	const uint32_t y_cnt = occupancy.y_cnt();
+
+	std::vector<uint32_t> dist_sq(static_cast<size_t>(x_cnt) * y_cnt * occupancy.z_cnt());
+
+	distance_transform_sq(dist_sq.data(), occupancy, max_threads);
+
+	thread_pool::global().parallel_for(occupancy.z_cnt(), [&](uint32_t z, uint32_t)
+		{
+			for (uint32_t y = 0; y != y_cnt; ++y)
+			{
+				const uint64_t* const row = occupancy.row(y, z);
+
+				const size_t base = (y + static_cast<size_t>(z) * y_cnt) * x_cnt;
+
+				for (uint32_t x = 0; x != x_cnt; ++x)
+				{
+					const uint32_t d = dist_sq[base + x];
+
+					const float dist = d == edt_infinite ? std::numeric_limits<float>::infinity() : std::sqrt(static_cast<float>(d)) - 0.5F;
+
+					fn(base + x, dist, ((row[x >> 6] >> (x & 63)) & 1) != 0);
+				}
+			}
+		}, max_threads);
+}
+
+void signed_distance(float* dst, const bit_volume& occupancy, float band, uint32_t max_threads)
+{
+	const float limit = band > 0.0F ? band : std::numeric_limits<float>::infinity();
+
+	for_each_distance(occupancy, max_threads, [=](size_t idx, float dist, bool occupied) noexcept
+		{
+			dist = dist < limit ? dist : limit;
+
+			dst[idx] = occupied ? -dist : dist;
+		});
+}
+
+void signed_distance_uint8(uint8_t* dst, const bit_volume& occupancy, float band, uint32_t max_threads)
+{
+	const float scale = 127.5F / band;
+
+	//round(127.5 +- offset), with offset > 0 as distances are at least half a voxel, so no voxel rounds onto the other side
+	for_each_distance(occupancy, max_threads, [=](size_t idx, float dist, bool occupied) noexcept
+		{
+			const float offset = dist < band ? dist * scale : 127.5F;
+
+			dst[idx] = static_cast<uint8_t>(occupied ? 128.0F - std::ceil(offset) : 128.0F + std::floor(offset));
+		});
+}
+
+void signed_distance_chunked(chunked_volume& dst, chunk_coord beg, const bit_volume& occupancy, float band, uint32_t max_threads)
+{
+	constexpr uint32_t chunk_dim = chunked_volume::chunk_dim;
+
+	const uint32_t x_cnt = occupancy.x_cnt();
+	const uint32_t y_cnt = occupancy.y_cnt();
+	const uint32_t z_cnt = occupancy.z_cnt();
+
+	std::vector<uint8_t> dense(static_cast<size_t>(x_cnt) * y_cnt * z_cnt);
+
+	signed_distance_uint8(dense.data(), occupancy, band, max_threads);
+
+	const chunk_coord cnt{
+		static_cast<int32_t>((x_cnt + chunk_dim - 1) / chunk_dim),
+		static_cast<int32_t>((y_cnt + chunk_dim - 1) / chunk_dim),
+		static_cast<int32_t>((z_cnt + chunk_dim - 1) / chunk_dim) };
+
+	dst.generate(beg, cnt, [&](chunk_coord coord, uint8_t* out)
+		{
+			const uint32_t x0 = static_cast<uint32_t>(coord.x - beg.x) * chunk_dim;
+			const uint32_t y0 = static_cast<uint32_t>(coord.y - beg.y) * chunk_dim;
+			const uint32_t z0 = static_cast<uint32_t>(coord.z - beg.z) * chunk_dim;
+
+			const uint32_t w = x_cnt - x0 < chunk_dim ? x_cnt - x0 : chunk_dim;
+
+			for (uint32_t z = 0; z != chunk_dim; ++z)
+				for (uint32_t y = 0; y != chunk_dim; ++y)
+				{
+					uint8_t* const out_row = out + (y + z * chunk_dim) * chunk_dim;
+
+					if (y0 + y >= y_cnt || z0 + z >= z_cnt)
+					{
+						memset(out_row, 255, chunk_dim);
+
+						continue;
+					}
+
+					memcpy(out_row, dense.data() + x0 + (y0 + y + static_cast<size_t>(z0 + z) * y_cnt) * x_cnt, w);
+
+					memset(out_row + w, 255, chunk_dim - w);
+				}
+		}, max_threads);
+}
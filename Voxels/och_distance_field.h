@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+#include "och_bit_volume.h"
+#include "och_chunked_volume.h"
+
+//Marks voxels with no voxel of the other state anywhere in the volume in the output of distance_transform_sq
+static constexpr uint32_t edt_infinite = 0xFFFF'FFFF;
+
+//Exact squared Euclidean distance, in voxels, from every voxel of occupancy to the closest voxel of the other state, i.e. to the
+//closest empty voxel for occupied voxels and to the closest occupied voxel for empty ones. Voxels outside the volume are ignored.
+//dst is x-major with x_cnt * y_cnt * z_cnt entries. The transform is separable: rows first get the distance along x from the
+//runs between state transitions, then every column along y and every column along z takes the lower envelope of one parabola
+//per voxel (Felzenszwalb and Huttenlocher), which is linear in the length of the column. As a voxel of the other state always lies
+//between a run and the other runs of its state, every run of a column is solved on its own from its voxels and the two bordering
+//it, so one buffer serves both states.
+//Rows and columns of each pass are spread over the threads of thread_pool::global(), max_threads capping their number (0 meaning no cap).
+void distance_transform_sq(uint32_t* dst, const bit_volume& occupancy, uint32_t max_threads = 0);
+
+//Signed distance field in voxels: negative inside occupied voxels and positive outside, from the distance between voxel centres
+//minus half a voxel, so that the surface lies halfway between an occupied and an empty voxel. A sphere of radius |d| + 0.5 - sqrt(3) / 2
+//around a voxel centre touches no voxel of the other state, which lets sphere tracing skip empty space in large steps.
+//Values are clamped to [-band, band], except for band 0 which leaves them unclamped (and infinite where the other state is absent).
+//occupancy comes from density such as d_simplex_3d_uint8_t by packing it with pack_bits_rows.
+void signed_distance(float* dst, const bit_volume& occupancy, float band = 0.0F, uint32_t max_threads = 0);
+
+//Quantizes the signed distance clamped to [-band, band] to uint8_t as round(127.5 + d * 127.5 / band), so 0 is at least band inside
+//and 255 at least band outside the surface. Every occupied voxel maps below 128 and every empty one to 128 or above. band must be positive.
+void signed_distance_uint8(uint8_t* dst, const bit_volume& occupancy, float band, uint32_t max_threads = 0);
+
+//Stores the quantized signed distance of signed_distance_uint8 in the chunks from beg covering the volume, with voxel (x, y, z)
+//at (beg.x * chunk_dim + x, ...) of dst. Voxels of those chunks beyond the volume are set to 255, so with a background of 255
+//chunks that lie entirely a band away from the surface collapse and are not stored.
+void signed_distance_chunked(chunked_volume& dst, chunk_coord beg, const bit_volume& occupancy, float band, uint32_t max_threads = 0);
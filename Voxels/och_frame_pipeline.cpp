@@ -0,0 +1,151 @@
+#include "och_frame_pipeline.h"
+
+#include <chrono>
+#include <cstring>
+
+headless_swapchain::headless_swapchain(uint32_t width, uint32_t height, uint32_t frame_cnt, uint32_t present_interval_us) :
+	m_width{ width },
+	m_height{ height },
+	m_frame_cnt{ frame_cnt < frames_in_flight_min ? frames_in_flight_min : frame_cnt > frames_in_flight_max ? frames_in_flight_max : frame_cnt },
+	m_present_interval_us{ present_interval_us },
+	m_buffers(static_cast<size_t>(width) * height * m_frame_cnt),
+	m_front(static_cast<size_t>(width) * height)
+{
+	m_presenter = std::thread(&headless_swapchain::presenter_loop, this);
+}
+
+headless_swapchain::~headless_swapchain()
+{
+	wait_for_idle();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+
+		m_is_stopping = true;
+	}
+
+	m_queued_cv.notify_one();
+
+	m_presenter.join();
+}
+
+uint32_t headless_swapchain::frame_cnt() const noexcept
+{
+	return m_frame_cnt;
+}
+
+uint32_t headless_swapchain::width() const noexcept
+{
+	return m_width;
+}
+
+uint32_t headless_swapchain::height() const noexcept
+{
+	return m_height;
+}
+
+size_t headless_swapchain::pitch() const noexcept
+{
+	return static_cast<size_t>(m_width) * sizeof(uint32_t);
+}
+
+uint32_t headless_swapchain::current_backbuffer_index() const noexcept
+{
+	return m_curr_backbuffer;
+}
+
+uint32_t* headless_swapchain::backbuffer(uint32_t idx) noexcept
+{
+	return m_buffers.data() + static_cast<size_t>(idx) * m_width * m_height;
+}
+
+const uint32_t* headless_swapchain::front_buffer() const noexcept
+{
+	return m_front.data();
+}
+
+uint64_t headless_swapchain::present()
+{
+	std::unique_lock<std::mutex> lock(m_mtx);
+
+	m_completed_cv.wait(lock, [this] { return m_queued_value - m_completed_value < m_frame_cnt; });
+
+	const uint64_t value = ++m_queued_value;
+
+	m_curr_backbuffer = m_curr_backbuffer + 1 == m_frame_cnt ? 0 : m_curr_backbuffer + 1;
+
+	lock.unlock();
+
+	m_queued_cv.notify_one();
+
+	return value;
+}
+
+uint64_t headless_swapchain::completed_value() const noexcept
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+
+	return m_completed_value;
+}
+
+void headless_swapchain::wait_for_value(uint64_t value)
+{
+	std::unique_lock<std::mutex> lock(m_mtx);
+
+	m_completed_cv.wait(lock, [&] { return m_completed_value >= value; });
+}
+
+void headless_swapchain::wait_for_idle()
+{
+	std::unique_lock<std::mutex> lock(m_mtx);
+
+	m_completed_cv.wait(lock, [this] { return m_completed_value == m_queued_value; });
+}
+
+void headless_swapchain::presenter_loop()
+{
+	const std::chrono::microseconds interval(m_present_interval_us);
+
+	std::chrono::steady_clock::time_point next_vblank = std::chrono::steady_clock::now();
+
+	while (true)
+	{
+		uint64_t value;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mtx);
+
+			m_queued_cv.wait(lock, [this] { return m_is_stopping || m_queued_value != m_completed_value; });
+
+			if (m_queued_value == m_completed_value)
+				return;
+
+			value = m_completed_value + 1;
+		}
+
+		//A frame queued after a missed vblank goes out at the next one on the same cadence, as with vsync
+		if (m_present_interval_us)
+		{
+			const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+			if (next_vblank < now)
+				next_vblank += (now - next_vblank + interval - std::chrono::nanoseconds(1)) / interval * interval;
+
+			std::this_thread::sleep_until(next_vblank);
+
+			next_vblank += interval;
+		}
+
+		const uint32_t idx = static_cast<uint32_t>((value - 1) % m_frame_cnt);
+
+		memcpy(m_front.data(), backbuffer(idx), pitch() * m_height);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+
+			m_completed_value = value;
+		}
+
+		m_completed_cv.notify_all();
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Bounds for the number of frames in flight, i.e. swapchain buffers that can each be generated or queued for presentation
+//while the others are busy
+static constexpr uint32_t frames_in_flight_min = 2;
+
+static constexpr uint32_t frames_in_flight_max = 4;
+
+//Host stand-in for a flip-model swapchain together with the fence its command queue signals after each Present.
+//Allows the frame pipeline of render_data to be run and benchmarked without D3D12. Pixels are 0xAARRGGBB.
+//present() only queues the current backbuffer. A presenter thread takes queued backbuffers in order, waits for the next
+//emulated vblank, copies the backbuffer to the front buffer and then signals the fence with the value present() returned
+struct headless_swapchain
+{
+	//frame_cnt is clamped to [frames_in_flight_min, frames_in_flight_max]. A present_interval_us of 0 presents without
+	//waiting for vblanks
+	headless_swapchain(uint32_t width, uint32_t height, uint32_t frame_cnt, uint32_t present_interval_us = 0);
+
+	//Waits for all queued presents
+	~headless_swapchain();
+
+	headless_swapchain(const headless_swapchain&) = delete;
+
+	headless_swapchain& operator=(const headless_swapchain&) = delete;
+
+	uint32_t frame_cnt() const noexcept;
+
+	uint32_t width() const noexcept;
+
+	uint32_t height() const noexcept;
+
+	//Bytes between rows of the backbuffers and the front buffer
+	size_t pitch() const noexcept;
+
+	//Backbuffer to render the next frame into, cycling through [0, frame_cnt) like IDXGISwapChain3::GetCurrentBackBufferIndex
+	uint32_t current_backbuffer_index() const noexcept;
+
+	uint32_t* backbuffer(uint32_t idx) noexcept;
+
+	//Only consistent while no present is pending, e.g. after wait_for_idle
+	const uint32_t* front_buffer() const noexcept;
+
+	//Queues the current backbuffer for presentation and advances current_backbuffer_index. Blocks while frame_cnt presents
+	//are already pending. Returns the fence value signalled once this present has completed, after which the backbuffer
+	//may be written again
+	uint64_t present();
+
+	//Last fence value signalled by the presenter thread
+	uint64_t completed_value() const noexcept;
+
+	//Blocks until completed_value() >= value
+	void wait_for_value(uint64_t value);
+
+	void wait_for_idle();
+
+private:
+
+	void presenter_loop();
+
+	uint32_t m_width;
+
+	uint32_t m_height;
+
+	uint32_t m_frame_cnt;
+
+	uint32_t m_present_interval_us;
+
+	std::vector<uint32_t> m_buffers;
+
+	std::vector<uint32_t> m_front;
+
+	uint32_t m_curr_backbuffer = 0;
+
+	mutable std::mutex m_mtx;
+
+	std::condition_variable m_queued_cv;
+
+	std::condition_variable m_completed_cv;
+
+	//Presents are queued with consecutive fence values, so the pending ones are (m_completed_value, m_queued_value]
+	uint64_t m_queued_value = 0;
+
+	uint64_t m_completed_value = 0;
+
+	bool m_is_stopping = false;
+
+	std::thread m_presenter;
+};
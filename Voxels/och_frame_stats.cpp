@@ -0,0 +1,246 @@
+#include "och_frame_stats.h"
+
+#include "och_trace.h"
+
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+static_assert((frame_stats_capacity & (frame_stats_capacity - 1)) == 0, "frame_stats_capacity must be a power of two");
+
+//seq is the sample's position plus one once the slot has been written, and 0 while a write is in progress.
+//Readers accept a slot only if seq is the same before and after copying it
+struct sample_slot
+{
+	std::atomic<uint64_t> seq;
+
+	uint64_t begin;
+
+	uint64_t ticks;
+
+	uint32_t frame;
+
+	frame_stage stage;
+};
+
+struct sample
+{
+	uint64_t begin;
+
+	uint64_t ticks;
+
+	uint32_t frame;
+
+	frame_stage stage;
+};
+
+static sample_slot s_slots[frame_stats_capacity];
+
+static std::atomic<uint64_t> s_head{ 0 };
+
+static std::atomic<uint32_t> s_frame{ 0 };
+
+//Reference points for converting TSC ticks to nanoseconds, taken at startup and again at every query
+static const uint64_t s_tsc_origin = __rdtsc();
+
+static const std::chrono::steady_clock::time_point s_clock_origin = std::chrono::steady_clock::now();
+
+double frame_stats_ns_per_tick() noexcept
+{
+	const uint64_t ticks = __rdtsc() - s_tsc_origin;
+
+	const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - s_clock_origin).count();
+
+	return ticks ? ns / static_cast<double>(ticks) : 0.0;
+}
+
+const char* frame_stage_name(frame_stage stage) noexcept
+{
+	switch (stage)
+	{
+	case frame_stage::frame:          return "frame";
+	case frame_stage::wait_for_fence: return "wait_for_fence";
+	case frame_stage::kernel_launch:  return "kernel_launch";
+	case frame_stage::synchronize:    return "synchronize";
+	case frame_stage::present:        return "present";
+	case frame_stage::slice_copy:     return "slice_copy";
+	default:                          return "unknown";
+	}
+}
+
+void frame_stats_record(frame_stage stage, uint64_t begin_ticks, uint64_t end_ticks) noexcept
+{
+	const uint64_t pos = s_head.fetch_add(1, std::memory_order_relaxed);
+
+	const uint32_t frame = s_frame.load(std::memory_order_relaxed);
+
+	sample_slot& slot = s_slots[pos & (frame_stats_capacity - 1)];
+
+	slot.seq.store(0, std::memory_order_relaxed);
+
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.begin = begin_ticks;
+	slot.ticks = end_ticks - begin_ticks;
+	slot.frame = frame;
+	slot.stage = stage;
+
+	slot.seq.store(pos + 1, std::memory_order_release);
+
+	if (trace_is_active())
+	{
+		const trace_arg arg{ "frame", frame };
+
+		trace_record(frame_stage_name(stage), begin_ticks, end_ticks, &arg, 1);
+	}
+}
+
+void frame_stats_next_frame() noexcept
+{
+	s_frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+//Consistent copies of the samples currently held, oldest first. Slots being overwritten during the copy are skipped
+static std::vector<sample> snapshot()
+{
+	const uint64_t head = s_head.load(std::memory_order_acquire);
+
+	const uint64_t beg = head > frame_stats_capacity ? head - frame_stats_capacity : 0;
+
+	std::vector<sample> samples;
+
+	samples.reserve(static_cast<size_t>(head - beg));
+
+	for (uint64_t pos = beg; pos != head; ++pos)
+	{
+		const sample_slot& slot = s_slots[pos & (frame_stats_capacity - 1)];
+
+		if (slot.seq.load(std::memory_order_acquire) != pos + 1)
+			continue;
+
+		const sample s{ slot.begin, slot.ticks, slot.frame, slot.stage };
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if (slot.seq.load(std::memory_order_relaxed) == pos + 1)
+			samples.push_back(s);
+	}
+
+	return samples;
+}
+
+static std::vector<uint64_t> stage_ticks(frame_stage stage)
+{
+	std::vector<uint64_t> ticks;
+
+	for (const sample& s : snapshot())
+		if (s.stage == stage)
+			ticks.push_back(s.ticks);
+
+	return ticks;
+}
+
+frame_stage_summary frame_stats_summary(frame_stage stage)
+{
+	std::vector<uint64_t> ticks = stage_ticks(stage);
+
+	frame_stage_summary summary{};
+
+	if (ticks.empty())
+		return summary;
+
+	std::sort(ticks.begin(), ticks.end());
+
+	const double ms_per_tick = frame_stats_ns_per_tick() * 1e-6;
+
+	const auto percentile = [&](uint32_t p)
+	{
+		return static_cast<double>(ticks[(ticks.size() - 1) * p / 100]) * ms_per_tick;
+	};
+
+	double sum = 0.0;
+
+	for (const uint64_t t : ticks)
+		sum += static_cast<double>(t);
+
+	summary.samples = static_cast<uint32_t>(ticks.size());
+	summary.mean_ms = sum / ticks.size() * ms_per_tick;
+	summary.min_ms = static_cast<double>(ticks.front()) * ms_per_tick;
+	summary.p50_ms = percentile(50);
+	summary.p95_ms = percentile(95);
+	summary.p99_ms = percentile(99);
+	summary.max_ms = static_cast<double>(ticks.back()) * ms_per_tick;
+
+	return summary;
+}
+
+void frame_stats_histogram(frame_stage stage, uint32_t (&counts)[frame_stats_histogram_buckets])
+{
+	for (uint32_t& c : counts)
+		c = 0;
+
+	const double scale = frame_stats_ns_per_tick();
+
+	for (const uint64_t t : stage_ticks(stage))
+	{
+		const uint64_t ns = static_cast<uint64_t>(static_cast<double>(t) * scale);
+
+		uint32_t bucket = 0;
+
+		while (bucket + 1 != frame_stats_histogram_buckets && (ns >> (bucket + 1)))
+			++bucket;
+
+		++counts[bucket];
+	}
+}
+
+void frame_stats_print()
+{
+	printf("%-16s %8s %10s %10s %10s %10s %10s\n", "stage", "samples", "mean ms", "p50 ms", "p95 ms", "p99 ms", "max ms");
+
+	for (uint8_t i = 0; i != static_cast<uint8_t>(frame_stage::count); ++i)
+	{
+		const frame_stage stage = static_cast<frame_stage>(i);
+
+		const frame_stage_summary s = frame_stats_summary(stage);
+
+		if (!s.samples)
+			continue;
+
+		printf("%-16s %8u %10.3f %10.3f %10.3f %10.3f %10.3f\n", frame_stage_name(stage), s.samples, s.mean_ms, s.p50_ms, s.p95_ms, s.p99_ms, s.max_ms);
+	}
+}
+
+bool frame_stats_write_csv(const char* path)
+{
+	FILE* csv = fopen(path, "w");
+
+	if (!csv)
+		return false;
+
+	const std::vector<sample> samples = snapshot();
+
+	const double scale = frame_stats_ns_per_tick();
+
+	const uint64_t origin = samples.empty() ? 0 : std::min_element(samples.begin(), samples.end(), [](const sample& a, const sample& b) { return a.begin < b.begin; })->begin;
+
+	fprintf(csv, "frame,stage,begin_ns,duration_ns\n");
+
+	for (const sample& s : samples)
+		fprintf(csv, "%u,%s,%.0f,%.0f\n", s.frame, frame_stage_name(s.stage), static_cast<double>(s.begin - origin) * scale, static_cast<double>(s.ticks) * scale);
+
+	fclose(csv);
+
+	return true;
+}
+
+//Samples recorded concurrently with a reset may survive it
+void frame_stats_reset() noexcept
+{
+	for (sample_slot& slot : s_slots)
+		slot.seq.store(0, std::memory_order_relaxed);
+
+	s_frame.store(0, std::memory_order_relaxed);
+}
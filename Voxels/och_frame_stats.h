@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+//Set to 0 to compile all probes out. The query functions stay available and report no samples
+#ifndef OCH_FRAME_STATS
+#define OCH_FRAME_STATS 1
+#endif
+
+enum class frame_stage : uint8_t
+{
+	frame,
+	wait_for_fence,
+	kernel_launch,
+	synchronize,
+	present,
+	slice_copy,
+	count,
+};
+
+const char* frame_stage_name(frame_stage stage) noexcept;
+
+//Number of most recent samples, over all stages, that are kept for queries
+static constexpr uint32_t frame_stats_capacity = 1 << 16;
+
+//Timestamps are TSC ticks, converted to nanoseconds only when queried
+inline uint64_t frame_stats_now() noexcept
+{
+	return __rdtsc();
+}
+
+//Current length of a tick in nanoseconds, measured against steady_clock since startup
+double frame_stats_ns_per_tick() noexcept;
+
+//Appends one sample to the ring buffer. Lock-free and safe to call from any thread; once the buffer is full the oldest
+//samples are overwritten
+void frame_stats_record(frame_stage stage, uint64_t begin_ticks, uint64_t end_ticks) noexcept;
+
+//Advances the frame index stored with subsequent samples
+void frame_stats_next_frame() noexcept;
+
+struct frame_stage_summary
+{
+	uint32_t samples;
+
+	double mean_ms;
+	double min_ms;
+	double p50_ms;
+	double p95_ms;
+	double p99_ms;
+	double max_ms;
+};
+
+//Percentiles over the samples of stage still held in the ring buffer
+frame_stage_summary frame_stats_summary(frame_stage stage);
+
+//Distribution of the same samples, counts[i] being the number of durations in [2^i, 2^(i + 1)) nanoseconds
+static constexpr uint32_t frame_stats_histogram_buckets = 40;
+
+void frame_stats_histogram(frame_stage stage, uint32_t (&counts)[frame_stats_histogram_buckets]);
+
+//Prints one line of percentiles per stage with samples
+void frame_stats_print();
+
+//Writes every sample held in the ring buffer as frame,stage,begin_ns,duration_ns, oldest first, with begin_ns relative to
+//the first sample. Returns false if path could not be opened
+bool frame_stats_write_csv(const char* path);
+
+void frame_stats_reset() noexcept;
+
+//Records the time between its construction and destruction under stage
+struct frame_probe
+{
+	explicit frame_probe(frame_stage stage) noexcept : m_begin{ frame_stats_now() }, m_stage{ stage } {}
+
+	~frame_probe() { frame_stats_record(m_stage, m_begin, frame_stats_now()); }
+
+	frame_probe(const frame_probe&) = delete;
+
+	frame_probe& operator=(const frame_probe&) = delete;
+
+private:
+
+	uint64_t m_begin;
+
+	frame_stage m_stage;
+};
+
+#define OCH_FRAME_PROBE_CONCAT_(a, b) a##b
+#define OCH_FRAME_PROBE_CONCAT(a, b) OCH_FRAME_PROBE_CONCAT_(a, b)
+
+#if OCH_FRAME_STATS
+//Times the rest of the enclosing scope as frame_stage::stage
+#define OCH_FRAME_PROBE(stage) frame_probe OCH_FRAME_PROBE_CONCAT(och_frame_probe_, __LINE__)(frame_stage::stage)
+#define OCH_FRAME_NEXT() frame_stats_next_frame()
+#else
+#define OCH_FRAME_PROBE(stage) ((void)0)
+#define OCH_FRAME_NEXT() ((void)0)
+#endif
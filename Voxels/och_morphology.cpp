@@ -0,0 +1,186 @@
+#include "och_morphology.h"
+
+#include <utility>
+#include <vector>
+
+#include "och_thread_pool.h"
+#include "och_trace.h"
+
+//Which neighbours a pass combines with each voxel
+enum class morph_pass : uint8_t
+{
+	x,
+	y,
+	z,
+	face,
+};
+
+template<bool Erode>
+static uint64_t combine(uint64_t a, uint64_t b) noexcept
+{
+	return Erode ? a & b : a | b;
+}
+
+//Row (y, z) of v, or border_row if it lies outside the volume
+static const uint64_t* row_or_border(const bit_volume& v, int64_t y, int64_t z, const uint64_t* border_row) noexcept
+{
+	if (y < 0 || z < 0 || y >= v.y_cnt() || z >= v.z_cnt())
+		return border_row;
+
+	return v.row(static_cast<uint32_t>(y), static_cast<uint32_t>(z));
+}
+
+//Combines every voxel of in with its neighbours along x. The unused bits at the end of the row and the words beyond
+//either end of it read as border
+template<bool Erode>
+static void combine_row_x(uint64_t* out, const uint64_t* in, uint32_t row_words, uint64_t tail_mask, uint64_t border) noexcept
+{
+	const auto load = [&](uint32_t w) noexcept
+	{
+		if (w >= row_words)
+			return border;
+
+		return w + 1 == row_words ? in[w] | (border & ~tail_mask) : in[w];
+	};
+
+	uint64_t prev = border;
+
+	uint64_t curr = load(0);
+
+	for (uint32_t w = 0; w != row_words; ++w)
+	{
+		const uint64_t next = load(w + 1);
+
+		const uint64_t from_lower = (curr << 1) | (prev >> 63);
+		const uint64_t from_upper = (curr >> 1) | (next << 63);
+
+		out[w] = combine<Erode>(curr, combine<Erode>(from_lower, from_upper));
+
+		prev = curr;
+		curr = next;
+	}
+}
+
+template<bool Erode>
+static void run_pass(bit_volume& out, const bit_volume& in, morph_pass pass, uint64_t border, uint32_t max_threads)
+{
+	const uint32_t row_words = in.row_words();
+
+	const uint64_t tail_mask = in.x_cnt() % 64 ? (1ULL << (in.x_cnt() % 64)) - 1 : ~0ULL;
+
+	//Stands in for the rows outside the volume, so that every row is combined with the same loop
+	const std::vector<uint64_t> border_row(row_words, border);
+
+	thread_pool::global().parallel_for(in.z_cnt(), [&](uint32_t z, uint32_t)
+		{
+			for (uint32_t y = 0; y != in.y_cnt(); ++y)
+			{
+				uint64_t* const dst = out.row(y, z);
+
+				const uint64_t* const src = in.row(y, z);
+
+				if (pass == morph_pass::x)
+				{
+					combine_row_x<Erode>(dst, src, row_words, tail_mask, border);
+				}
+				else if (pass == morph_pass::face)
+				{
+					combine_row_x<Erode>(dst, src, row_words, tail_mask, border);
+
+					const uint64_t* const y_lo = row_or_border(in, static_cast<int64_t>(y) - 1, z, border_row.data());
+					const uint64_t* const y_hi = row_or_border(in, static_cast<int64_t>(y) + 1, z, border_row.data());
+					const uint64_t* const z_lo = row_or_border(in, y, static_cast<int64_t>(z) - 1, border_row.data());
+					const uint64_t* const z_hi = row_or_border(in, y, static_cast<int64_t>(z) + 1, border_row.data());
+
+					for (uint32_t w = 0; w != row_words; ++w)
+						dst[w] = combine<Erode>(combine<Erode>(dst[w], combine<Erode>(y_lo[w], y_hi[w])), combine<Erode>(z_lo[w], z_hi[w]));
+				}
+				else
+				{
+					const int64_t dy = pass == morph_pass::y;
+					const int64_t dz = pass == morph_pass::z;
+
+					const uint64_t* const lo = row_or_border(in, y - dy, z - dz, border_row.data());
+					const uint64_t* const hi = row_or_border(in, y + dy, z + dz, border_row.data());
+
+					for (uint32_t w = 0; w != row_words; ++w)
+						dst[w] = combine<Erode>(src[w], combine<Erode>(lo[w], hi[w]));
+				}
+
+				if (row_words)
+					dst[row_words - 1] &= tail_mask;
+			}
+		}, max_threads);
+}
+
+template<bool Erode>
+static void morph(bit_volume& dst, const bit_volume& src, const morph_params& params, uint32_t max_threads)
+{
+	OCH_TRACE_SCOPE(Erode ? "morph_erode" : "morph_dilate", { "radius", params.radius }, { "element", static_cast<uint32_t>(params.element) });
+
+	if (params.radius == 0)
+	{
+		if (&dst != &src)
+			dst = src;
+
+		return;
+	}
+
+	const uint64_t border = params.outside_occupied ? ~0ULL : 0;
+
+	static constexpr morph_pass face_passes[]{ morph_pass::face };
+
+	static constexpr morph_pass cube_passes[]{ morph_pass::x, morph_pass::y, morph_pass::z };
+
+	const morph_pass* const passes = params.element == morph_element::face ? face_passes : cube_passes;
+
+	const uint32_t pass_cnt = params.element == morph_element::face ? 1 : 3;
+
+	//Passes ping-pong between two buffers, the first one reading src
+	bit_volume buffers[2];
+
+	buffers[0] = bit_volume(src.x_cnt(), src.y_cnt(), src.z_cnt());
+
+	if (params.radius * pass_cnt > 1)
+		buffers[1] = bit_volume(src.x_cnt(), src.y_cnt(), src.z_cnt());
+
+	const bit_volume* in = &src;
+
+	uint32_t out_idx = 0;
+
+	for (uint32_t step = 0; step != params.radius; ++step)
+		for (uint32_t p = 0; p != pass_cnt; ++p)
+		{
+			run_pass<Erode>(buffers[out_idx], *in, passes[p], border, max_threads);
+
+			in = &buffers[out_idx];
+
+			out_idx ^= 1;
+		}
+
+	dst = std::move(buffers[out_idx ^ 1]);
+}
+
+void morph_dilate(bit_volume& dst, const bit_volume& src, const morph_params& params, uint32_t max_threads)
+{
+	morph<false>(dst, src, params, max_threads);
+}
+
+void morph_erode(bit_volume& dst, const bit_volume& src, const morph_params& params, uint32_t max_threads)
+{
+	morph<true>(dst, src, params, max_threads);
+}
+
+void morph_open(bit_volume& dst, const bit_volume& src, const morph_params& params, uint32_t max_threads)
+{
+	morph<true>(dst, src, params, max_threads);
+
+	morph<false>(dst, dst, params, max_threads);
+}
+
+void morph_close(bit_volume& dst, const bit_volume& src, const morph_params& params, uint32_t max_threads)
+{
+	morph<false>(dst, src, params, max_threads);
+
+	morph<true>(dst, dst, params, max_threads);
+}
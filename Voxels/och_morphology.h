@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+#include "och_bit_volume.h"
+
+enum class morph_element : uint8_t
+{
+	face,	//6-neighbourhood. Repeated radius times, this grows by an octahedron of that radius
+	cube,	//26-neighbourhood. Repeated radius times, this grows by a cube of edge 2 * radius + 1
+};
+
+struct morph_params
+{
+	morph_element element = morph_element::cube;
+
+	//Number of single-voxel steps, 0 copying src
+	uint32_t radius = 1;
+
+	//Whether voxels outside the volume count as occupied. With the default, erosion eats into the volume from its border
+	bool outside_occupied = false;
+};
+
+//Morphological operations on a packed bit_volume. Every step works on whole 64-voxel words: neighbours along x are shifted
+//in from the same word and its neighbours, while neighbours along y and z are the words of the adjacent rows.
+//A face step is a single pass; a cube step is one pass per axis, since the cube is the product of three lines.
+//Slices of each pass are spread over the threads of thread_pool::global(), max_threads capping their number (0 meaning no cap).
+//dst takes on the dimensions of src and may be src.
+
+//Sets every voxel that is within the structuring element of an occupied voxel
+void morph_dilate(bit_volume& dst, const bit_volume& src, const morph_params& params, uint32_t max_threads = 0);
+
+//Keeps only the voxels whose structuring element is entirely occupied
+void morph_erode(bit_volume& dst, const bit_volume& src, const morph_params& params, uint32_t max_threads = 0);
+
+//Erosion followed by dilation, removing features thinner than the structuring element
+void morph_open(bit_volume& dst, const bit_volume& src, const morph_params& params, uint32_t max_threads = 0);
+
+//Dilation followed by erosion, filling gaps and cavities narrower than the structuring element
+void morph_close(bit_volume& dst, const bit_volume& src, const morph_params& params, uint32_t max_threads = 0);
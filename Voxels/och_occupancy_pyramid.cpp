@@ -0,0 +1,194 @@
+#include "och_occupancy_pyramid.h"
+
+#include <cstring>
+
+#include "och_bit_ops.h"
+#include "och_thread_pool.h"
+
+pyramid_cell occupancy_pyramid::reduce(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const noexcept
+{
+	pyramid_cell c{ 0, 255, 0, 0 };
+
+	for (uint32_t i = 0; i != 8; ++i)
+	{
+		const uint32_t cx = x * 2 + (i & 1);
+		const uint32_t cy = y * 2 + ((i >> 1) & 1);
+		const uint32_t cz = z * 2 + (i >> 2);
+
+		uint8_t child_min, child_max;
+
+		if (level == 1)
+		{
+			child_min = child_max = density(cx, cy, cz);
+		}
+		else
+		{
+			child_min = min_density(level - 1, cx, cy, cz);
+			child_max = max_density(level - 1, cx, cy, cz);
+		}
+
+		if (child_max > m_threshold)
+			c.child_mask |= 1 << i;
+
+		if (child_min < c.min)
+			c.min = child_min;
+
+		if (child_max > c.max)
+			c.max = child_max;
+	}
+
+	return c;
+}
+
+void occupancy_pyramid::store(uint32_t level, size_t idx, const pyramid_cell& c) noexcept
+{
+	pyramid_level& l = m_levels[level - 1];
+
+	m_child_masks[m_mask_offsets[level] + idx] = c.child_mask;
+	l.min[idx] = c.min;
+	l.max[idx] = c.max;
+}
+
+void occupancy_pyramid::build(const uint8_t* density, size_t pitch, size_t slice_pitch, uint32_t dim, uint8_t threshold, uint32_t max_threads)
+{
+	m_dim = dim;
+
+	m_threshold = threshold;
+
+	m_density.resize(static_cast<size_t>(dim) * dim * dim);
+
+	for (uint32_t z = 0; z != dim; ++z)
+		for (uint32_t y = 0; y != dim; ++y)
+			memcpy(m_density.data() + (y + static_cast<size_t>(z) * dim) * dim, density + y * pitch + z * slice_pitch, dim);
+
+	const uint32_t top_level = log2_of_pow2(dim);
+
+	m_levels.assign(top_level, {});
+
+	m_mask_offsets.assign(top_level + 1, 0);
+
+	size_t mask_cnt = 0;
+
+	for (uint32_t level = 1; level <= top_level; ++level)
+	{
+		const size_t n = dim >> level;
+
+		m_mask_offsets[level] = mask_cnt;
+
+		mask_cnt += n * n * n;
+	}
+
+	m_child_masks.assign(mask_cnt + 3, 0);
+
+	for (uint32_t level = 1; level <= top_level; ++level)
+	{
+		const uint32_t n = dim >> level;
+
+		const size_t cell_cnt = static_cast<size_t>(n) * n * n;
+
+		m_levels[level - 1].min.resize(cell_cnt);
+		m_levels[level - 1].max.resize(cell_cnt);
+
+		thread_pool::global().parallel_for(n, [&, level, n](uint32_t z, uint32_t)
+			{
+				for (uint32_t y = 0; y != n; ++y)
+					for (uint32_t x = 0; x != n; ++x)
+						store(level, cell_index(level, x, y, z), reduce(level, x, y, z));
+			}, max_threads);
+	}
+}
+
+int32_t occupancy_pyramid::empty_cell_log2(uint32_t x, uint32_t y, uint32_t z) const noexcept
+{
+	//Top-down, so the first empty cell found is the largest one
+	for (uint32_t level = level_cnt() - 1; level != 0; --level)
+		if (!is_occupied(level, x >> level, y >> level, z >> level))
+			return static_cast<int32_t>(level);
+
+	return is_occupied(0, x, y, z) ? -1 : 0;
+}
+
+void occupancy_pyramid::range_min_max_rec(uint32_t level, uint32_t x, uint32_t y, uint32_t z, const uint32_t beg[3], const uint32_t end[3], uint8_t& min, uint8_t& max) const noexcept
+{
+	const uint32_t lo[3]{ x << level, y << level, z << level };
+
+	const uint32_t size = 1u << level;
+
+	bool is_inside = true;
+
+	for (uint32_t a = 0; a != 3; ++a)
+	{
+		if (lo[a] >= end[a] || lo[a] + size <= beg[a])
+			return;
+
+		if (lo[a] < beg[a] || lo[a] + size > end[a])
+			is_inside = false;
+	}
+
+	const uint8_t cell_min = min_density(level, x, y, z);
+	const uint8_t cell_max = max_density(level, x, y, z);
+
+	//Nothing below this cell can move the result, whether or not the cell lies fully inside the box
+	if (cell_min >= min && cell_max <= max)
+		return;
+
+	if (is_inside || level == 0)
+	{
+		if (cell_min < min)
+			min = cell_min;
+
+		if (cell_max > max)
+			max = cell_max;
+
+		return;
+	}
+
+	for (uint32_t i = 0; i != 8; ++i)
+		range_min_max_rec(level - 1, x * 2 + (i & 1), y * 2 + ((i >> 1) & 1), z * 2 + (i >> 2), beg, end, min, max);
+}
+
+void occupancy_pyramid::range_min_max(uint32_t x_beg, uint32_t y_beg, uint32_t z_beg, uint32_t x_end, uint32_t y_end, uint32_t z_end, uint8_t& min, uint8_t& max) const noexcept
+{
+	const uint32_t beg[3]{ x_beg, y_beg, z_beg };
+
+	const uint32_t end[3]{ x_end < m_dim ? x_end : m_dim, y_end < m_dim ? y_end : m_dim, z_end < m_dim ? z_end : m_dim };
+
+	min = 255;
+	max = 0;
+
+	range_min_max_rec(level_cnt() - 1, 0, 0, 0, beg, end, min, max);
+}
+
+uint32_t occupancy_pyramid::set(uint32_t x, uint32_t y, uint32_t z, uint8_t value) noexcept
+{
+	uint8_t& voxel = m_density[x + (y + static_cast<size_t>(z) * m_dim) * m_dim];
+
+	if (voxel == value)
+		return 0;
+
+	voxel = value;
+
+	uint32_t updated = 0;
+
+	for (uint32_t level = 1; level != level_cnt(); ++level)
+	{
+		const uint32_t cx = x >> level;
+		const uint32_t cy = y >> level;
+		const uint32_t cz = z >> level;
+
+		const pyramid_cell c = reduce(level, cx, cy, cz);
+
+		const size_t idx = cell_index(level, cx, cy, cz);
+
+		const pyramid_level& l = m_levels[level - 1];
+
+		++updated;
+
+		if (m_child_masks[m_mask_offsets[level] + idx] == c.child_mask && l.min[idx] == c.min && l.max[idx] == c.max)
+			break;
+
+		store(level, idx, c);
+	}
+
+	return updated;
+}
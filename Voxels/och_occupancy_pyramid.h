@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//One cell of a pyramid level. Bit i of child_mask is set if child octant (i & 1, (i >> 1) & 1, i >> 2) holds a voxel
+//above the threshold, as in d_uint8_to_bit; min and max are the extreme densities below the cell
+struct pyramid_cell
+{
+	uint8_t child_mask;
+	uint8_t min;
+	uint8_t max;
+	uint8_t reserved;
+};
+
+//Occupancy mip pyramid over a dim^3 uint8_t density volume (dim a power of two). Level 0 is the density itself, level k
+//has (dim >> k)^3 cells each reducing 2x2x2 cells of level k - 1 by OR on occupancy and by min / max on density, down to
+//a single root cell. Queries can skip whole cells that are empty (max <= threshold) or full (min > threshold), and
+//editing one voxel only recomputes its ancestors.
+struct occupancy_pyramid
+{
+	//Copies the volume, whose rows and slices are pitch and slice_pitch bytes apart, and builds all levels in parallel
+	void build(const uint8_t* density, size_t pitch, size_t slice_pitch, uint32_t dim, uint8_t threshold, uint32_t max_threads = 0);
+
+	uint32_t dim() const noexcept { return m_dim; }
+
+	//Number of levels including level 0, i.e. log2(dim) + 1
+	uint32_t level_cnt() const noexcept { return static_cast<uint32_t>(m_levels.size()) + 1; }
+
+	uint8_t threshold() const noexcept { return m_threshold; }
+
+	uint8_t density(uint32_t x, uint32_t y, uint32_t z) const noexcept
+	{
+		return m_density[x + (y + static_cast<size_t>(z) * m_dim) * m_dim];
+	}
+
+	//Cell (x, y, z) of level >= 1, in that level's coordinates
+	pyramid_cell cell(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const noexcept
+	{
+		const pyramid_level& l = m_levels[level - 1];
+
+		const size_t idx = cell_index(level, x, y, z);
+
+		return { m_child_masks[m_mask_offsets[level] + idx], l.min[idx], l.max[idx], 0 };
+	}
+
+	uint8_t child_mask(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const noexcept
+	{
+		return m_child_masks[m_mask_offsets[level] + cell_index(level, x, y, z)];
+	}
+
+	//Child masks of all levels >= 1 in one buffer, level k starting at child_mask_offset(k). The buffer is followed by
+	//three padding bytes, so it can be read with 4-byte gathers
+	const uint8_t* child_masks() const noexcept { return m_child_masks.data(); }
+
+	size_t child_mask_offset(uint32_t level) const noexcept { return m_mask_offsets[level]; }
+
+	uint8_t min_density(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const noexcept
+	{
+		return level ? m_levels[level - 1].min[cell_index(level, x, y, z)] : density(x, y, z);
+	}
+
+	uint8_t max_density(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const noexcept
+	{
+		return level ? m_levels[level - 1].max[cell_index(level, x, y, z)] : density(x, y, z);
+	}
+
+	//Only reads child masks, so walks that never look at densities stay within about dim^3 / 7 bytes
+	bool is_occupied(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const noexcept
+	{
+		if (level)
+			return child_mask(level, x, y, z) != 0;
+
+		if (m_levels.empty())
+			return density(x, y, z) > m_threshold;
+
+		return (child_mask(1, x >> 1, y >> 1, z >> 1) >> ((x & 1) | ((y & 1) << 1) | ((z & 1) << 2))) & 1;
+	}
+
+	bool is_full(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const noexcept
+	{
+		return min_density(level, x, y, z) > m_threshold;
+	}
+
+	//Log2 of the edge of the largest empty cell containing voxel (x, y, z), or -1 if the voxel itself is occupied.
+	//A ray at that voxel can skip ahead to the boundary of that cell
+	int32_t empty_cell_log2(uint32_t x, uint32_t y, uint32_t z) const noexcept;
+
+	//Minimum and maximum density in the box [beg, end), using the coarsest cells that fit inside it
+	void range_min_max(uint32_t x_beg, uint32_t y_beg, uint32_t z_beg, uint32_t x_end, uint32_t y_end, uint32_t z_end, uint8_t& min, uint8_t& max) const noexcept;
+
+	//Writes one voxel and updates its ancestors, stopping at the first one that does not change.
+	//Returns the number of levels above 0 that were recomputed
+	uint32_t set(uint32_t x, uint32_t y, uint32_t z, uint8_t value) noexcept;
+
+private:
+
+	//Densities are kept apart from the child masks, so that occupancy tests do not pull them into the cache
+	struct pyramid_level
+	{
+		std::vector<uint8_t> min;
+		std::vector<uint8_t> max;
+	};
+
+	size_t cell_index(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const noexcept
+	{
+		const uint32_t n = m_dim >> level;
+
+		return x + (y + static_cast<size_t>(z) * n) * n;
+	}
+
+	void store(uint32_t level, size_t idx, const pyramid_cell& c) noexcept;
+
+	pyramid_cell reduce(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const noexcept;
+
+	void range_min_max_rec(uint32_t level, uint32_t x, uint32_t y, uint32_t z, const uint32_t beg[3], const uint32_t end[3], uint8_t& min, uint8_t& max) const noexcept;
+
+	uint32_t m_dim = 0;
+
+	uint8_t m_threshold = 0;
+
+	std::vector<uint8_t> m_density;
+
+	//m_levels[k - 1] holds level k
+	std::vector<pyramid_level> m_levels;
+
+	std::vector<uint8_t> m_child_masks;
+
+	//Indexed by level, entry 0 is unused
+	std::vector<size_t> m_mask_offsets;
+};
@@ -2,9 +2,6 @@
 
 #include <cstdint>
 
-#include "device_launch_parameters.h"
-#include "cuda_runtime.h"
-
 __global__ void dev_set_memory_to(int32_t value, void* beg, int32_t stride, int32_t w, int32_t h)
 {
 	const uint32_t idx_x = blockIdx.x * blockDim.x + threadIdx.x;
@@ -15,12 +12,12 @@ __global__ void dev_set_memory_to(int32_t value, void* beg, int32_t stride, int3
 
 	int32_t* mem = reinterpret_cast<int32_t*>(beg);
 
-	mem[idx_x + idx_y * stride] = 0;
+	mem[idx_x + idx_y * stride] = value;
 }
 
 cudaError_t launch_set_memory_to(dim3 threads_per_block, dim3 blocks_per_grid, int32_t value, void* beg, int32_t stride, int32_t w, int32_t h)
 {
-	dev_set_memory_to<<<threads_per_block, blocks_per_grid>>>(value, beg, stride, w, h);
+	OCH_LAUNCH(dev_set_memory_to, threads_per_block, blocks_per_grid)(value, beg, stride, w, h);
 
 	return cudaGetLastError();
 }
@@ -38,7 +35,7 @@ __global__ void dev_set_surface_to(int32_t value, cudaSurfaceObject_t surf, int3
 
 cudaError_t launch_set_surface_to(dim3 threads_per_block, dim3 blocks_per_grid, int32_t value, cudaSurfaceObject_t surf, int32_t w, int32_t h)
 {
-	dev_set_surface_to<<<threads_per_block, blocks_per_grid>>>(value, surf, w, h);
+	OCH_LAUNCH(dev_set_surface_to, threads_per_block, blocks_per_grid)(value, surf, w, h);
 
 	return cudaGetLastError();
 }
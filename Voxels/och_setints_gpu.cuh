@@ -1,5 +1,8 @@
+#pragma once
+
 #include <cstdint>
-#include "cuda_runtime.h"
+
+#include "och_cuda_compat.cuh"
 
 __global__ void dev_set_memory_to(int32_t value, void* beg, int32_t stride, int32_t x_sz, int32_t y_sz);
 
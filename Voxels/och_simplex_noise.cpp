@@ -4,7 +4,13 @@
 #include <cmath>
 #include <cstdio>
 
-#include <immintrin.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "och_simplex_noise_backends.h"
+#include "och_thread_pool.h"
 
 constexpr float grad3[12][3]
 {
@@ -20,9 +26,9 @@ uint32_t hash(float i, float j, float k, uint32_t seed)
 	const uint32_t _j = *reinterpret_cast<uint32_t*>(&j);
 	const uint32_t _k = *reinterpret_cast<uint32_t*>(&k);
 
-	const uint64_t h = (_i * 73856093) ^ (_j * 19349663) ^ (_k * 83492791) ^ seed;
+	const uint32_t h = (_i * 73856093) ^ (_j * 19349663) ^ (_k * 83492791) ^ seed;
 
-	return (h * 12) >> 32;
+	return ((h >> 4) * 3) >> 26;	//Normalize hash-value to [0, 11]. Matches the SIMD tiers, which only have 32-bit multiplies
 }
 
 float dot_with_vec(float i, float j, float k, float x, float y, float z, uint32_t seed)
@@ -102,170 +108,458 @@ float simplex_3d(float x_in, float y_in, float z_in, uint32_t seed)
 	return 76.0F * (t0 + t1 + t2 + t3);
 }
 
-constexpr float grad_x[12] = {  1, -1,  1, -1,  1, -1,  1, -1,  0,  0,  0,  0 };
-constexpr float grad_y[12] = {  1,  1, -1, -1,  0,  0,  0,  0,  1, -1,  1, -1 };
-constexpr float grad_z[12] = {  0,  0,  0,  0,  1,  1, -1, -1,  1,  1, -1, -1 };
-
-__forceinline __m256 dot_with_vec(__m256 _i, __m256 _j, __m256 _k, __m256 _x, __m256 _y, __m256 _z, __m256i _seed)
+//Contribution t^4 * (g . d) of one corner, adding its derivative 4t^3 * (-2d) * (g . d) + t^4 * g to (dx, dy, dz)
+static float corner_with_grad(float i, float j, float k, float x, float y, float z, uint32_t seed, float& dx, float& dy, float& dz)
 {
-	const __m256i _hi = _mm256_mul_epi32(_mm256_castps_si256(_i), _mm256_set1_epi32(73856093));
-	const __m256i _hj = _mm256_mul_epi32(_mm256_castps_si256(_j), _mm256_set1_epi32(19349663));
-	const __m256i _hk = _mm256_mul_epi32(_mm256_castps_si256(_k), _mm256_set1_epi32(83492791));
+	float t = 0.5F - x * x - y * y - z * z;
+	if (t < 0)
+		t = 0;
+
+	const int h = hash(i, j, k, seed);
 
-	const __m256i _h_raw = _mm256_xor_si256(_hi, _mm256_xor_si256(_hj, _hk));
+	const float dot = grad3[h][0] * x + grad3[h][1] * y + grad3[h][2] * z;
 
-	const __m256i _h = _mm256_srli_epi32(_mm256_mul_epi32(_mm256_srli_epi32(_h_raw, 4), _mm256_set1_epi32(3)), 26);	//Normalize hash-value to [0, 11]
+	const float t3 = t * t * t;
+	const float t4 = t3 * t;
 
-	const __m256 _gx = _mm256_i32gather_ps(grad_x, _h, 4);
-	const __m256 _gy = _mm256_i32gather_ps(grad_y, _h, 4);
-	const __m256 _gz = _mm256_i32gather_ps(grad_z, _h, 4);
+	const float falloff_deriv = -8.0F * (t3 * dot);
 
-	const __m256 _px = _mm256_mul_ps(_x, _gx);
-	const __m256 _py = _mm256_mul_ps(_y, _gy);
-	const __m256 _pz = _mm256_mul_ps(_z, _gz);
+	dx = dx + (t4 * grad3[h][0] + falloff_deriv * x);
+	dy = dy + (t4 * grad3[h][1] + falloff_deriv * y);
+	dz = dz + (t4 * grad3[h][2] + falloff_deriv * z);
 
-	return _mm256_add_ps(_px, _mm256_add_ps(_py, _pz));
+	return t4 * dot;
 }
 
-void simplex_3d_fill(float* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed)
+float simplex_3d_grad(float x_in, float y_in, float z_in, uint32_t seed, float& dx, float& dy, float& dz)
 {
 	constexpr float skew_factor = 1.0F / 3.0F;
 	constexpr float unskew_factor = 1.0F / 6.0F;
 
-	const __m256 _skew_factor = _mm256_set1_ps(skew_factor);
+	const float skew = (x_in + y_in + z_in) * skew_factor;
+
+	const float i0 = floorf(x_in + skew);
+	const float j0 = floorf(y_in + skew);
+	const float k0 = floorf(z_in + skew);
+
+	const float unskew = (i0 + j0 + k0) * unskew_factor;
+
+	const float x0 = x_in - (i0 - unskew);
+	const float y0 = y_in - (j0 - unskew);
+	const float z0 = z_in - (k0 - unskew);
+
+	const float i1 = (float) ((x0 >= y0) & (x0 >= z0));		//max == x
+	const float j1 = (float) ((y0 >  x0) & (y0 >= z0));		//max == y
+	const float k1 = (float) ((z0 >  x0) & (z0 >  y0));		//max == z
+
+	const float i2 = (float) ((x0 >= y0) | (x0 >= z0));		//min != x
+	const float j2 = (float) ((y0 >  x0) | (y0 >= z0));		//min != y
+	const float k2 = (float) ((z0 >  x0) | (z0 >  y0));		//min != z
+
+	const float x1 = x0 - i1 + unskew_factor;
+	const float y1 = y0 - j1 + unskew_factor;
+	const float z1 = z0 - k1 + unskew_factor;
+
+	const float x2 = x0 - i2 + unskew_factor * 2.0F;
+	const float y2 = y0 - j2 + unskew_factor * 2.0F;
+	const float z2 = z0 - k2 + unskew_factor * 2.0F;
+
+	const float x3 = x0 - 1.0F + unskew_factor * 3.0F;
+	const float y3 = y0 - 1.0F + unskew_factor * 3.0F;
+	const float z3 = z0 - 1.0F + unskew_factor * 3.0F;
 
-	const __m256 _unskew_factor = _mm256_set1_ps(unskew_factor);
+	float gx = 0.0F, gy = 0.0F, gz = 0.0F;
 
-	const float x_step = x_size / x_cnt;
-	const float y_step = y_size / y_cnt;
-	const float z_step = z_size / z_cnt;
+	const float t0 = corner_with_grad(i0       , j0       , k0       , x0, y0, z0, seed, gx, gy, gz);
+	const float t1 = corner_with_grad(i0 + i1  , j0 + j1  , k0 + k1  , x1, y1, z1, seed, gx, gy, gz);
+	const float t2 = corner_with_grad(i0 + i2  , j0 + j2  , k0 + k2  , x2, y2, z2, seed, gx, gy, gz);
+	const float t3 = corner_with_grad(i0 + 1.0F, j0 + 1.0F, k0 + 1.0F, x3, y3, z3, seed, gx, gy, gz);
 
-	const __m256 _x_offsets = _mm256_set_ps(x_step*7, x_step*6, x_step*5, x_step*4, x_step*3, x_step*2, x_step, 0);		//Offsets in x-coordinate space
+	dx = 76.0F * gx;
+	dy = 76.0F * gy;
+	dz = 76.0F * gz;
 
-	const __m256i _seed = _mm256_set1_epi32(seed);
+	return 76.0F * (t0 + t1 + t2 + t3);
+}
 
-	for (uint32_t iz = 0; iz != z_cnt; ++iz)
+static void fill_scalar(float* dst, const simplex_grid& grid, const simplex_block& block)
+{
+	for (uint32_t iz = block.z_lo; iz != block.z_hi; ++iz)
 	{
-		const float z_in = z_beg + iz * z_step;
+		const float z_in = grid.z_beg + iz * grid.z_step;
 
-		for (uint32_t iy = 0; iy != y_cnt; ++iy)
+		for (uint32_t iy = block.y_lo; iy != block.y_hi; ++iy)
 		{
-			const float y_in = y_beg + iy * y_step;
+			const float y_in = grid.y_beg + iy * grid.y_step;
 
-			for (uint32_t ix = 7; ix < x_cnt; ix += 8)
+			float* const row_dst = dst + static_cast<size_t>(iy) * grid.x_cnt + static_cast<size_t>(iz) * grid.x_cnt * grid.y_cnt;
+
+			for (uint32_t ix = block.x_lo; ix != block.x_hi; ++ix)
+				row_dst[ix] = simplex_3d(grid.x_beg + ix * grid.x_step, y_in, z_in, grid.seed);
+		}
+	}
+}
+
+static float fbm_scalar(float x_in, float y_in, float z_in, const simplex_octaves& octaves)
+{
+	float sum = 0.0F;
+
+	for (uint32_t o = 0; o != octaves.cnt; ++o)
+		sum = sum + octaves.amp[o] * simplex_3d(x_in * octaves.freq[o], y_in * octaves.freq[o], z_in * octaves.freq[o], octaves.seed[o]);
+
+	return sum;
+}
+
+static void fill_fbm_scalar(float* dst, const simplex_grid& grid, const simplex_octaves& octaves, const simplex_block& block)
+{
+	for (uint32_t iz = block.z_lo; iz != block.z_hi; ++iz)
+	{
+		const float z_in = grid.z_beg + iz * grid.z_step;
+
+		for (uint32_t iy = block.y_lo; iy != block.y_hi; ++iy)
+		{
+			const float y_in = grid.y_beg + iy * grid.y_step;
+
+			float* const row_dst = dst + static_cast<size_t>(iy) * grid.x_cnt + static_cast<size_t>(iz) * grid.x_cnt * grid.y_cnt;
+
+			for (uint32_t ix = block.x_lo; ix != block.x_hi; ++ix)
+				row_dst[ix] = fbm_scalar(grid.x_beg + ix * grid.x_step, y_in, z_in, octaves);
+		}
+	}
+}
+
+static void fill_grad_scalar(float* dst, float* dst_dx, float* dst_dy, float* dst_dz, const simplex_grid& grid, const simplex_block& block)
+{
+	for (uint32_t iz = block.z_lo; iz != block.z_hi; ++iz)
+	{
+		const float z_in = grid.z_beg + iz * grid.z_step;
+
+		for (uint32_t iy = block.y_lo; iy != block.y_hi; ++iy)
+		{
+			const float y_in = grid.y_beg + iy * grid.y_step;
+
+			const size_t row_idx = static_cast<size_t>(iy) * grid.x_cnt + static_cast<size_t>(iz) * grid.x_cnt * grid.y_cnt;
+
+			for (uint32_t ix = block.x_lo; ix != block.x_hi; ++ix)
+				dst[row_idx + ix] = simplex_3d_grad(grid.x_beg + ix * grid.x_step, y_in, z_in, grid.seed, dst_dx[row_idx + ix], dst_dy[row_idx + ix], dst_dz[row_idx + ix]);
+		}
+	}
+}
+
+static void query_scalar(float* dst, const float* xs, const float* ys, const float* zs, uint32_t cnt, uint32_t seed)
+{
+	for (uint32_t i = 0; i != cnt; ++i)
+		dst[i] = simplex_3d(xs[i], ys[i], zs[i], seed);
+}
+
+static uint8_t quantize_uint8(float v)
+{
+	float q = v * 128.0F + 128.0F;
+
+	if (q < 0.0F)
+		q = 0.0F;
+	else if (q > 255.0F)
+		q = 255.0F;
+
+	return static_cast<uint8_t>(q);
+}
+
+static void fill_uint8_scalar(uint8_t* dst, const simplex_grid& grid, const simplex_block& block)
+{
+	for (uint32_t iz = block.z_lo; iz != block.z_hi; ++iz)
+	{
+		const float z_in = grid.z_beg + iz * grid.z_step;
+
+		for (uint32_t iy = block.y_lo; iy != block.y_hi; ++iy)
+		{
+			const float y_in = grid.y_beg + iy * grid.y_step;
+
+			uint8_t* const row_dst = dst + static_cast<size_t>(iy) * grid.x_cnt + static_cast<size_t>(iz) * grid.x_cnt * grid.y_cnt;
+
+			for (uint32_t ix = block.x_lo; ix != block.x_hi; ++ix)
+				row_dst[ix] = quantize_uint8(simplex_3d(grid.x_beg + ix * grid.x_step, y_in, z_in, grid.seed));
+		}
+	}
+}
+
+static void fill_bits_scalar(uint64_t* dst, const simplex_grid& grid, float threshold, const simplex_block& block)
+{
+	const uint32_t row_words = occupancy_row_words(grid.x_cnt);
+
+	for (uint32_t iz = block.z_lo; iz != block.z_hi; ++iz)
+	{
+		const float z_in = grid.z_beg + iz * grid.z_step;
+
+		for (uint32_t iy = block.y_lo; iy != block.y_hi; ++iy)
+		{
+			const float y_in = grid.y_beg + iy * grid.y_step;
+
+			uint64_t* const row_dst = dst + (static_cast<size_t>(iy) + static_cast<size_t>(iz) * grid.y_cnt) * row_words;
+
+			for (uint32_t word_beg = block.x_lo; word_beg < block.x_hi; word_beg += 64)
 			{
-				const float x_in0 = x_beg + ix * x_step;
+				uint64_t word = 0;
+
+				for (uint32_t b = 0; b != 64 && word_beg + b != block.x_hi; ++b)
+					word |= static_cast<uint64_t>(simplex_3d(grid.x_beg + (word_beg + b) * grid.x_step, y_in, z_in, grid.seed) > threshold) << b;
+
+				row_dst[word_beg / 64] = word;
+			}
+		}
+	}
+}
+
+const simplex_backend simplex_backend_scalar{ simd_tier::scalar, 1, fill_scalar, fill_fbm_scalar, fill_grad_scalar, query_scalar, fill_uint8_scalar, fill_bits_scalar };
+
+static const simplex_backend* backend_for_tier(simd_tier tier) noexcept
+{
+	switch (tier)
+	{
+	case simd_tier::avx512: return &simplex_backend_avx512;
+	case simd_tier::avx2:   return &simplex_backend_avx2;
+	case simd_tier::sse4:   return &simplex_backend_sse4;
+	default:                return &simplex_backend_scalar;
+	}
+}
+
+static std::atomic<const simplex_backend*>& active_backend_ptr() noexcept
+{
+	static std::atomic<const simplex_backend*> backend{ backend_for_tier(detect_simd_tier()) };
+
+	return backend;
+}
 
-				const __m256 _x_in0 = _mm256_set1_ps(x_in0);
+const simplex_backend& simplex_active_backend() noexcept
+{
+	return *active_backend_ptr().load(std::memory_order_relaxed);
+}
+
+simd_tier simplex_force_tier(simd_tier tier)
+{
+	tier = clamp_simd_tier(tier);
 
-				const __m256 _x_in = _mm256_add_ps(_x_in0, _x_offsets);
+	active_backend_ptr().store(backend_for_tier(tier), std::memory_order_relaxed);
 
-				const __m256 _y_in = _mm256_set1_ps(y_in);
+	return tier;
+}
 
-				const __m256 _z_in = _mm256_set1_ps(z_in);
+simd_tier simplex_active_tier()
+{
+	return simplex_active_backend().tier;
+}
 
-				const __m256 _skew_sum = _mm256_add_ps(_x_in, _mm256_add_ps(_y_in, _z_in));
+static simplex_grid make_grid(float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed)
+{
+	return { x_beg, y_beg, z_beg, x_size / x_cnt, y_size / y_cnt, z_size / z_cnt, x_cnt, y_cnt, z_cnt, seed };
+}
 
-				const __m256 _skew = _mm256_mul_ps(_skew_sum, _skew_factor);
+void simplex_3d_fill(float* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed)
+{
+	const simplex_grid grid = make_grid(x_beg, y_beg, z_beg, x_size, y_size, z_size, x_cnt, y_cnt, z_cnt, seed);
 
-				const __m256 _i0 = _mm256_floor_ps(_mm256_add_ps(_x_in, _skew));
-				const __m256 _j0 = _mm256_floor_ps(_mm256_add_ps(_y_in, _skew));
-				const __m256 _k0 = _mm256_floor_ps(_mm256_add_ps(_z_in, _skew));
+	simplex_active_backend().fill(dst, grid, { 0, x_cnt, 0, y_cnt, 0, z_cnt });
+}
 
-				const __m256 _unskew_sum = _mm256_add_ps(_i0, _mm256_add_ps(_j0, _k0));
+static simplex_octaves make_octaves(const fbm_params& params)
+{
+	simplex_octaves octaves;
 
-				const __m256 _unskew = _mm256_mul_ps(_unskew_sum, _unskew_factor);
+	octaves.cnt = params.octaves < simplex_max_octaves ? params.octaves : simplex_max_octaves;
 
-				const __m256 _x_orig = _mm256_sub_ps(_i0, _unskew);
-				const __m256 _y_orig = _mm256_sub_ps(_j0, _unskew);
-				const __m256 _z_orig = _mm256_sub_ps(_k0, _unskew);
+	float freq = 1.0F;
+	float amp = 1.0F;
+	float amp_sum = 0.0F;
 
-				const __m256 _x0 = _mm256_sub_ps(_x_in, _x_orig);
-				const __m256 _y0 = _mm256_sub_ps(_y_in, _y_orig);
-				const __m256 _z0 = _mm256_sub_ps(_z_in, _z_orig);
+	for (uint32_t o = 0; o != octaves.cnt; ++o)
+	{
+		octaves.freq[o] = freq;
+		octaves.amp[o] = amp;
+		octaves.seed[o] = params.seed + o * params.seed_step;
 
-				const __m256 _one = _mm256_set1_ps(1.0F);
+		amp_sum += amp;
 
-				const __m256 _x_ge_y = _mm256_cmp_ps(_x0, _y0, 29);
-				const __m256 _x_ge_z = _mm256_cmp_ps(_x0, _z0, 29);
-				const __m256 _y_ge_z = _mm256_cmp_ps(_y0, _z0, 29);
+		freq *= params.lacunarity;
+		amp *= params.gain;
+	}
 
-				const __m256 _i1 = _mm256_and_ps(   _mm256_and_ps(   _x_ge_y, _x_ge_z), _one);		//max == x
-				const __m256 _j1 = _mm256_and_ps(   _mm256_andnot_ps(_x_ge_y, _y_ge_z), _one);		//max == y
-				const __m256 _k1 = _mm256_andnot_ps(_mm256_or_ps(    _x_ge_z, _y_ge_z), _one);		//max == z
+	for (uint32_t o = 0; o != octaves.cnt; ++o)
+		octaves.amp[o] /= amp_sum;
 
-				const __m256 _i2 = _mm256_and_ps(   _mm256_or_ps(    _x_ge_y, _x_ge_z), _one);		//min != x
-				const __m256 _j2 = _mm256_andnot_ps(_mm256_andnot_ps(_y_ge_z, _x_ge_y), _one);		//min != y
-				const __m256 _k2 = _mm256_andnot_ps(_mm256_and_ps(   _x_ge_z, _y_ge_z), _one);		//min != z
+	return octaves;
+}
 
-				const __m256 _x1 = _mm256_add_ps(_mm256_sub_ps(_x0, _i1), _unskew_factor);
-				const __m256 _y1 = _mm256_add_ps(_mm256_sub_ps(_y0, _j1), _unskew_factor);
-				const __m256 _z1 = _mm256_add_ps(_mm256_sub_ps(_z0, _k1), _unskew_factor);
+float simplex_3d_fbm(float x_in, float y_in, float z_in, const fbm_params& params)
+{
+	return fbm_scalar(x_in, y_in, z_in, make_octaves(params));
+}
 
-				const __m256 _two_unskew_factor = _mm256_add_ps(_unskew_factor, _unskew_factor);
-				const __m256 _point_five = _mm256_add_ps(_two_unskew_factor, _unskew_factor);
+void simplex_3d_fill_grad(float* dst, float* dst_dx, float* dst_dy, float* dst_dz, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed)
+{
+	const simplex_grid grid = make_grid(x_beg, y_beg, z_beg, x_size, y_size, z_size, x_cnt, y_cnt, z_cnt, seed);
 
-				const __m256 _x2 = _mm256_add_ps(_mm256_sub_ps(_x0, _i2), _two_unskew_factor);
-				const __m256 _y2 = _mm256_add_ps(_mm256_sub_ps(_y0, _j2), _two_unskew_factor);
-				const __m256 _z2 = _mm256_add_ps(_mm256_sub_ps(_z0, _k2), _two_unskew_factor);
+	simplex_active_backend().fill_grad(dst, dst_dx, dst_dy, dst_dz, grid, { 0, x_cnt, 0, y_cnt, 0, z_cnt });
+}
 
-				const __m256 _x3 = _mm256_sub_ps(_x0, _point_five);
-				const __m256 _y3 = _mm256_sub_ps(_y0, _point_five);
-				const __m256 _z3 = _mm256_sub_ps(_z0, _point_five);
+void simplex_3d_fill_uint8(uint8_t* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed)
+{
+	const simplex_grid grid = make_grid(x_beg, y_beg, z_beg, x_size, y_size, z_size, x_cnt, y_cnt, z_cnt, seed);
 
-				const __m256 _square_sum0 = _mm256_add_ps(_mm256_mul_ps(_x0, _x0), _mm256_add_ps(_mm256_mul_ps(_y0, _y0), _mm256_mul_ps(_z0, _z0)));
-				const __m256 _square_sum1 = _mm256_add_ps(_mm256_mul_ps(_x1, _x1), _mm256_add_ps(_mm256_mul_ps(_y1, _y1), _mm256_mul_ps(_z1, _z1)));
-				const __m256 _square_sum2 = _mm256_add_ps(_mm256_mul_ps(_x2, _x2), _mm256_add_ps(_mm256_mul_ps(_y2, _y2), _mm256_mul_ps(_z2, _z2)));
-				const __m256 _square_sum3 = _mm256_add_ps(_mm256_mul_ps(_x3, _x3), _mm256_add_ps(_mm256_mul_ps(_y3, _y3), _mm256_mul_ps(_z3, _z3)));
+	simplex_active_backend().fill_uint8(dst, grid, { 0, x_cnt, 0, y_cnt, 0, z_cnt });
+}
 
-				const __m256 _t0 = _mm256_sub_ps(_point_five, _square_sum0);
-				const __m256 _t1 = _mm256_sub_ps(_point_five, _square_sum1);
-				const __m256 _t2 = _mm256_sub_ps(_point_five, _square_sum2);
-				const __m256 _t3 = _mm256_sub_ps(_point_five, _square_sum3);
+void simplex_3d_fill_bits(uint64_t* dst, float threshold, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed)
+{
+	const simplex_grid grid = make_grid(x_beg, y_beg, z_beg, x_size, y_size, z_size, x_cnt, y_cnt, z_cnt, seed);
 
-				const __m256 _neg0 = _mm256_cmp_ps(_t0, _mm256_setzero_ps(), 29);
-				const __m256 _neg1 = _mm256_cmp_ps(_t1, _mm256_setzero_ps(), 29);
-				const __m256 _neg2 = _mm256_cmp_ps(_t2, _mm256_setzero_ps(), 29);
-				const __m256 _neg3 = _mm256_cmp_ps(_t3, _mm256_setzero_ps(), 29);
+	simplex_active_backend().fill_bits(dst, grid, threshold, { 0, x_cnt, 0, y_cnt, 0, z_cnt });
+}
 
-				const __m256 _n0 = _mm256_and_ps(_t0, _neg0);
-				const __m256 _n1 = _mm256_and_ps(_t1, _neg1);
-				const __m256 _n2 = _mm256_and_ps(_t2, _neg2);
-				const __m256 _n3 = _mm256_and_ps(_t3, _neg3);
+//Interleaves the low 10 bits of x, y and z
+static uint32_t morton_3d(uint32_t x, uint32_t y, uint32_t z)
+{
+	uint32_t r = 0;
 
-				const __m256 _n_squared0 = _mm256_mul_ps(_n0, _n0);
-				const __m256 _n_squared1 = _mm256_mul_ps(_n1, _n1);
-				const __m256 _n_squared2 = _mm256_mul_ps(_n2, _n2);
-				const __m256 _n_squared3 = _mm256_mul_ps(_n3, _n3);
+	for (uint32_t b = 0; b != 10; ++b)
+		r |= ((x >> b) & 1) << (3 * b) | ((y >> b) & 1) << (3 * b + 1) | ((z >> b) & 1) << (3 * b + 2);
 
-				const __m256 _n_cubed0 = _mm256_mul_ps(_n_squared0, _n_squared0);
-				const __m256 _n_cubed1 = _mm256_mul_ps(_n_squared1, _n_squared1);
-				const __m256 _n_cubed2 = _mm256_mul_ps(_n_squared2, _n_squared2);
-				const __m256 _n_cubed3 = _mm256_mul_ps(_n_squared3, _n_squared3);
+	return r;
+}
 
-				const __m256 _abs_i1 = _mm256_add_ps(_i0, _i1);
-				const __m256 _abs_j1 = _mm256_add_ps(_j0, _j1);
-				const __m256 _abs_k1 = _mm256_add_ps(_k0, _k1);
-				const __m256 _abs_i2 = _mm256_add_ps(_i0, _i2);
-				const __m256 _abs_j2 = _mm256_add_ps(_j0, _j2);
-				const __m256 _abs_k2 = _mm256_add_ps(_k0, _k2);
-				const __m256 _abs_i3 = _mm256_add_ps(_i0, _one);
-				const __m256 _abs_j3 = _mm256_add_ps(_j0, _one);
-				const __m256 _abs_k3 = _mm256_add_ps(_k0, _one);
+void simplex_3d_query(float* dst, const float* xs, const float* ys, const float* zs, uint32_t cnt, uint32_t seed, bool sort_for_locality)
+{
+	const simplex_backend& backend = simplex_active_backend();
 
-				const __m256 _r0 = _mm256_mul_ps(_n_cubed0, dot_with_vec(    _i0,     _j0,     _k0, _x0, _y0, _z0, _seed));
-				const __m256 _r1 = _mm256_mul_ps(_n_cubed1, dot_with_vec(_abs_i1, _abs_j1, _abs_k1, _x1, _y1, _z1, _seed));
-				const __m256 _r2 = _mm256_mul_ps(_n_cubed2, dot_with_vec(_abs_i2, _abs_j2, _abs_k2, _x2, _y2, _z2, _seed));
-				const __m256 _r3 = _mm256_mul_ps(_n_cubed3, dot_with_vec(_abs_i3, _abs_j3, _abs_k3, _x3, _y3, _z3, _seed));
+	if (!sort_for_locality)
+	{
+		backend.query(dst, xs, ys, zs, cnt, seed);
 
-				const __m256 _thirty_two = _mm256_set1_ps(76.0F);
+		return;
+	}
 
-				const __m256 _r_sum = _mm256_add_ps(_mm256_add_ps(_r0, _r1), _mm256_add_ps(_r2, _r3));
+	//Order queries by the Morton-code of their unit cell, so that each SIMD batch holds neighbouring points.
+	//Key in the upper, original index in the lower 32 bits
+	std::vector<uint64_t> order(cnt);
 
-				const __m256 _r = _mm256_sub_ps(_r_sum, _thirty_two);
+	for (uint32_t i = 0; i != cnt; ++i)
+	{
+		const uint32_t key = morton_3d(static_cast<uint32_t>(static_cast<int32_t>(floorf(xs[i]))), static_cast<uint32_t>(static_cast<int32_t>(floorf(ys[i]))), static_cast<uint32_t>(static_cast<int32_t>(floorf(zs[i]))));
 
-				_mm256_store_ps(dst + ix + iy * x_cnt + iz * x_cnt * y_cnt, _r);
-			}
-		}
+		order[i] = static_cast<uint64_t>(key) << 32 | i;
 	}
+
+	std::sort(order.begin(), order.end());
+
+	std::vector<float> sorted(static_cast<size_t>(cnt) * 4);
+
+	float* const sorted_x = sorted.data();
+	float* const sorted_y = sorted_x + cnt;
+	float* const sorted_z = sorted_y + cnt;
+	float* const sorted_dst = sorted_z + cnt;
+
+	for (uint32_t i = 0; i != cnt; ++i)
+	{
+		const uint32_t src_idx = static_cast<uint32_t>(order[i]);
+
+		sorted_x[i] = xs[src_idx];
+		sorted_y[i] = ys[src_idx];
+		sorted_z[i] = zs[src_idx];
+	}
+
+	backend.query(sorted_dst, sorted_x, sorted_y, sorted_z, cnt, seed);
+
+	for (uint32_t i = 0; i != cnt; ++i)
+		dst[static_cast<uint32_t>(order[i])] = sorted_dst[i];
+}
+
+//Tile dimensions used by the parallel fills. x is kept a multiple of 16 so only the last tile of a row needs partial stores on any tier.
+//A tile covers 64 * 16 * 8 floats (32 KiB), which stays resident in L1/L2 while it is being written.
+constexpr uint32_t fill_tile_x = 64;
+constexpr uint32_t fill_tile_y = 16;
+constexpr uint32_t fill_tile_z = 8;
+
+//Splits the grid into tiles and calls fn for each of them on the threads of thread_pool::global()
+static void for_each_fill_tile(const simplex_grid& grid, uint32_t max_threads, const std::function<void(const simplex_block&)>& fn)
+{
+	const uint32_t x_tiles = (grid.x_cnt + fill_tile_x - 1) / fill_tile_x;
+	const uint32_t y_tiles = (grid.y_cnt + fill_tile_y - 1) / fill_tile_y;
+	const uint32_t z_tiles = (grid.z_cnt + fill_tile_z - 1) / fill_tile_z;
+
+	//Tiles are numbered x-fastest, so the contiguous runs of tiles handed to each thread are also contiguous in memory
+	thread_pool::global().parallel_for(x_tiles * y_tiles * z_tiles, [&](uint32_t tile_idx, uint32_t)
+		{
+			const uint32_t tx = tile_idx % x_tiles;
+			const uint32_t ty = tile_idx / x_tiles % y_tiles;
+			const uint32_t tz = tile_idx / x_tiles / y_tiles;
+
+			simplex_block block;
+
+			block.x_lo = tx * fill_tile_x;
+			block.y_lo = ty * fill_tile_y;
+			block.z_lo = tz * fill_tile_z;
+
+			block.x_hi = block.x_lo + fill_tile_x < grid.x_cnt ? block.x_lo + fill_tile_x : grid.x_cnt;
+			block.y_hi = block.y_lo + fill_tile_y < grid.y_cnt ? block.y_lo + fill_tile_y : grid.y_cnt;
+			block.z_hi = block.z_lo + fill_tile_z < grid.z_cnt ? block.z_lo + fill_tile_z : grid.z_cnt;
+
+			fn(block);
+		}, max_threads);
+}
+
+void simplex_3d_fill_parallel(float* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed, uint32_t max_threads)
+{
+	const simplex_grid grid = make_grid(x_beg, y_beg, z_beg, x_size, y_size, z_size, x_cnt, y_cnt, z_cnt, seed);
+
+	const simplex_backend& backend = simplex_active_backend();
+
+	for_each_fill_tile(grid, max_threads, [&](const simplex_block& block) { backend.fill(dst, grid, block); });
+}
+
+void simplex_3d_fbm_fill(float* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, const fbm_params& params)
+{
+	const simplex_grid grid = make_grid(x_beg, y_beg, z_beg, x_size, y_size, z_size, x_cnt, y_cnt, z_cnt, params.seed);
+
+	const simplex_octaves octaves = make_octaves(params);
+
+	simplex_active_backend().fill_fbm(dst, grid, octaves, { 0, x_cnt, 0, y_cnt, 0, z_cnt });
+}
+
+void simplex_3d_fbm_fill_parallel(float* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, const fbm_params& params, uint32_t max_threads)
+{
+	const simplex_grid grid = make_grid(x_beg, y_beg, z_beg, x_size, y_size, z_size, x_cnt, y_cnt, z_cnt, params.seed);
+
+	const simplex_octaves octaves = make_octaves(params);
+
+	const simplex_backend& backend = simplex_active_backend();
+
+	for_each_fill_tile(grid, max_threads, [&](const simplex_block& block) { backend.fill_fbm(dst, grid, octaves, block); });
+}
+
+void simplex_3d_fill_grad_parallel(float* dst, float* dst_dx, float* dst_dy, float* dst_dz, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed, uint32_t max_threads)
+{
+	const simplex_grid grid = make_grid(x_beg, y_beg, z_beg, x_size, y_size, z_size, x_cnt, y_cnt, z_cnt, seed);
+
+	const simplex_backend& backend = simplex_active_backend();
+
+	for_each_fill_tile(grid, max_threads, [&](const simplex_block& block) { backend.fill_grad(dst, dst_dx, dst_dy, dst_dz, grid, block); });
+}
+
+void simplex_3d_fill_uint8_parallel(uint8_t* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed, uint32_t max_threads)
+{
+	const simplex_grid grid = make_grid(x_beg, y_beg, z_beg, x_size, y_size, z_size, x_cnt, y_cnt, z_cnt, seed);
+
+	const simplex_backend& backend = simplex_active_backend();
+
+	for_each_fill_tile(grid, max_threads, [&](const simplex_block& block) { backend.fill_uint8(dst, grid, block); });
+}
+
+//Relies on fill_tile_x being a multiple of 64, so that no two tiles share an output word
+void simplex_3d_fill_bits_parallel(uint64_t* dst, float threshold, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed, uint32_t max_threads)
+{
+	static_assert(fill_tile_x % 64 == 0, "Tiles of simplex_3d_fill_bits_parallel must not share words");
+
+	const simplex_grid grid = make_grid(x_beg, y_beg, z_beg, x_size, y_size, z_size, x_cnt, y_cnt, z_cnt, seed);
+
+	const simplex_backend& backend = simplex_active_backend();
+
+	for_each_fill_tile(grid, max_threads, [&](const simplex_block& block) { backend.fill_bits(dst, grid, threshold, block); });
 }
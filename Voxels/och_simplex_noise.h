@@ -3,6 +3,73 @@
 #include <cstdint>
 #include <cmath>
 
+#include "och_cpu_features.h"
+
 float simplex_3d(float x_in, float y_in, float z_in, uint32_t seed = 0);
 
-void simplex_3d_fill(float* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed = 0);
\ No newline at end of file
+//Same value as simplex_3d, additionally writing its analytic gradient d/dx, d/dy and d/dz
+float simplex_3d_grad(float x_in, float y_in, float z_in, uint32_t seed, float& dx, float& dy, float& dz);
+
+//Fractal Brownian motion: octave o samples simplex_3d at lacunarity^o times the frequency with gain^o times the amplitude.
+//The result is divided by the sum of all amplitudes, so it stays within the range of simplex_3d.
+struct fbm_params
+{
+	uint32_t octaves = 6;		//Clamped to 16
+	float lacunarity = 2.0F;
+	float gain = 0.5F;
+	uint32_t seed = 0;			//Octave o uses seed + o * seed_step
+	uint32_t seed_step = 1;
+};
+
+float simplex_3d_fbm(float x_in, float y_in, float z_in, const fbm_params& params);
+
+//Fills dst with x_cnt * y_cnt * z_cnt samples (x fastest) of the box starting at (x_beg, y_beg, z_beg).
+//Uses the widest instruction set tier supported by the CPU, unless another one has been forced through simplex_force_tier.
+void simplex_3d_fill(float* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed = 0);
+
+//Same output as simplex_3d_fill, with the box split into tiles that are spread over the threads of thread_pool::global().
+//max_threads caps the number of threads used for this call, 0 meaning no cap.
+void simplex_3d_fill_parallel(float* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed = 0, uint32_t max_threads = 0);
+
+//Like simplex_3d_fill, additionally writing the gradient of every sample into the SoA planes dst_dx, dst_dy and dst_dz,
+//each laid out like dst. The derivatives come out of the same pass at a fraction of the cost of central differences.
+void simplex_3d_fill_grad(float* dst, float* dst_dx, float* dst_dy, float* dst_dz, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed = 0);
+
+void simplex_3d_fill_grad_parallel(float* dst, float* dst_dx, float* dst_dy, float* dst_dz, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed = 0, uint32_t max_threads = 0);
+
+//Like simplex_3d_fill, but quantizes every sample to uint8_t with the v * 128 + 128 mapping of d_simplex_3d_uint8_t inside the SIMD loop.
+//Needs no float intermediate, writing one byte per voxel.
+void simplex_3d_fill_uint8(uint8_t* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed = 0);
+
+void simplex_3d_fill_uint8_parallel(uint8_t* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed = 0, uint32_t max_threads = 0);
+
+//Number of uint64_t words in one row of a row-linear occupancy volume
+constexpr uint32_t occupancy_row_words(uint32_t x_cnt) noexcept
+{
+	return (x_cnt + 63) / 64;
+}
+
+//Like simplex_3d_fill, but writes one occupancy bit per voxel, set if the sample is greater than threshold (as in d_float_to_bit).
+//The layout is row-linear: voxel (x, y, z) is bit x % 64 of word dst[x / 64 + (y + z * y_cnt) * occupancy_row_words(x_cnt)].
+//Unused bits at the end of a row are zero.
+void simplex_3d_fill_bits(uint64_t* dst, float threshold, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed = 0);
+
+void simplex_3d_fill_bits_parallel(uint64_t* dst, float threshold, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, uint32_t seed = 0, uint32_t max_threads = 0);
+
+//Samples simplex_3d at cnt unrelated points given as SoA arrays, writing the result for (xs[i], ys[i], zs[i]) to dst[i].
+//Points are evaluated a full vector at a time with a masked tail, so no padding is required. Results match simplex_3d within
+//float rounding: the AVX2 and AVX-512 tiers fuse multiply-adds, which moves them by up to about 1e-4, while SSE4.1 is bit-identical.
+//sort_for_locality first orders the points by the Morton-code of their unit cell, so each batch holds neighbouring points.
+//This costs an extra O(n log n) pass and a gather / scatter of the points, which the noise kernel alone does not win back.
+void simplex_3d_query(float* dst, const float* xs, const float* ys, const float* zs, uint32_t cnt, uint32_t seed = 0, bool sort_for_locality = false);
+
+//Like simplex_3d_fill, but samples simplex_3d_fbm. All octaves of a voxel are summed in registers and written once
+void simplex_3d_fbm_fill(float* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, const fbm_params& params);
+
+void simplex_3d_fbm_fill_parallel(float* dst, float x_beg, float y_beg, float z_beg, float x_size, float y_size, float z_size, uint32_t x_cnt, uint32_t y_cnt, uint32_t z_cnt, const fbm_params& params, uint32_t max_threads = 0);
+
+//Forces the fill functions to use clamp_simd_tier(tier), e.g. for benchmarking, and returns that tier.
+//Passing detect_simd_tier() restores the default.
+simd_tier simplex_force_tier(simd_tier tier);
+
+simd_tier simplex_active_tier();
\ No newline at end of file
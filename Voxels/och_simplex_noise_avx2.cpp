@@ -0,0 +1,127 @@
+#include "och_simplex_noise_backends.h"
+
+#include <cstdint>
+
+#include <immintrin.h>
+
+//Compiled with /arch:AVX2 (see Voxels.vcxproj); GCC and Clang get the equivalent target here
+#if defined(__GNUC__) && !defined(__AVX2__)
+#pragma GCC target("avx2,fma")
+#endif
+
+#include "och_simplex_noise_simd.h"
+
+struct avx2_ops
+{
+	using vf = __m256;
+	using vi = __m256i;
+	using vm = __m256;
+
+	static constexpr uint32_t width = 8;
+
+	static OCH_SIMD_INLINE vf set1(float v) { return _mm256_set1_ps(v); }
+
+	static OCH_SIMD_INLINE vi set1_i(int32_t v) { return _mm256_set1_epi32(v); }
+
+	static OCH_SIMD_INLINE vf iota(uint32_t base) { return _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(base)), _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0))); }
+
+	static OCH_SIMD_INLINE vf add(vf a, vf b) { return _mm256_add_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf sub(vf a, vf b) { return _mm256_sub_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf mul(vf a, vf b) { return _mm256_mul_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf max(vf a, vf b) { return _mm256_max_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf min(vf a, vf b) { return _mm256_min_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf floor(vf a) { return _mm256_floor_ps(a); }
+
+	static OCH_SIMD_INLINE vm cmp_ge(vf a, vf b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+
+	static OCH_SIMD_INLINE vm cmp_gt(vf a, vf b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+
+	static OCH_SIMD_INLINE uint32_t movemask(vm m) { return static_cast<uint32_t>(_mm256_movemask_ps(m)); }
+
+	static OCH_SIMD_INLINE vm m_and(vm a, vm b) { return _mm256_and_ps(a, b); }
+
+	static OCH_SIMD_INLINE vm m_andnot(vm a, vm b) { return _mm256_andnot_ps(a, b); }
+
+	static OCH_SIMD_INLINE vm m_or(vm a, vm b) { return _mm256_or_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf one_if(vm m) { return _mm256_and_ps(m, _mm256_set1_ps(1.0F)); }
+
+	static OCH_SIMD_INLINE vf one_if_not(vm m) { return _mm256_andnot_ps(m, _mm256_set1_ps(1.0F)); }
+
+	static OCH_SIMD_INLINE vi cvtt(vf a) { return _mm256_cvttps_epi32(a); }
+
+	static OCH_SIMD_INLINE vi bits(vf a) { return _mm256_castps_si256(a); }
+
+	static OCH_SIMD_INLINE vi mullo(vi a, int32_t b) { return _mm256_mullo_epi32(a, _mm256_set1_epi32(b)); }
+
+	static OCH_SIMD_INLINE vi xor_i(vi a, vi b) { return _mm256_xor_si256(a, b); }
+
+	static OCH_SIMD_INLINE vi srli(vi a, int n) { return _mm256_srli_epi32(a, n); }
+
+	static OCH_SIMD_INLINE vf lookup16(const float* tbl, vi idx) { return _mm256_i32gather_ps(tbl, idx, 4); }
+
+	static OCH_SIMD_INLINE vf loadu(const float* src) { return _mm256_loadu_ps(src); }
+
+	static OCH_SIMD_INLINE vf load_partial(const float* src, uint32_t cnt)
+	{
+		const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int32_t>(cnt)), _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+
+		return _mm256_maskload_ps(src, mask);
+	}
+
+	static OCH_SIMD_INLINE void storeu(float* dst, vf v) { _mm256_storeu_ps(dst, v); }
+
+	static OCH_SIMD_INLINE void store_partial(float* dst, vf v, uint32_t cnt)
+	{
+		const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int32_t>(cnt)), _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+
+		_mm256_maskstore_ps(dst, mask, v);
+	}
+
+	static OCH_SIMD_INLINE void store_u8(uint8_t* dst, vi v)
+	{
+		//Gather the low byte of each lane into the low four bytes of each 128-bit half, then join the halves
+		const __m256i bytes = _mm256_shuffle_epi8(v, _mm256_set_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 12, 8, 4, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 12, 8, 4, 0));
+
+		const __m256i joined = _mm256_permutevar8x32_epi32(bytes, _mm256_set_epi32(7, 7, 7, 7, 7, 7, 4, 0));
+
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(joined));
+	}
+};
+
+static void fill_avx2(float* dst, const simplex_grid& grid, const simplex_block& block)
+{
+	simplex_fill_block<avx2_ops>(dst, grid, block);
+}
+
+static void fill_fbm_avx2(float* dst, const simplex_grid& grid, const simplex_octaves& octaves, const simplex_block& block)
+{
+	simplex_fbm_fill_block<avx2_ops>(dst, grid, octaves, block);
+}
+
+static void fill_grad_avx2(float* dst, float* dst_dx, float* dst_dy, float* dst_dz, const simplex_grid& grid, const simplex_block& block)
+{
+	simplex_fill_grad_block<avx2_ops>(dst, dst_dx, dst_dy, dst_dz, grid, block);
+}
+
+static void query_avx2(float* dst, const float* xs, const float* ys, const float* zs, uint32_t cnt, uint32_t seed)
+{
+	simplex_query_points<avx2_ops>(dst, xs, ys, zs, cnt, seed);
+}
+
+static void fill_uint8_avx2(uint8_t* dst, const simplex_grid& grid, const simplex_block& block)
+{
+	simplex_fill_uint8_block<avx2_ops>(dst, grid, block);
+}
+
+static void fill_bits_avx2(uint64_t* dst, const simplex_grid& grid, float threshold, const simplex_block& block)
+{
+	simplex_fill_bits_block<avx2_ops>(dst, grid, threshold, block);
+}
+
+const simplex_backend simplex_backend_avx2{ simd_tier::avx2, avx2_ops::width, fill_avx2, fill_fbm_avx2, fill_grad_avx2, query_avx2, fill_uint8_avx2, fill_bits_avx2 };
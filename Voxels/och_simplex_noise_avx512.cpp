@@ -0,0 +1,115 @@
+#include "och_simplex_noise_backends.h"
+
+#include <cstdint>
+
+#include <immintrin.h>
+
+//Compiled with /arch:AVX512 (see Voxels.vcxproj); GCC and Clang get the equivalent target here
+#if defined(__GNUC__) && !defined(__AVX512F__)
+#pragma GCC target("avx512f,avx512cd,avx512bw,avx512dq,avx512vl,avx2,fma")
+#endif
+
+#include "och_simplex_noise_simd.h"
+
+struct avx512_ops
+{
+	using vf = __m512;
+	using vi = __m512i;
+	using vm = __mmask16;
+
+	static constexpr uint32_t width = 16;
+
+	static OCH_SIMD_INLINE vf set1(float v) { return _mm512_set1_ps(v); }
+
+	static OCH_SIMD_INLINE vi set1_i(int32_t v) { return _mm512_set1_epi32(v); }
+
+	static OCH_SIMD_INLINE vf iota(uint32_t base)
+	{
+		const __m512i lane_idx = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+		return _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_set1_epi32(static_cast<int32_t>(base)), lane_idx));
+	}
+
+	static OCH_SIMD_INLINE vf add(vf a, vf b) { return _mm512_add_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf sub(vf a, vf b) { return _mm512_sub_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf mul(vf a, vf b) { return _mm512_mul_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf max(vf a, vf b) { return _mm512_max_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf min(vf a, vf b) { return _mm512_min_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf floor(vf a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+
+	static OCH_SIMD_INLINE vm cmp_ge(vf a, vf b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+
+	static OCH_SIMD_INLINE vm cmp_gt(vf a, vf b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+
+	static OCH_SIMD_INLINE uint32_t movemask(vm m) { return static_cast<uint32_t>(m); }
+
+	static OCH_SIMD_INLINE vm m_and(vm a, vm b) { return static_cast<vm>(a & b); }
+
+	static OCH_SIMD_INLINE vm m_andnot(vm a, vm b) { return static_cast<vm>(~a & b); }
+
+	static OCH_SIMD_INLINE vm m_or(vm a, vm b) { return static_cast<vm>(a | b); }
+
+	static OCH_SIMD_INLINE vf one_if(vm m) { return _mm512_maskz_mov_ps(m, _mm512_set1_ps(1.0F)); }
+
+	static OCH_SIMD_INLINE vf one_if_not(vm m) { return _mm512_maskz_mov_ps(static_cast<vm>(~m), _mm512_set1_ps(1.0F)); }
+
+	static OCH_SIMD_INLINE vi cvtt(vf a) { return _mm512_cvttps_epi32(a); }
+
+	static OCH_SIMD_INLINE vi bits(vf a) { return _mm512_castps_si512(a); }
+
+	static OCH_SIMD_INLINE vi mullo(vi a, int32_t b) { return _mm512_mullo_epi32(a, _mm512_set1_epi32(b)); }
+
+	static OCH_SIMD_INLINE vi xor_i(vi a, vi b) { return _mm512_xor_si512(a, b); }
+
+	static OCH_SIMD_INLINE vi srli(vi a, int n) { return _mm512_srli_epi32(a, n); }
+
+	//The whole 16-entry table fits into one register, so this is a single permute instead of a gather
+	static OCH_SIMD_INLINE vf lookup16(const float* tbl, vi idx) { return _mm512_permutexvar_ps(idx, _mm512_load_ps(tbl)); }
+
+	static OCH_SIMD_INLINE vf loadu(const float* src) { return _mm512_loadu_ps(src); }
+
+	static OCH_SIMD_INLINE vf load_partial(const float* src, uint32_t cnt) { return _mm512_maskz_loadu_ps(static_cast<__mmask16>((1u << cnt) - 1), src); }
+
+	static OCH_SIMD_INLINE void storeu(float* dst, vf v) { _mm512_storeu_ps(dst, v); }
+
+	static OCH_SIMD_INLINE void store_partial(float* dst, vf v, uint32_t cnt) { _mm512_mask_storeu_ps(dst, static_cast<__mmask16>((1u << cnt) - 1), v); }
+
+	static OCH_SIMD_INLINE void store_u8(uint8_t* dst, vi v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm512_cvtepi32_epi8(v)); }
+};
+
+static void fill_avx512(float* dst, const simplex_grid& grid, const simplex_block& block)
+{
+	simplex_fill_block<avx512_ops>(dst, grid, block);
+}
+
+static void fill_fbm_avx512(float* dst, const simplex_grid& grid, const simplex_octaves& octaves, const simplex_block& block)
+{
+	simplex_fbm_fill_block<avx512_ops>(dst, grid, octaves, block);
+}
+
+static void fill_grad_avx512(float* dst, float* dst_dx, float* dst_dy, float* dst_dz, const simplex_grid& grid, const simplex_block& block)
+{
+	simplex_fill_grad_block<avx512_ops>(dst, dst_dx, dst_dy, dst_dz, grid, block);
+}
+
+static void query_avx512(float* dst, const float* xs, const float* ys, const float* zs, uint32_t cnt, uint32_t seed)
+{
+	simplex_query_points<avx512_ops>(dst, xs, ys, zs, cnt, seed);
+}
+
+static void fill_uint8_avx512(uint8_t* dst, const simplex_grid& grid, const simplex_block& block)
+{
+	simplex_fill_uint8_block<avx512_ops>(dst, grid, block);
+}
+
+static void fill_bits_avx512(uint64_t* dst, const simplex_grid& grid, float threshold, const simplex_block& block)
+{
+	simplex_fill_bits_block<avx512_ops>(dst, grid, threshold, block);
+}
+
+const simplex_backend simplex_backend_avx512{ simd_tier::avx512, avx512_ops::width, fill_avx512, fill_fbm_avx512, fill_grad_avx512, query_avx512, fill_uint8_avx512, fill_bits_avx512 };
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+
+#include "och_cpu_features.h"
+
+//Mapping from grid-indices to noise-space coordinates. Voxel (ix, iy, iz) is sampled at (x_beg + ix * x_step, ...)
+struct simplex_grid
+{
+	float x_beg, y_beg, z_beg;
+	float x_step, y_step, z_step;
+	uint32_t x_cnt, y_cnt, z_cnt;
+	uint32_t seed;
+};
+
+//Half-open index-range [lo, hi) on each axis of a simplex_grid
+struct simplex_block
+{
+	uint32_t x_lo, x_hi;
+	uint32_t y_lo, y_hi;
+	uint32_t z_lo, z_hi;
+};
+
+constexpr uint32_t simplex_max_octaves = 16;
+
+//Per-octave frequency, amplitude and seed of a fractal sum, precomputed once so that all tiers use identical values.
+//Amplitudes are already divided by their total, so the sum stays within the range of a single octave.
+struct simplex_octaves
+{
+	uint32_t cnt;
+	float freq[simplex_max_octaves];
+	float amp[simplex_max_octaves];
+	uint32_t seed[simplex_max_octaves];
+};
+
+//Kernels provided by one instruction set tier. Each tier lives in its own translation unit, compiled for that instruction set
+struct simplex_backend
+{
+	simd_tier tier;
+
+	uint32_t width;
+
+	//Writes the voxels of block into the x_cnt * y_cnt * z_cnt array at dst
+	void (*fill)(float* dst, const simplex_grid& grid, const simplex_block& block);
+
+	//Like fill, but sums all octaves per voxel. grid.seed is ignored in favour of the per-octave seeds
+	void (*fill_fbm)(float* dst, const simplex_grid& grid, const simplex_octaves& octaves, const simplex_block& block);
+
+	//Like fill, additionally writing the analytic gradient into three planes laid out like dst
+	void (*fill_grad)(float* dst, float* dst_dx, float* dst_dy, float* dst_dz, const simplex_grid& grid, const simplex_block& block);
+
+	//Samples cnt scattered points given as SoA coordinate arrays
+	void (*query)(float* dst, const float* xs, const float* ys, const float* zs, uint32_t cnt, uint32_t seed);
+
+	//Like fill, quantizing each sample to v * 128 + 128 in the same pass
+	void (*fill_uint8)(uint8_t* dst, const simplex_grid& grid, const simplex_block& block);
+
+	//Like fill, writing one occupancy bit per sample in the row-linear layout. block.x_lo must be a multiple of 64
+	void (*fill_bits)(uint64_t* dst, const simplex_grid& grid, float threshold, const simplex_block& block);
+};
+
+extern const simplex_backend simplex_backend_scalar;
+extern const simplex_backend simplex_backend_sse4;
+extern const simplex_backend simplex_backend_avx2;
+extern const simplex_backend simplex_backend_avx512;
+
+//Backend for the tier last selected through simplex_force_tier, or the widest supported one by default
+const simplex_backend& simplex_active_backend() noexcept;
@@ -2,11 +2,7 @@
 
 #include <cstdint>
 #include <cmath>
-
-#include "cuda_d3d11_interop.h"
-#include "cuda_d3d10_interop.h"
-
-#include "device_launch_parameters.h"
+#include <vector>
 
 //__constant__ float d_grad3[12][3]
 //{
@@ -117,25 +113,19 @@ __global__ void d_simplex_3d_float(cudaPitchedPtr dst, uint3 dim, float3 begin,
 	if (t3 < 0.0F) t3 = 0.0F;
 	t3 = t3 * t3 * t3 * t3 * d_dot_with_hashed_vec(1.0F + i0, 1.0F + j0, 1.0F + k0, x3, y3, z3, seed);
 
+	//dst.pitch is in bytes, so rows are addressed before casting to float
+
+	float* row = reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(dst.ptr) + idx_y * dst.pitch + idx_z * dst.pitch * dst.ysize);
+
 	//76.0F maps to just within [-1.0F, 1.0F]
-	reinterpret_cast<float*>(dst.ptr)[idx_x + idx_y * dst.pitch + idx_z * dst.pitch * dst.ysize] = 76.0F * (t0 + t1 + t2 + t3);
+	row[idx_x] = 76.0F * (t0 + t1 + t2 + t3);
 
 	return;
 }
 
-__global__ void d_simplex_3d_uint8_t(cudaPitchedPtr dst, uint3 dim, float3 begin, float3 step, uint32_t seed)
+//Noise at (x_in, y_in, z_in), mapped to [0, 255] as stored by d_simplex_3d_uint8_t
+inline __device__ uint8_t d_simplex_3d_uint8_value(float x_in, float y_in, float z_in, uint32_t seed)
 {
-	const uint32_t idx_x = blockIdx.x * blockDim.x + threadIdx.x;
-	const uint32_t idx_y = blockIdx.y * blockDim.y + threadIdx.y;
-	const uint32_t idx_z = blockIdx.z * blockDim.z + threadIdx.z;
-
-	if (idx_x >= dim.x || idx_y >= dim.y || idx_z >= dim.z)
-		return;
-
-	const float x_in = begin.x + step.x * idx_x;
-	const float y_in = begin.y + step.y * idx_y;
-	const float z_in = begin.z + step.z * idx_z;
-
 	//Begin algorithm
 
 	constexpr float skew_factor = 1.0F / 3.0F;
@@ -193,9 +183,44 @@ __global__ void d_simplex_3d_uint8_t(cudaPitchedPtr dst, uint3 dim, float3 begin
 	if (t3 < 0.0F) t3 = 0.0F;
 	t3 = t3 * t3 * t3 * t3 * d_dot_with_hashed_vec(1.0F + i0, 1.0F + j0, 1.0F + k0, x3, y3, z3, seed);
 
-	reinterpret_cast<uint8_t*>(dst.ptr)[idx_x + idx_y * dst.pitch + idx_z * dst.pitch * dst.ysize] = (76.0F * (t0 + t1 + t2 + t3)) * 128 + 128;
+	return (76.0F * (t0 + t1 + t2 + t3)) * 128 + 128;
+}
 
-	return;
+
+__global__ void d_simplex_3d_uint8_t(cudaPitchedPtr dst, uint3 dim, float3 begin, float3 step, uint32_t seed)
+{
+	const uint32_t idx_x = blockIdx.x * blockDim.x + threadIdx.x;
+	const uint32_t idx_y = blockIdx.y * blockDim.y + threadIdx.y;
+	const uint32_t idx_z = blockIdx.z * blockDim.z + threadIdx.z;
+
+	if (idx_x >= dim.x || idx_y >= dim.y || idx_z >= dim.z)
+		return;
+
+	const float x_in = begin.x + step.x * idx_x;
+	const float y_in = begin.y + step.y * idx_y;
+	const float z_in = begin.z + step.z * idx_z;
+
+	reinterpret_cast<uint8_t*>(dst.ptr)[idx_x + idx_y * dst.pitch + idx_z * dst.pitch * dst.ysize] = d_simplex_3d_uint8_value(x_in, y_in, z_in, seed);
+}
+
+//Blocks are laid out along x as chunk-major runs of blocks_per_chunk blocks, so that any number of chunks fits the grid
+__global__ void d_simplex_3d_uint8_t_chunks(cudaPitchedPtr dst, const noise_chunk* chunks, uint32_t blocks_per_chunk)
+{
+	const noise_chunk& chunk = chunks[blockIdx.x / blocks_per_chunk];
+
+	const uint32_t idx_x = (blockIdx.x % blocks_per_chunk) * blockDim.x + threadIdx.x;
+	const uint32_t idx_y = blockIdx.y * blockDim.y + threadIdx.y;
+	const uint32_t idx_z = blockIdx.z * blockDim.z + threadIdx.z;
+
+	const float x_in = chunk.begin.x + chunk.step.x * idx_x;
+	const float y_in = chunk.begin.y + chunk.step.y * idx_y;
+	const float z_in = chunk.begin.z + chunk.step.z * idx_z;
+
+	const size_t x = chunk.origin.x + idx_x;
+	const size_t y = chunk.origin.y + idx_y;
+	const size_t z = chunk.origin.z + idx_z;
+
+	reinterpret_cast<uint8_t*>(dst.ptr)[x + y * dst.pitch + z * dst.pitch * dst.ysize] = d_simplex_3d_uint8_value(x_in, y_in, z_in, chunk.seed);
 }
 
 __global__ void d_simplex_3d_surface2d_grayscale_argb(cudaSurfaceObject_t surf, uint2 dim, float3 begin, float2 step, uint32_t seed)
@@ -278,7 +303,103 @@ __global__ void d_simplex_3d_surface2d_grayscale_argb(cudaSurfaceObject_t surf,
 
 cudaError_t launch_simplex_3d_surface2d_grayscale_argb(dim3 threads_per_block, dim3 blocks_per_grid, cudaSurfaceObject_t surf, uint2 dim, float3 begin, float2 step, uint32_t seed)
 {
-	d_simplex_3d_surface2d_grayscale_argb<<<threads_per_block, blocks_per_grid>>>(surf, dim, begin, step, seed);
+	OCH_LAUNCH(d_simplex_3d_surface2d_grayscale_argb, threads_per_block, blocks_per_grid)(surf, dim, begin, step, seed);
 
 	return cudaGetLastError();
 }
+
+cudaError_t launch_simplex_3d_uint8_t_chunks(cudaPitchedPtr dst, uint3 dim, const noise_chunk* chunks, uint32_t chunk_cnt, uint32_t chunk_dim, cudaError_t* chunk_errors)
+{
+	constexpr uint32_t block_dim = 8;
+
+	if (!chunk_dim || chunk_dim % block_dim != 0)
+	{
+		if (chunk_errors)
+			for (uint32_t i = 0; i != chunk_cnt; ++i)
+				chunk_errors[i] = cudaErrorInvalidValue;
+
+		return cudaErrorInvalidValue;
+	}
+
+	//Only chunks inside dim with finite sampling positions are passed on to the kernel
+	std::vector<noise_chunk> valid_chunks;
+
+	std::vector<uint32_t> valid_indices;
+
+	valid_chunks.reserve(chunk_cnt);
+
+	valid_indices.reserve(chunk_cnt);
+
+	cudaError_t first_err = cudaSuccess;
+
+	for (uint32_t i = 0; i != chunk_cnt; ++i)
+	{
+		const noise_chunk& c = chunks[i];
+
+		const bool is_inside = static_cast<uint64_t>(c.origin.x) + chunk_dim <= dim.x && static_cast<uint64_t>(c.origin.y) + chunk_dim <= dim.y && static_cast<uint64_t>(c.origin.z) + chunk_dim <= dim.z;
+
+		const bool is_finite = std::isfinite(c.begin.x) && std::isfinite(c.begin.y) && std::isfinite(c.begin.z) && std::isfinite(c.step.x) && std::isfinite(c.step.y) && std::isfinite(c.step.z);
+
+		const cudaError_t err = is_inside && is_finite ? cudaSuccess : cudaErrorInvalidValue;
+
+		if (chunk_errors)
+			chunk_errors[i] = err;
+
+		if (err == cudaSuccess)
+		{
+			valid_chunks.push_back(c);
+
+			valid_indices.push_back(i);
+		}
+		else if (first_err == cudaSuccess)
+		{
+			first_err = err;
+		}
+	}
+
+	if (valid_chunks.empty())
+		return first_err;
+
+	//Failures from here on affect the whole batch, and thereby every chunk passed to the kernel
+	const auto fail_batch = [&](cudaError_t err)
+	{
+		if (chunk_errors)
+			for (const uint32_t i : valid_indices)
+				chunk_errors[i] = err;
+
+		return err;
+	};
+
+	noise_chunk* d_chunks;
+
+	if (cudaError_t err = cudaMalloc(&d_chunks, valid_chunks.size() * sizeof(noise_chunk)))
+		return fail_batch(err);
+
+	if (cudaError_t err = cudaMemcpy(d_chunks, valid_chunks.data(), valid_chunks.size() * sizeof(noise_chunk), cudaMemcpyHostToDevice))
+	{
+		cudaFree(d_chunks);
+
+		return fail_batch(err);
+	}
+
+	const uint32_t blocks_per_chunk = chunk_dim / block_dim;
+
+	const dim3 threads_per_block(block_dim, block_dim, block_dim);
+
+	const dim3 blocks_per_grid(blocks_per_chunk * static_cast<uint32_t>(valid_chunks.size()), blocks_per_chunk, blocks_per_chunk);
+
+	OCH_LAUNCH(d_simplex_3d_uint8_t_chunks, blocks_per_grid, threads_per_block)(dst, d_chunks, blocks_per_chunk);
+
+	cudaError_t err = cudaGetLastError();
+
+	//The single completion wait for the whole batch
+	if (err == cudaSuccess)
+		err = cudaDeviceSynchronize();
+
+	cudaFree(d_chunks);
+
+	if (err != cudaSuccess)
+		return fail_batch(err);
+
+	return first_err;
+}
@@ -1,12 +1,35 @@
+#pragma once
 
 #include <cstdint>
 
-#include "device_launch_parameters.h"
+#include "och_cuda_compat.cuh"
 
 __global__ void d_simplex_3d_float(cudaPitchedPtr dst, uint3 dim, float3 begin, float3 step, uint32_t seed);
 
 __global__ void d_simplex_3d_uint8_t(cudaPitchedPtr dst, uint3 dim, float3 begin, float3 step, uint32_t seed);
 
+//One chunk of a batched noise fill. The chunk_dim^3 voxels starting at origin in the destination are sampled at
+//begin + step * (x, y, z) for their position (x, y, z) relative to origin
+struct noise_chunk
+{
+	uint3 origin;
+
+	float3 begin;
+
+	float3 step;
+
+	uint32_t seed;
+};
+
+__global__ void d_simplex_3d_uint8_t_chunks(cudaPitchedPtr dst, const noise_chunk* chunks, uint32_t blocks_per_chunk);
+
 __global__ void d_simplex_3d_surface2d_grayscale_argb(cudaSurfaceObject_t surf, uint2 dim, float3 begin, float2 step, uint32_t seed);
 
 cudaError_t launch_simplex_3d_surface2d_grayscale_argb(dim3 threads_per_block, dim3 blocks_per_grid, cudaSurfaceObject_t surf, uint2 dim, float3 begin, float2 step, uint32_t seed);
+
+//Fills the chunk_cnt chunks described by the host array chunks into dst, a volume of dim voxels, as a single launch
+//followed by a single cudaDeviceSynchronize. chunk_dim must be a positive multiple of 8.
+//If chunk_errors is not null, chunk_errors[i] receives the outcome for chunks[i]: cudaErrorInvalidValue if the chunk is not
+//inside dim or has non-finite begin or step, in which case it is skipped, and otherwise the outcome of the batch.
+//Returns the first error among the chunks, or cudaSuccess
+cudaError_t launch_simplex_3d_uint8_t_chunks(cudaPitchedPtr dst, uint3 dim, const noise_chunk* chunks, uint32_t chunk_cnt, uint32_t chunk_dim, cudaError_t* chunk_errors = nullptr);
@@ -0,0 +1,414 @@
+#pragma once
+
+//Instruction set independent implementation of the vectorized simplex kernels.
+//Only included by the per-tier translation units, which define an ops-struct V wrapping their intrinsics:
+//
+//	vf, vi, vm                     float-vector, int-vector and comparison mask
+//	width                          number of lanes
+//	set1, set1_i, iota(base)       broadcasts; iota returns (float) (base + lane)
+//	add, sub, mul, min, max, floor float arithmetic
+//	cmp_ge, cmp_gt, movemask       comparisons; movemask returns one bit per lane
+//	m_and, m_andnot, m_or          mask logic; m_andnot(a, b) is ~a & b
+//	one_if, one_if_not             1.0F in lanes where the mask is set / not set, else 0.0F
+//	bits, mullo, xor_i, srli       integer hashing on the bit-patterns of floats
+//	cvtt                           float to int32 conversion with truncation
+//	lookup16                       in-register table lookup with indices in [0, 15]
+//	loadu, load_partial            full and partial (first cnt lanes, others zeroed) unaligned loads
+//	storeu, store_partial          full and partial (first cnt lanes) unaligned stores
+//	store_u8                       stores the low byte of each int32 lane
+//
+//Expressions are evaluated in the same order as in the scalar simplex_3d, so all tiers agree with it.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "och_simplex_noise_backends.h"
+
+//Gradient table of simplex_3d split into components and padded to 16 entries
+alignas(64) constexpr float simplex_grad_x[16] = {  1, -1,  1, -1,  1, -1,  1, -1,  0,  0,  0,  0,  0,  0,  0,  0 };
+alignas(64) constexpr float simplex_grad_y[16] = {  1,  1, -1, -1,  0,  0,  0,  0,  1, -1,  1, -1,  0,  0,  0,  0 };
+alignas(64) constexpr float simplex_grad_z[16] = {  0,  0,  0,  0,  1,  1, -1, -1,  1,  1, -1, -1,  0,  0,  0,  0 };
+
+template<typename V>
+OCH_SIMD_INLINE void simplex_hashed_gradient(typename V::vf _i, typename V::vf _j, typename V::vf _k, typename V::vi _seed, typename V::vf& _gx, typename V::vf& _gy, typename V::vf& _gz)
+{
+	using vi = typename V::vi;
+
+	const vi _hi = V::mullo(V::bits(_i), 73856093);
+	const vi _hj = V::mullo(V::bits(_j), 19349663);
+	const vi _hk = V::mullo(V::bits(_k), 83492791);
+
+	const vi _h_raw = V::xor_i(V::xor_i(V::xor_i(_hi, _hj), _hk), _seed);
+
+	const vi _h = V::srli(V::mullo(V::srli(_h_raw, 4), 3), 26);	//Normalize hash-value to [0, 11]
+
+	_gx = V::lookup16(simplex_grad_x, _h);
+	_gy = V::lookup16(simplex_grad_y, _h);
+	_gz = V::lookup16(simplex_grad_z, _h);
+}
+
+template<typename V>
+OCH_SIMD_INLINE typename V::vf simplex_dot_with_vec(typename V::vf _i, typename V::vf _j, typename V::vf _k, typename V::vf _x, typename V::vf _y, typename V::vf _z, typename V::vi _seed)
+{
+	typename V::vf _gx, _gy, _gz;
+
+	simplex_hashed_gradient<V>(_i, _j, _k, _seed, _gx, _gy, _gz);
+
+	return V::add(V::add(V::mul(_gx, _x), V::mul(_gy, _y)), V::mul(_gz, _z));
+}
+
+//Contribution of one simplex corner, with (_x, _y, _z) relative to the corner at lattice-position (_i, _j, _k)
+template<typename V>
+OCH_SIMD_INLINE typename V::vf simplex_corner(typename V::vf _i, typename V::vf _j, typename V::vf _k, typename V::vf _x, typename V::vf _y, typename V::vf _z, typename V::vi _seed)
+{
+	using vf = typename V::vf;
+
+	const vf _t_raw = V::sub(V::sub(V::sub(V::set1(0.5F), V::mul(_x, _x)), V::mul(_y, _y)), V::mul(_z, _z));
+
+	const vf _t = V::max(_t_raw, V::set1(0.0F));
+
+	const vf _t4 = V::mul(V::mul(V::mul(_t, _t), _t), _t);
+
+	return V::mul(_t4, simplex_dot_with_vec<V>(_i, _j, _k, _x, _y, _z, _seed));
+}
+
+//Like simplex_corner, additionally adding the corner's derivative 4t^3 * (-2d) * (g . d) + t^4 * g to (_dx, _dy, _dz)
+template<typename V>
+OCH_SIMD_INLINE typename V::vf simplex_corner_grad(typename V::vf _i, typename V::vf _j, typename V::vf _k, typename V::vf _x, typename V::vf _y, typename V::vf _z, typename V::vi _seed, typename V::vf& _dx, typename V::vf& _dy, typename V::vf& _dz)
+{
+	using vf = typename V::vf;
+
+	const vf _t_raw = V::sub(V::sub(V::sub(V::set1(0.5F), V::mul(_x, _x)), V::mul(_y, _y)), V::mul(_z, _z));
+
+	const vf _t = V::max(_t_raw, V::set1(0.0F));
+
+	vf _gx, _gy, _gz;
+
+	simplex_hashed_gradient<V>(_i, _j, _k, _seed, _gx, _gy, _gz);
+
+	const vf _dot = V::add(V::add(V::mul(_gx, _x), V::mul(_gy, _y)), V::mul(_gz, _z));
+
+	const vf _t3 = V::mul(V::mul(_t, _t), _t);
+	const vf _t4 = V::mul(_t3, _t);
+
+	const vf _falloff_deriv = V::mul(V::set1(-8.0F), V::mul(_t3, _dot));
+
+	_dx = V::add(_dx, V::add(V::mul(_t4, _gx), V::mul(_falloff_deriv, _x)));
+	_dy = V::add(_dy, V::add(V::mul(_t4, _gy), V::mul(_falloff_deriv, _y)));
+	_dz = V::add(_dz, V::add(V::mul(_t4, _gz), V::mul(_falloff_deriv, _z)));
+
+	return V::mul(_t4, _dot);
+}
+
+//Shared body of simplex_eval and simplex_eval_grad. The gradient is only computed (and _dx, _dy, _dz only written) if with_grad is set
+template<typename V, bool with_grad>
+OCH_SIMD_INLINE typename V::vf simplex_eval_impl(typename V::vf _x_in, typename V::vf _y_in, typename V::vf _z_in, typename V::vi _seed, typename V::vf& _dx, typename V::vf& _dy, typename V::vf& _dz)
+{
+	using vf = typename V::vf;
+	using vm = typename V::vm;
+
+	constexpr float skew_factor = 1.0F / 3.0F;
+	constexpr float unskew_factor = 1.0F / 6.0F;
+
+	const vf _unskew_factor = V::set1(unskew_factor);
+
+	const vf _skew = V::mul(V::add(V::add(_x_in, _y_in), _z_in), V::set1(skew_factor));
+
+	const vf _i0 = V::floor(V::add(_x_in, _skew));
+	const vf _j0 = V::floor(V::add(_y_in, _skew));
+	const vf _k0 = V::floor(V::add(_z_in, _skew));
+
+	const vf _unskew = V::mul(V::add(V::add(_i0, _j0), _k0), _unskew_factor);
+
+	const vf _x0 = V::sub(_x_in, V::sub(_i0, _unskew));
+	const vf _y0 = V::sub(_y_in, V::sub(_j0, _unskew));
+	const vf _z0 = V::sub(_z_in, V::sub(_k0, _unskew));
+
+	const vm _x_ge_y = V::cmp_ge(_x0, _y0);
+	const vm _x_ge_z = V::cmp_ge(_x0, _z0);
+	const vm _y_ge_z = V::cmp_ge(_y0, _z0);
+
+	const vf _i1 = V::one_if(    V::m_and(   _x_ge_y, _x_ge_z));	//max == x
+	const vf _j1 = V::one_if(    V::m_andnot(_x_ge_y, _y_ge_z));	//max == y
+	const vf _k1 = V::one_if_not(V::m_or(    _x_ge_z, _y_ge_z));	//max == z
+
+	const vf _i2 = V::one_if(    V::m_or(    _x_ge_y, _x_ge_z));	//min != x
+	const vf _j2 = V::one_if_not(V::m_andnot(_y_ge_z, _x_ge_y));	//min != y
+	const vf _k2 = V::one_if_not(V::m_and(   _x_ge_z, _y_ge_z));	//min != z
+
+	const vf _two_unskew_factor = V::set1(unskew_factor * 2.0F);
+	const vf _three_unskew_factor = V::set1(unskew_factor * 3.0F);
+	const vf _one = V::set1(1.0F);
+
+	const vf _x1 = V::add(V::sub(_x0, _i1), _unskew_factor);
+	const vf _y1 = V::add(V::sub(_y0, _j1), _unskew_factor);
+	const vf _z1 = V::add(V::sub(_z0, _k1), _unskew_factor);
+
+	const vf _x2 = V::add(V::sub(_x0, _i2), _two_unskew_factor);
+	const vf _y2 = V::add(V::sub(_y0, _j2), _two_unskew_factor);
+	const vf _z2 = V::add(V::sub(_z0, _k2), _two_unskew_factor);
+
+	const vf _x3 = V::add(V::sub(_x0, _one), _three_unskew_factor);
+	const vf _y3 = V::add(V::sub(_y0, _one), _three_unskew_factor);
+	const vf _z3 = V::add(V::sub(_z0, _one), _three_unskew_factor);
+
+	const vf _i3 = V::add(_i0, _one);
+	const vf _j3 = V::add(_j0, _one);
+	const vf _k3 = V::add(_k0, _one);
+
+	//76.0F maps to just within [-1.0F, 1.0F]
+	const vf _scale = V::set1(76.0F);
+
+	if constexpr (with_grad)
+	{
+		vf _gx = V::set1(0.0F), _gy = V::set1(0.0F), _gz = V::set1(0.0F);
+
+		const vf _r0 = simplex_corner_grad<V>(                _i0,                 _j0,                 _k0, _x0, _y0, _z0, _seed, _gx, _gy, _gz);
+		const vf _r1 = simplex_corner_grad<V>(V::add(_i0, _i1), V::add(_j0, _j1), V::add(_k0, _k1), _x1, _y1, _z1, _seed, _gx, _gy, _gz);
+		const vf _r2 = simplex_corner_grad<V>(V::add(_i0, _i2), V::add(_j0, _j2), V::add(_k0, _k2), _x2, _y2, _z2, _seed, _gx, _gy, _gz);
+		const vf _r3 = simplex_corner_grad<V>(              _i3,               _j3,               _k3, _x3, _y3, _z3, _seed, _gx, _gy, _gz);
+
+		_dx = V::mul(_scale, _gx);
+		_dy = V::mul(_scale, _gy);
+		_dz = V::mul(_scale, _gz);
+
+		return V::mul(_scale, V::add(V::add(V::add(_r0, _r1), _r2), _r3));
+	}
+	else
+	{
+		const vf _r0 = simplex_corner<V>(                _i0,                 _j0,                 _k0, _x0, _y0, _z0, _seed);
+		const vf _r1 = simplex_corner<V>(V::add(_i0, _i1), V::add(_j0, _j1), V::add(_k0, _k1), _x1, _y1, _z1, _seed);
+		const vf _r2 = simplex_corner<V>(V::add(_i0, _i2), V::add(_j0, _j2), V::add(_k0, _k2), _x2, _y2, _z2, _seed);
+		const vf _r3 = simplex_corner<V>(              _i3,               _j3,               _k3, _x3, _y3, _z3, _seed);
+
+		return V::mul(_scale, V::add(V::add(V::add(_r0, _r1), _r2), _r3));
+	}
+}
+
+template<typename V>
+OCH_SIMD_INLINE typename V::vf simplex_eval(typename V::vf _x_in, typename V::vf _y_in, typename V::vf _z_in, typename V::vi _seed)
+{
+	typename V::vf _unused;
+
+	return simplex_eval_impl<V, false>(_x_in, _y_in, _z_in, _seed, _unused, _unused, _unused);
+}
+
+template<typename V>
+OCH_SIMD_INLINE typename V::vf simplex_eval_grad(typename V::vf _x_in, typename V::vf _y_in, typename V::vf _z_in, typename V::vi _seed, typename V::vf& _dx, typename V::vf& _dy, typename V::vf& _dz)
+{
+	return simplex_eval_impl<V, true>(_x_in, _y_in, _z_in, _seed, _dx, _dy, _dz);
+}
+
+//Fractal sum of simplex_eval over the octaves, accumulated in registers
+template<typename V>
+OCH_SIMD_INLINE typename V::vf simplex_fbm_eval(typename V::vf _x_in, typename V::vf _y_in, typename V::vf _z_in, const simplex_octaves& octaves)
+{
+	using vf = typename V::vf;
+
+	vf _sum = V::set1(0.0F);
+
+	for (uint32_t o = 0; o != octaves.cnt; ++o)
+	{
+		const vf _freq = V::set1(octaves.freq[o]);
+
+		const vf _n = simplex_eval<V>(V::mul(_x_in, _freq), V::mul(_y_in, _freq), V::mul(_z_in, _freq), V::set1_i(static_cast<int32_t>(octaves.seed[o])));
+
+		_sum = V::add(_sum, V::mul(V::set1(octaves.amp[o]), _n));
+	}
+
+	return _sum;
+}
+
+//Calls fn(_x_in, _y_in, _z_in, voxel_idx, cnt) for each batch of up to V::width voxels in a row of block.
+//voxel_idx is the linear index of the first lane in the x_cnt * y_cnt * z_cnt grid and cnt the number of valid lanes.
+template<typename V, typename Fn>
+OCH_SIMD_INLINE void simplex_for_each_batch(const simplex_grid& grid, const simplex_block& block, Fn&& fn)
+{
+	using vf = typename V::vf;
+
+	const vf _x_beg = V::set1(grid.x_beg);
+	const vf _x_step = V::set1(grid.x_step);
+
+	for (uint32_t iz = block.z_lo; iz != block.z_hi; ++iz)
+	{
+		const vf _z_in = V::set1(grid.z_beg + iz * grid.z_step);
+
+		for (uint32_t iy = block.y_lo; iy != block.y_hi; ++iy)
+		{
+			const vf _y_in = V::set1(grid.y_beg + iy * grid.y_step);
+
+			const size_t row_idx = static_cast<size_t>(iy) * grid.x_cnt + static_cast<size_t>(iz) * grid.x_cnt * grid.y_cnt;
+
+			for (uint32_t ix = block.x_lo; ix < block.x_hi; ix += V::width)
+			{
+				const vf _x_in = V::add(_x_beg, V::mul(V::iota(ix), _x_step));
+
+				const uint32_t cnt = block.x_hi - ix < V::width ? block.x_hi - ix : V::width;
+
+				fn(_x_in, _y_in, _z_in, row_idx + ix, cnt);
+			}
+		}
+	}
+}
+
+template<typename V>
+OCH_SIMD_INLINE void simplex_store(float* dst, typename V::vf _v, uint32_t cnt)
+{
+	if (cnt == V::width)
+		V::storeu(dst, _v);
+	else
+		V::store_partial(dst, _v, cnt);
+}
+
+template<typename V>
+void simplex_fill_block(float* dst, const simplex_grid& grid, const simplex_block& block)
+{
+	using vf = typename V::vf;
+
+	const typename V::vi _seed = V::set1_i(static_cast<int32_t>(grid.seed));
+
+	simplex_for_each_batch<V>(grid, block, [&](vf _x_in, vf _y_in, vf _z_in, size_t voxel_idx, uint32_t cnt)
+		{
+			simplex_store<V>(dst + voxel_idx, simplex_eval<V>(_x_in, _y_in, _z_in, _seed), cnt);
+		});
+}
+
+//Every voxel is written exactly once, after all octaves have been summed
+template<typename V>
+void simplex_fbm_fill_block(float* dst, const simplex_grid& grid, const simplex_octaves& octaves, const simplex_block& block)
+{
+	using vf = typename V::vf;
+
+	simplex_for_each_batch<V>(grid, block, [&](vf _x_in, vf _y_in, vf _z_in, size_t voxel_idx, uint32_t cnt)
+		{
+			simplex_store<V>(dst + voxel_idx, simplex_fbm_eval<V>(_x_in, _y_in, _z_in, octaves), cnt);
+		});
+}
+
+template<typename V>
+void simplex_fill_grad_block(float* dst, float* dst_dx, float* dst_dy, float* dst_dz, const simplex_grid& grid, const simplex_block& block)
+{
+	using vf = typename V::vf;
+
+	const typename V::vi _seed = V::set1_i(static_cast<int32_t>(grid.seed));
+
+	simplex_for_each_batch<V>(grid, block, [&](vf _x_in, vf _y_in, vf _z_in, size_t voxel_idx, uint32_t cnt)
+		{
+			vf _dx, _dy, _dz;
+
+			const vf _r = simplex_eval_grad<V>(_x_in, _y_in, _z_in, _seed, _dx, _dy, _dz);
+
+			simplex_store<V>(dst    + voxel_idx, _r,  cnt);
+			simplex_store<V>(dst_dx + voxel_idx, _dx, cnt);
+			simplex_store<V>(dst_dy + voxel_idx, _dy, cnt);
+			simplex_store<V>(dst_dz + voxel_idx, _dz, cnt);
+		});
+}
+
+//Evaluates V::width scattered points at a time. The tail is loaded and stored with lane masks, so no padding is needed
+template<typename V>
+void simplex_query_points(float* dst, const float* xs, const float* ys, const float* zs, uint32_t cnt, uint32_t seed)
+{
+	using vf = typename V::vf;
+
+	const typename V::vi _seed = V::set1_i(static_cast<int32_t>(seed));
+
+	uint32_t i = 0;
+
+	for (; i + V::width <= cnt; i += V::width)
+		V::storeu(dst + i, simplex_eval<V>(V::loadu(xs + i), V::loadu(ys + i), V::loadu(zs + i), _seed));
+
+	if (i != cnt)
+	{
+		const uint32_t rem = cnt - i;
+
+		const vf _r = simplex_eval<V>(V::load_partial(xs + i, rem), V::load_partial(ys + i, rem), V::load_partial(zs + i, rem), _seed);
+
+		V::store_partial(dst + i, _r, rem);
+	}
+}
+
+//Quantizes with the same v * 128 + 128 mapping as d_simplex_3d_uint8_t, clamped to [0, 255] and truncated
+template<typename V>
+OCH_SIMD_INLINE void simplex_store_uint8(uint8_t* dst, typename V::vf _v, uint32_t cnt)
+{
+	const typename V::vf _scaled = V::add(V::mul(_v, V::set1(128.0F)), V::set1(128.0F));
+
+	const typename V::vi _q = V::cvtt(V::min(V::max(_scaled, V::set1(0.0F)), V::set1(255.0F)));
+
+	if (cnt == V::width)
+	{
+		V::store_u8(dst, _q);
+	}
+	else
+	{
+		alignas(64) uint8_t tmp[64];
+
+		V::store_u8(tmp, _q);
+
+		memcpy(dst, tmp, cnt);
+	}
+}
+
+template<typename V>
+void simplex_fill_uint8_block(uint8_t* dst, const simplex_grid& grid, const simplex_block& block)
+{
+	using vf = typename V::vf;
+
+	const typename V::vi _seed = V::set1_i(static_cast<int32_t>(grid.seed));
+
+	simplex_for_each_batch<V>(grid, block, [&](vf _x_in, vf _y_in, vf _z_in, size_t voxel_idx, uint32_t cnt)
+		{
+			simplex_store_uint8<V>(dst + voxel_idx, simplex_eval<V>(_x_in, _y_in, _z_in, _seed), cnt);
+		});
+}
+
+//Writes one bit per voxel (set if the sample is greater than threshold) in the row-linear layout described at simplex_3d_fill_bits.
+//block.x_lo must be a multiple of 64, so that every 64-bit word is produced by exactly one call.
+template<typename V>
+void simplex_fill_bits_block(uint64_t* dst, const simplex_grid& grid, float threshold, const simplex_block& block)
+{
+	using vf = typename V::vf;
+
+	const vf _x_beg = V::set1(grid.x_beg);
+	const vf _x_step = V::set1(grid.x_step);
+	const vf _threshold = V::set1(threshold);
+
+	const typename V::vi _seed = V::set1_i(static_cast<int32_t>(grid.seed));
+
+	const uint32_t row_words = (grid.x_cnt + 63) / 64;
+
+	for (uint32_t iz = block.z_lo; iz != block.z_hi; ++iz)
+	{
+		const vf _z_in = V::set1(grid.z_beg + iz * grid.z_step);
+
+		for (uint32_t iy = block.y_lo; iy != block.y_hi; ++iy)
+		{
+			const vf _y_in = V::set1(grid.y_beg + iy * grid.y_step);
+
+			uint64_t* const row_dst = dst + (static_cast<size_t>(iy) + static_cast<size_t>(iz) * grid.y_cnt) * row_words;
+
+			for (uint32_t word_beg = block.x_lo; word_beg < block.x_hi; word_beg += 64)
+			{
+				uint64_t word = 0;
+
+				for (uint32_t b = 0; b != 64 && word_beg + b < block.x_hi; b += V::width)
+				{
+					const uint32_t ix = word_beg + b;
+
+					const vf _x_in = V::add(_x_beg, V::mul(V::iota(ix), _x_step));
+
+					uint32_t lane_bits = V::movemask(V::cmp_gt(simplex_eval<V>(_x_in, _y_in, _z_in, _seed), _threshold));
+
+					if (block.x_hi - ix < V::width)
+						lane_bits &= (1u << (block.x_hi - ix)) - 1;
+
+					word |= static_cast<uint64_t>(lane_bits) << b;
+				}
+
+				row_dst[word_beg / 64] = word;
+			}
+		}
+	}
+}
@@ -0,0 +1,137 @@
+#include "och_simplex_noise_backends.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <immintrin.h>
+
+//SSE4.1 has no /arch switch in MSVC, where its intrinsics are always available; GCC and Clang get the target here
+#if defined(__GNUC__) && !defined(__SSE4_1__)
+#pragma GCC target("sse4.1")
+#endif
+
+#include "och_simplex_noise_simd.h"
+
+struct sse4_ops
+{
+	using vf = __m128;
+	using vi = __m128i;
+	using vm = __m128;
+
+	static constexpr uint32_t width = 4;
+
+	static OCH_SIMD_INLINE vf set1(float v) { return _mm_set1_ps(v); }
+
+	static OCH_SIMD_INLINE vi set1_i(int32_t v) { return _mm_set1_epi32(v); }
+
+	static OCH_SIMD_INLINE vf iota(uint32_t base) { return _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(base)), _mm_set_epi32(3, 2, 1, 0))); }
+
+	static OCH_SIMD_INLINE vf add(vf a, vf b) { return _mm_add_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf sub(vf a, vf b) { return _mm_sub_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf mul(vf a, vf b) { return _mm_mul_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf max(vf a, vf b) { return _mm_max_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf min(vf a, vf b) { return _mm_min_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf floor(vf a) { return _mm_floor_ps(a); }
+
+	static OCH_SIMD_INLINE vm cmp_ge(vf a, vf b) { return _mm_cmpge_ps(a, b); }
+
+	static OCH_SIMD_INLINE vm cmp_gt(vf a, vf b) { return _mm_cmpgt_ps(a, b); }
+
+	static OCH_SIMD_INLINE uint32_t movemask(vm m) { return static_cast<uint32_t>(_mm_movemask_ps(m)); }
+
+	static OCH_SIMD_INLINE vm m_and(vm a, vm b) { return _mm_and_ps(a, b); }
+
+	static OCH_SIMD_INLINE vm m_andnot(vm a, vm b) { return _mm_andnot_ps(a, b); }
+
+	static OCH_SIMD_INLINE vm m_or(vm a, vm b) { return _mm_or_ps(a, b); }
+
+	static OCH_SIMD_INLINE vf one_if(vm m) { return _mm_and_ps(m, _mm_set1_ps(1.0F)); }
+
+	static OCH_SIMD_INLINE vf one_if_not(vm m) { return _mm_andnot_ps(m, _mm_set1_ps(1.0F)); }
+
+	static OCH_SIMD_INLINE vi cvtt(vf a) { return _mm_cvttps_epi32(a); }
+
+	static OCH_SIMD_INLINE vi bits(vf a) { return _mm_castps_si128(a); }
+
+	static OCH_SIMD_INLINE vi mullo(vi a, int32_t b) { return _mm_mullo_epi32(a, _mm_set1_epi32(b)); }
+
+	static OCH_SIMD_INLINE vi xor_i(vi a, vi b) { return _mm_xor_si128(a, b); }
+
+	static OCH_SIMD_INLINE vi srli(vi a, int n) { return _mm_srli_epi32(a, n); }
+
+	//No gather before AVX2; four scalar loads are cheaper than emulating it
+	static OCH_SIMD_INLINE vf lookup16(const float* tbl, vi idx)
+	{
+		return _mm_set_ps(tbl[_mm_extract_epi32(idx, 3)], tbl[_mm_extract_epi32(idx, 2)], tbl[_mm_extract_epi32(idx, 1)], tbl[_mm_cvtsi128_si32(idx)]);
+	}
+
+	static OCH_SIMD_INLINE vf loadu(const float* src) { return _mm_loadu_ps(src); }
+
+	static OCH_SIMD_INLINE vf load_partial(const float* src, uint32_t cnt)
+	{
+		alignas(16) float tmp[4]{};
+
+		for (uint32_t i = 0; i != cnt; ++i)
+			tmp[i] = src[i];
+
+		return _mm_load_ps(tmp);
+	}
+
+	static OCH_SIMD_INLINE void storeu(float* dst, vf v) { _mm_storeu_ps(dst, v); }
+
+	static OCH_SIMD_INLINE void store_partial(float* dst, vf v, uint32_t cnt)
+	{
+		alignas(16) float tmp[4];
+
+		_mm_store_ps(tmp, v);
+
+		for (uint32_t i = 0; i != cnt; ++i)
+			dst[i] = tmp[i];
+	}
+
+	static OCH_SIMD_INLINE void store_u8(uint8_t* dst, vi v)
+	{
+		const __m128i bytes = _mm_shuffle_epi8(v, _mm_set_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 12, 8, 4, 0));
+
+		const int32_t packed = _mm_cvtsi128_si32(bytes);
+
+		memcpy(dst, &packed, 4);
+	}
+};
+
+static void fill_sse4(float* dst, const simplex_grid& grid, const simplex_block& block)
+{
+	simplex_fill_block<sse4_ops>(dst, grid, block);
+}
+
+static void fill_fbm_sse4(float* dst, const simplex_grid& grid, const simplex_octaves& octaves, const simplex_block& block)
+{
+	simplex_fbm_fill_block<sse4_ops>(dst, grid, octaves, block);
+}
+
+static void fill_grad_sse4(float* dst, float* dst_dx, float* dst_dy, float* dst_dz, const simplex_grid& grid, const simplex_block& block)
+{
+	simplex_fill_grad_block<sse4_ops>(dst, dst_dx, dst_dy, dst_dz, grid, block);
+}
+
+static void query_sse4(float* dst, const float* xs, const float* ys, const float* zs, uint32_t cnt, uint32_t seed)
+{
+	simplex_query_points<sse4_ops>(dst, xs, ys, zs, cnt, seed);
+}
+
+static void fill_uint8_sse4(uint8_t* dst, const simplex_grid& grid, const simplex_block& block)
+{
+	simplex_fill_uint8_block<sse4_ops>(dst, grid, block);
+}
+
+static void fill_bits_sse4(uint64_t* dst, const simplex_grid& grid, float threshold, const simplex_block& block)
+{
+	simplex_fill_bits_block<sse4_ops>(dst, grid, threshold, block);
+}
+
+const simplex_backend simplex_backend_sse4{ simd_tier::sse4, sse4_ops::width, fill_sse4, fill_fbm_sse4, fill_grad_sse4, query_sse4, fill_uint8_sse4, fill_bits_sse4 };
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+enum class slice_axis : uint8_t
+{
+	x,
+	y,
+	z,
+};
+
+//Plane sampled by oblique slice extraction. Pixel (u, v) lies at origin + u * u_step + v * v_step, in voxels.
+//Voxel (x, y, z) sits exactly at (x, y, z), so planes through integer positions reproduce axis-aligned slices.
+//Positions between voxels are interpolated trilinearly, with voxels outside the volume counting as 0
+struct slice_plane
+{
+	float origin[3];
+
+	float u_step[3];
+
+	float v_step[3];
+};
@@ -0,0 +1,344 @@
+#include "och_svo.h"
+
+#include "och_bit_ops.h"
+#include "och_thread_pool.h"
+
+//Masks of a level-1+ cell, packed as child_mask | full_mask << 8. Empty cells are 0, full cells have full_mask 0xFF
+using cell_masks = uint16_t;
+
+static constexpr float no_hit_inv = 1e30F;
+
+void sparse_voxel_octree::build(const uint8_t* leaf_bytes, size_t pitch, size_t slice_pitch, uint32_t leaf_dim, uint32_t max_threads)
+{
+	m_nodes.clear();
+	m_leaves.clear();
+
+	m_dim = leaf_dim * 2;
+
+	const uint32_t top_level = log2_of_pow2(leaf_dim);
+
+	//levels[k] holds the masks of the (leaf_dim >> k)^3 cells of level k. Level 0 are the leaf bytes themselves and stays empty
+	std::vector<std::vector<cell_masks>> levels(top_level + 1);
+
+	for (uint32_t k = 1; k <= top_level; ++k)
+	{
+		const uint32_t n = leaf_dim >> k;
+
+		const uint32_t child_n = n * 2;
+
+		levels[k].resize(static_cast<size_t>(n) * n * n);
+
+		const std::vector<cell_masks>& children = levels[k - 1];
+
+		cell_masks* dst = levels[k].data();
+
+		thread_pool::global().parallel_for(n, [&, k, n, child_n, dst](uint32_t z, uint32_t)
+			{
+				for (uint32_t y = 0; y != n; ++y)
+					for (uint32_t x = 0; x != n; ++x)
+					{
+						uint32_t child_mask = 0;
+						uint32_t full_mask = 0;
+
+						for (uint32_t i = 0; i != 8; ++i)
+						{
+							const uint32_t cx = x * 2 + (i & 1);
+							const uint32_t cy = y * 2 + ((i >> 1) & 1);
+							const uint32_t cz = z * 2 + (i >> 2);
+
+							bool is_empty, is_full;
+
+							if (k == 1)
+							{
+								const uint8_t b = leaf_bytes[cx + cy * pitch + cz * slice_pitch];
+
+								is_empty = b == 0;
+								is_full = b == 0xFF;
+							}
+							else
+							{
+								const cell_masks m = children[cx + (cy + static_cast<size_t>(cz) * child_n) * child_n];
+
+								is_empty = m == 0;
+								is_full = (m >> 8) == 0xFF;
+							}
+
+							if (is_full)
+								full_mask |= 1 << i;
+							else if (!is_empty)
+								child_mask |= 1 << i;
+						}
+
+						dst[x + (y + static_cast<size_t>(z) * n) * n] = static_cast<cell_masks>(child_mask | (full_mask << 8));
+					}
+			}, max_threads);
+	}
+
+	//Emit breadth-first, one level at a time. Cells are identified by their linear index within their level
+	std::vector<uint32_t> curr{ 0 };
+	std::vector<uint32_t> next;
+
+	for (uint32_t k = top_level; k != 0; --k)
+	{
+		const uint32_t n = leaf_dim >> k;
+
+		const uint32_t child_n = n * 2;
+
+		//Nodes of the next level start right after the ones of this level
+		const uint32_t next_base = static_cast<uint32_t>(m_nodes.size() + curr.size());
+
+		next.clear();
+
+		for (const uint32_t cell : curr)
+		{
+			const cell_masks m = levels[k][cell];
+
+			const uint32_t x = cell % n;
+			const uint32_t y = cell / n % n;
+			const uint32_t z = cell / n / n;
+
+			svo_node node;
+			node.child_mask = static_cast<uint8_t>(m & 0xFF);
+			node.full_mask = static_cast<uint8_t>(m >> 8);
+			node.reserved = 0;
+			node.first_child = k == 1 ? static_cast<uint32_t>(m_leaves.size()) : next_base + static_cast<uint32_t>(next.size());
+
+			for (uint32_t i = 0; i != 8; ++i)
+			{
+				if (!(node.child_mask & (1 << i)))
+					continue;
+
+				const uint32_t cx = x * 2 + (i & 1);
+				const uint32_t cy = y * 2 + ((i >> 1) & 1);
+				const uint32_t cz = z * 2 + (i >> 2);
+
+				if (k == 1)
+					m_leaves.push_back(leaf_bytes[cx + cy * pitch + cz * slice_pitch]);
+				else
+					next.push_back(cx + (cy + cz * child_n) * child_n);
+			}
+
+			m_nodes.push_back(node);
+		}
+
+		curr.swap(next);
+	}
+}
+
+bool sparse_voxel_octree::is_solid(uint32_t x, uint32_t y, uint32_t z) const noexcept
+{
+	if (x >= m_dim || y >= m_dim || z >= m_dim || m_nodes.empty())
+		return false;
+
+	uint32_t node_idx = 0;
+
+	for (uint32_t half = m_dim >> 1; ; half >>= 1)
+	{
+		const svo_node& node = m_nodes[node_idx];
+
+		const uint32_t i = ((x & half) ? 1 : 0) | ((y & half) ? 2 : 0) | ((z & half) ? 4 : 0);
+
+		if (node.full_mask & (1 << i))
+			return true;
+
+		if (!(node.child_mask & (1 << i)))
+			return false;
+
+		const uint32_t child_idx = node.first_child + popcount8(node.child_mask & ((1 << i) - 1));
+
+		//Children of this node are leaf bytes covering 2^3 voxels
+		if (half == 2)
+		{
+			const uint32_t bit = (x & 1) | ((y & 1) << 1) | ((z & 1) << 2);
+
+			return (m_leaves[child_idx] >> bit) & 1;
+		}
+
+		node_idx = child_idx;
+	}
+}
+
+struct svo_ray
+{
+	float o[3];
+	float d[3];
+	float inv[3];
+};
+
+//Parametric interval of the ray inside the cube [lo, lo + size), and the axis of the face it enters through
+static bool ray_box(const svo_ray& r, const uint32_t lo[3], uint32_t size, float& t0, float& t1, uint8_t& axis) noexcept
+{
+	t0 = -no_hit_inv;
+	t1 = no_hit_inv;
+	axis = 0;
+
+	for (uint8_t a = 0; a != 3; ++a)
+	{
+		float ta = (static_cast<float>(lo[a]) - r.o[a]) * r.inv[a];
+		float tb = (static_cast<float>(lo[a] + size) - r.o[a]) * r.inv[a];
+
+		if (ta > tb)
+		{
+			const float tmp = ta;
+			ta = tb;
+			tb = tmp;
+		}
+
+		if (ta > t0)
+		{
+			t0 = ta;
+			axis = a;
+		}
+
+		if (tb < t1)
+			t1 = tb;
+	}
+
+	return t0 <= t1;
+}
+
+bool sparse_voxel_octree::raycast(float ox, float oy, float oz, float dx, float dy, float dz, float max_t, svo_hit& hit) const noexcept
+{
+	if (m_nodes.empty())
+		return false;
+
+	enum class entry_kind : uint8_t { node, leaf, full };
+
+	struct stack_entry
+	{
+		uint32_t lo[3];
+		uint32_t size;
+		uint32_t idx;
+		float t0;
+		uint8_t axis;
+		entry_kind kind;
+	};
+
+	svo_ray r{ { ox, oy, oz }, { dx, dy, dz }, {} };
+
+	for (uint32_t a = 0; a != 3; ++a)
+		r.inv[a] = r.d[a] != 0.0F ? 1.0F / r.d[a] : no_hit_inv;
+
+	//Depth times seven siblings waiting, plus the entry being expanded
+	stack_entry stack[32 * 7 + 1];
+
+	uint32_t stack_size = 0;
+
+	{
+		const uint32_t lo[3]{ 0, 0, 0 };
+
+		float t0, t1;
+
+		uint8_t axis;
+
+		if (!ray_box(r, lo, m_dim, t0, t1, axis) || t1 < 0.0F || t0 > max_t)
+			return false;
+
+		stack[stack_size++] = { { 0, 0, 0 }, m_dim, 0, t0, axis, entry_kind::node };
+	}
+
+	while (stack_size)
+	{
+		const stack_entry e = stack[--stack_size];
+
+		if (e.kind == entry_kind::full)
+		{
+			const float t = e.t0 > 0.0F ? e.t0 : 0.0F;
+
+			uint32_t v[3];
+
+			for (uint32_t a = 0; a != 3; ++a)
+			{
+				const float p = r.o[a] + r.d[a] * t;
+
+				const float lo = static_cast<float>(e.lo[a]);
+
+				const float hi = static_cast<float>(e.lo[a] + e.size - 1);
+
+				v[a] = static_cast<uint32_t>(p < lo ? lo : p > hi ? hi : p);
+			}
+
+			hit = { t, v[0], v[1], v[2], e.axis };
+
+			return true;
+		}
+
+		uint32_t child_mask, full_mask, first_child = 0;
+
+		if (e.kind == entry_kind::node)
+		{
+			const svo_node& node = m_nodes[e.idx];
+
+			child_mask = node.child_mask;
+			full_mask = node.full_mask;
+			first_child = node.first_child;
+		}
+		else
+		{
+			child_mask = 0;
+			full_mask = e.idx;
+		}
+
+		const uint32_t half = e.size >> 1;
+
+		stack_entry children[8];
+
+		uint32_t child_cnt = 0;
+
+		for (uint32_t i = 0; i != 8; ++i)
+		{
+			if (!((child_mask | full_mask) & (1 << i)))
+				continue;
+
+			stack_entry c;
+
+			c.lo[0] = e.lo[0] + (i & 1) * half;
+			c.lo[1] = e.lo[1] + ((i >> 1) & 1) * half;
+			c.lo[2] = e.lo[2] + (i >> 2) * half;
+			c.size = half;
+
+			float t1;
+
+			if (!ray_box(r, c.lo, half, c.t0, t1, c.axis) || t1 < 0.0F || c.t0 > max_t)
+				continue;
+
+			if (full_mask & (1 << i))
+			{
+				c.kind = entry_kind::full;
+				c.idx = 0;
+			}
+			else
+			{
+				const uint32_t child_idx = first_child + popcount8(child_mask & ((1 << i) - 1));
+
+				if (half == 2)
+				{
+					c.kind = entry_kind::leaf;
+					c.idx = m_leaves[child_idx];
+				}
+				else
+				{
+					c.kind = entry_kind::node;
+					c.idx = child_idx;
+				}
+			}
+
+			//Insertion sort by descending entry distance, so the nearest child ends up on top of the stack
+			uint32_t j = child_cnt++;
+
+			while (j && children[j - 1].t0 < c.t0)
+			{
+				children[j] = children[j - 1];
+
+				--j;
+			}
+
+			children[j] = c;
+		}
+
+		for (uint32_t i = 0; i != child_cnt; ++i)
+			stack[stack_size++] = children[i];
+	}
+
+	return false;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//Child i of a node, and bit i of a leaf byte, is the octant at (i & 1, (i >> 1) & 1, i >> 2), as written by d_uint8_to_bit.
+//child_mask marks mixed children, which are stored; full_mask marks children that are entirely solid. Children in neither
+//mask are empty. Stored children are contiguous, child i being at first_child + popcount(child_mask & ((1 << i) - 1)).
+struct svo_node
+{
+	uint8_t child_mask;
+	uint8_t full_mask;
+	uint16_t reserved;
+
+	//Index into nodes, or into leaves for nodes whose children cover 2^3 voxels
+	uint32_t first_child;
+};
+
+struct svo_hit
+{
+	float t;
+
+	uint32_t x, y, z;
+
+	//Axis (0 = x, 1 = y, 2 = z) of the face the ray entered the hit voxel through
+	uint8_t axis;
+};
+
+//Sparse voxel octree over a binary volume, built from the 2x2x2 leaf bytes produced by d_uint8_to_bit.
+//Uniform subtrees are collapsed bottom-up and nodes are stored breadth-first, so the root is nodes[0] and every level
+//follows the one above it. Mixed leaf bytes are kept separately at one byte each.
+struct sparse_voxel_octree
+{
+	//leaf_bytes holds leaf_dim^3 bytes with the given row and slice pitch in bytes, e.g. from a cudaPitchedPtr.
+	//leaf_dim must be a power of two of at least 2, giving a volume of (2 * leaf_dim)^3 voxels.
+	void build(const uint8_t* leaf_bytes, size_t pitch, size_t slice_pitch, uint32_t leaf_dim, uint32_t max_threads = 0);
+
+	//Edge length of the volume in voxels
+	uint32_t dim() const noexcept { return m_dim; }
+
+	const std::vector<svo_node>& nodes() const noexcept { return m_nodes; }
+
+	const std::vector<uint8_t>& leaves() const noexcept { return m_leaves; }
+
+	size_t memory_bytes() const noexcept { return m_nodes.size() * sizeof(svo_node) + m_leaves.size(); }
+
+	//Voxels outside the volume are empty
+	bool is_solid(uint32_t x, uint32_t y, uint32_t z) const noexcept;
+
+	//First solid voxel along origin + t * dir for t in [0, max_t], visiting octants front to back
+	bool raycast(float ox, float oy, float oz, float dx, float dy, float dz, float max_t, svo_hit& hit) const noexcept;
+
+private:
+
+	uint32_t m_dim = 0;
+
+	std::vector<svo_node> m_nodes;
+
+	std::vector<uint8_t> m_leaves;
+};
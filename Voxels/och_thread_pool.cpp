@@ -0,0 +1,240 @@
+#include "och_thread_pool.h"
+
+#include <cstdint>
+#include <cstdio>
+
+#include "och_trace.h"
+
+//Set for worker-threads and for callers currently inside parallel_for, so nested jobs do not deadlock
+static thread_local bool tl_is_in_job = false;
+
+thread_pool::thread_pool(uint32_t thread_cnt)
+{
+	if (!thread_cnt)
+		thread_cnt = std::thread::hardware_concurrency();
+
+	if (!thread_cnt)
+		thread_cnt = 1;
+
+	m_queues.reset(new task_queue[thread_cnt]);
+
+	//Slot 0 is reserved for the thread calling parallel_for
+	m_workers.reserve(thread_cnt - 1);
+
+	for (uint32_t i = 1; i != thread_cnt; ++i)
+		m_workers.emplace_back(&thread_pool::worker_loop, this, i);
+}
+
+thread_pool::~thread_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_state_mtx);
+
+		m_is_stopping = true;
+	}
+
+	m_wake_cv.notify_all();
+
+	for (std::thread& t : m_workers)
+		t.join();
+}
+
+uint32_t thread_pool::thread_cnt() const noexcept
+{
+	return static_cast<uint32_t>(m_workers.size()) + 1;
+}
+
+void thread_pool::parallel_for(uint32_t task_cnt, const task_fn& fn, uint32_t max_threads)
+{
+	if (!task_cnt)
+		return;
+
+	uint32_t used_threads = thread_cnt();
+
+	if (max_threads && max_threads < used_threads)
+		used_threads = max_threads;
+
+	if (task_cnt < used_threads)
+		used_threads = task_cnt;
+
+	if (used_threads == 1 || tl_is_in_job)
+	{
+		for (uint32_t i = 0; i != task_cnt; ++i)
+			fn(i, 0);
+
+		return;
+	}
+
+	std::lock_guard<std::mutex> submit_lock(m_submit_mtx);
+
+	//Hand out contiguous runs of tasks, so neighbouring tasks tend to run on the same thread
+	try
+	{
+		for (uint32_t t = 0; t != used_threads; ++t)
+		{
+			const uint32_t beg = static_cast<uint32_t>(static_cast<uint64_t>(task_cnt) *  t      / used_threads);
+			const uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(task_cnt) * (t + 1) / used_threads);
+
+			std::lock_guard<std::mutex> queue_lock(m_queues[t].mtx);
+
+			for (uint32_t i = end; i != beg; --i)
+				m_queues[t].tasks.push_back(i - 1);
+		}
+	}
+	catch (...)
+	{
+		//No worker has seen the job yet, so the queues only need to be emptied for the next one
+		for (uint32_t t = 0; t != used_threads; ++t)
+			m_queues[t].tasks.clear();
+
+		throw;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_state_mtx);
+
+		m_job = &fn;
+		m_job_thread_cnt = used_threads;
+		m_busy_workers = used_threads - 1;
+		++m_job_generation;
+	}
+
+	m_wake_cv.notify_all();
+
+	tl_is_in_job = true;
+
+	participate(0);
+
+	tl_is_in_job = false;
+
+	std::unique_lock<std::mutex> lock(m_state_mtx);
+
+	m_done_cv.wait(lock, [this] { return m_busy_workers == 0; });
+
+	m_job = nullptr;
+
+	if (m_job_failed.load(std::memory_order_relaxed))
+	{
+		m_job_failed.store(false, std::memory_order_relaxed);
+
+		std::exception_ptr error = std::move(m_job_error);
+
+		m_job_error = nullptr;
+
+		std::rethrow_exception(error);
+	}
+}
+
+thread_pool& thread_pool::global()
+{
+	static thread_pool pool;
+
+	return pool;
+}
+
+void thread_pool::worker_loop(uint32_t thread_idx)
+{
+	tl_is_in_job = true;
+
+	char name[32];
+
+	snprintf(name, sizeof(name), "pool worker %u", thread_idx);
+
+	trace_set_thread_name(name);
+
+	uint64_t seen_generation = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_state_mtx);
+
+			m_wake_cv.wait(lock, [&] { return m_is_stopping || m_job_generation != seen_generation; });
+
+			if (m_is_stopping)
+				return;
+
+			seen_generation = m_job_generation;
+
+			if (thread_idx >= m_job_thread_cnt)
+				continue;
+		}
+
+		participate(thread_idx);
+
+		{
+			std::lock_guard<std::mutex> lock(m_state_mtx);
+
+			--m_busy_workers;
+		}
+
+		m_done_cv.notify_one();
+	}
+}
+
+void thread_pool::participate(uint32_t thread_idx)
+{
+	const task_fn& fn = *m_job;
+
+	uint32_t task_idx;
+
+	//Once a task has thrown, the remaining ones are still popped, so the queues are empty for the next job, but not run
+	while (pop_task(thread_idx, task_idx))
+	{
+		if (m_job_failed.load(std::memory_order_relaxed))
+			continue;
+
+		try
+		{
+			fn(task_idx, thread_idx);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(m_state_mtx);
+
+			if (!m_job_error)
+				m_job_error = std::current_exception();
+
+			m_job_failed.store(true, std::memory_order_relaxed);
+		}
+	}
+}
+
+bool thread_pool::pop_task(uint32_t thread_idx, uint32_t& task_idx)
+{
+	{
+		task_queue& own = m_queues[thread_idx];
+
+		std::lock_guard<std::mutex> lock(own.mtx);
+
+		if (!own.tasks.empty())
+		{
+			task_idx = own.tasks.back();
+
+			own.tasks.pop_back();
+
+			return true;
+		}
+	}
+
+	//Own queue is empty; steal from the others, starting with the next thread
+	const uint32_t queue_cnt = m_job_thread_cnt;
+
+	for (uint32_t i = 1; i != queue_cnt; ++i)
+	{
+		task_queue& victim = m_queues[(thread_idx + i) % queue_cnt];
+
+		std::lock_guard<std::mutex> lock(victim.mtx);
+
+		if (!victim.tasks.empty())
+		{
+			task_idx = victim.tasks.front();
+
+			victim.tasks.pop_front();
+
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <exception>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Pool of persistent worker-threads executing index-based jobs.
+//Every thread taking part in a job owns a deque of task-indices. It pops from the back of its own deque
+//and, once that runs dry, steals from the front of the other threads' deques.
+struct thread_pool
+{
+	//Called once for every task-index. thread_idx is in [0, participating threads) and stable for the duration of the call
+	using task_fn = std::function<void(uint32_t task_idx, uint32_t thread_idx)>;
+
+	explicit thread_pool(uint32_t thread_cnt = 0);
+
+	~thread_pool();
+
+	thread_pool(const thread_pool&) = delete;
+
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	//Number of threads that can take part in a job, including the calling thread
+	uint32_t thread_cnt() const noexcept;
+
+	//Runs fn for every task-index in [0, task_cnt) on at most max_threads threads (0 means all) and returns once all tasks are done.
+	//The calling thread takes part in the job. Nested calls from inside a task are run serially on the calling thread.
+	//If a task throws, tasks that have not started yet are skipped, and the first exception is rethrown once all threads are done.
+	void parallel_for(uint32_t task_cnt, const task_fn& fn, uint32_t max_threads = 0);
+
+	//Lazily constructed pool with one thread per hardware thread
+	static thread_pool& global();
+
+private:
+
+	struct task_queue
+	{
+		std::mutex mtx;
+		std::deque<uint32_t> tasks;
+	};
+
+	void worker_loop(uint32_t thread_idx);
+
+	void participate(uint32_t thread_idx);
+
+	bool pop_task(uint32_t thread_idx, uint32_t& task_idx);
+
+	std::vector<std::thread> m_workers;
+
+	std::unique_ptr<task_queue[]> m_queues;
+
+	std::mutex m_submit_mtx;
+
+	std::mutex m_state_mtx;
+	std::condition_variable m_wake_cv;
+	std::condition_variable m_done_cv;
+
+	const task_fn* m_job = nullptr;
+	std::exception_ptr m_job_error;
+	std::atomic<bool> m_job_failed{ false };
+	uint64_t m_job_generation = 0;
+	uint32_t m_job_thread_cnt = 0;
+	uint32_t m_busy_workers = 0;
+	bool m_is_stopping = false;
+};
@@ -0,0 +1,265 @@
+#include "och_trace.h"
+
+#include <cstdio>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct trace_event
+{
+	const char* name;
+
+	uint64_t begin;
+
+	uint64_t ticks;
+
+	trace_arg args[trace_max_args];
+
+	uint32_t arg_cnt;
+};
+
+//Events of one thread. mtx is only contended while trace_write_json drains the buffer
+struct thread_buffer
+{
+	std::mutex mtx;
+
+	std::vector<trace_event> events;
+
+	std::string name;
+
+	uint32_t tid;
+
+	uint64_t dropped;
+};
+
+static std::atomic<bool> s_is_active{ false };
+
+//Buffers outlive their threads, so events of finished threads are still written
+static std::mutex s_buffers_mtx;
+
+static std::vector<std::unique_ptr<thread_buffer>> s_buffers;
+
+static thread_local thread_buffer* tl_buffer = nullptr;
+
+//Events reserved when a thread first records, so that most traces never grow a buffer inside a traced scope
+static constexpr uint32_t initial_event_capacity = 1 << 12;
+
+//Events dropped by threads whose buffer could not be allocated
+static std::atomic<uint64_t> s_unbuffered_dropped{ 0 };
+
+//Returns nullptr if the buffer could not be allocated, so that recording never throws
+static thread_buffer* own_buffer() noexcept
+{
+	if (!tl_buffer)
+	{
+		try
+		{
+			std::unique_ptr<thread_buffer> buf(new thread_buffer);
+
+			buf->events.reserve(initial_event_capacity);
+
+			buf->dropped = 0;
+
+			std::lock_guard<std::mutex> lock(s_buffers_mtx);
+
+			s_buffers.push_back(std::move(buf));
+
+			tl_buffer = s_buffers.back().get();
+
+			tl_buffer->tid = static_cast<uint32_t>(s_buffers.size());
+		}
+		catch (...)
+		{
+			return nullptr;
+		}
+	}
+
+	return tl_buffer;
+}
+
+void trace_start() noexcept
+{
+	s_is_active.store(true, std::memory_order_relaxed);
+}
+
+void trace_stop() noexcept
+{
+	s_is_active.store(false, std::memory_order_relaxed);
+}
+
+bool trace_is_active() noexcept
+{
+	return s_is_active.load(std::memory_order_relaxed);
+}
+
+void trace_set_thread_name(const char* name)
+{
+	thread_buffer* const buf = own_buffer();
+
+	if (!buf)
+		return;
+
+	std::lock_guard<std::mutex> lock(buf->mtx);
+
+	buf->name = name;
+}
+
+void trace_record(const char* name, uint64_t begin_ticks, uint64_t end_ticks, const trace_arg* args, uint32_t arg_cnt) noexcept
+{
+	thread_buffer* const buf = own_buffer();
+
+	if (!buf)
+	{
+		s_unbuffered_dropped.fetch_add(1, std::memory_order_relaxed);
+
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(buf->mtx);
+
+	if (buf->events.size() == trace_max_events_per_thread)
+	{
+		++buf->dropped;
+
+		return;
+	}
+
+	trace_event e;
+
+	e.name = name;
+	e.begin = begin_ticks;
+	e.ticks = end_ticks - begin_ticks;
+	e.arg_cnt = arg_cnt < trace_max_args ? arg_cnt : trace_max_args;
+
+	for (uint32_t i = 0; i != e.arg_cnt; ++i)
+		e.args[i] = args[i];
+
+	//Growing the buffer past its reserved capacity can fail, in which case the event is dropped as if the buffer were full
+	try
+	{
+		buf->events.push_back(e);
+	}
+	catch (...)
+	{
+		++buf->dropped;
+	}
+}
+
+//Writes str as a JSON string, escaping quotes, backslashes and control characters
+static void write_json_string(FILE* f, const char* str)
+{
+	fputc('"', f);
+
+	for (const char* c = str; *c; ++c)
+	{
+		if (*c == '"' || *c == '\\')
+			fprintf(f, "\\%c", *c);
+		else if (static_cast<unsigned char>(*c) < 0x20)
+			fprintf(f, "\\u%04x", static_cast<unsigned char>(*c));
+		else
+			fputc(*c, f);
+	}
+
+	fputc('"', f);
+}
+
+bool trace_write_json(const char* path)
+{
+	FILE* json = fopen(path, "w");
+
+	if (!json)
+		return false;
+
+	struct thread_events
+	{
+		std::vector<trace_event> events;
+
+		std::string name;
+
+		uint32_t tid;
+
+		uint64_t dropped;
+	};
+
+	std::vector<thread_events> threads;
+
+	{
+		std::lock_guard<std::mutex> lock(s_buffers_mtx);
+
+		for (const std::unique_ptr<thread_buffer>& buf : s_buffers)
+		{
+			std::lock_guard<std::mutex> buf_lock(buf->mtx);
+
+			threads.push_back({ std::move(buf->events), buf->name, buf->tid, buf->dropped });
+
+			buf->events.clear();
+
+			buf->events.reserve(initial_event_capacity);
+
+			buf->dropped = 0;
+		}
+	}
+
+	uint64_t origin = UINT64_MAX;
+
+	for (const thread_events& t : threads)
+		for (const trace_event& e : t.events)
+			if (e.begin < origin)
+				origin = e.begin;
+
+	const double us_per_tick = frame_stats_ns_per_tick() * 1e-3;
+
+	fprintf(json, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+	bool is_first = true;
+
+	for (const thread_events& t : threads)
+	{
+		fprintf(json, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", is_first ? "" : ",\n", t.tid);
+
+		if (t.name.empty())
+			fprintf(json, "\"thread %u\"", t.tid);
+		else
+			write_json_string(json, t.name.c_str());
+
+		fprintf(json, ",\"dropped_events\":%llu}}", static_cast<unsigned long long>(t.dropped));
+
+		is_first = false;
+
+		for (const trace_event& e : t.events)
+		{
+			fprintf(json, ",\n{\"name\":");
+
+			write_json_string(json, e.name);
+
+			fprintf(json, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", t.tid, static_cast<double>(e.begin - origin) * us_per_tick, static_cast<double>(e.ticks) * us_per_tick);
+
+			if (e.arg_cnt)
+			{
+				fprintf(json, ",\"args\":{");
+
+				for (uint32_t i = 0; i != e.arg_cnt; ++i)
+				{
+					if (i)
+						fputc(',', json);
+
+					write_json_string(json, e.args[i].name);
+
+					fprintf(json, ":%lld", static_cast<long long>(e.args[i].value));
+				}
+
+				fputc('}', json);
+			}
+
+			fputc('}', json);
+		}
+	}
+
+	fprintf(json, "\n],\"otherData\":{\"unbuffered_dropped_events\":%llu}}\n", static_cast<unsigned long long>(s_unbuffered_dropped.exchange(0, std::memory_order_relaxed)));
+
+	fclose(json);
+
+	return true;
+}
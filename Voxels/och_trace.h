@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+
+#include "och_frame_stats.h"
+
+//Set to 0 to compile all trace scopes out. Stages timed by och_frame_stats are still traced while tracing is active
+#ifndef OCH_TRACE
+#define OCH_TRACE 1
+#endif
+
+//Named integer attached to a trace event, e.g. a loop index or a byte count. name must outlive the trace
+struct trace_arg
+{
+	const char* name;
+
+	int64_t value;
+
+	constexpr trace_arg() noexcept : name{ nullptr }, value{ 0 } {}
+
+	template<typename T>
+	constexpr trace_arg(const char* arg_name, T arg_value) noexcept : name{ arg_name }, value{ static_cast<int64_t>(arg_value) } {}
+};
+
+static constexpr uint32_t trace_max_args = 3;
+
+//Events a single thread buffers before further ones are dropped
+static constexpr uint32_t trace_max_events_per_thread = 1 << 20;
+
+//Events are only recorded between trace_start and trace_stop, so that instrumented code costs a single load otherwise
+void trace_start() noexcept;
+
+void trace_stop() noexcept;
+
+bool trace_is_active() noexcept;
+
+//Name shown for the calling thread's track in the timeline. Copied
+void trace_set_thread_name(const char* name);
+
+//Appends a complete event spanning [begin_ticks, end_ticks), in frame_stats_now() ticks, to the calling thread's buffer.
+//Only the first trace_max_args args are kept. name must outlive the trace, as is the case for string-literals.
+//Events that do not fit, because the buffer is full or cannot grow, are dropped and counted in the trace instead of throwing
+void trace_record(const char* name, uint64_t begin_ticks, uint64_t end_ticks, const trace_arg* args, uint32_t arg_cnt) noexcept;
+
+//Moves the events of all threads' buffers into a Chrome trace event JSON file, which can be opened in chrome://tracing
+//or ui.perfetto.dev. The buffers are empty afterwards. Returns false if path could not be opened
+bool trace_write_json(const char* path);
+
+//Records the time between its construction and destruction as an event, if tracing was active on construction
+struct trace_scope
+{
+	trace_scope(const char* name, std::initializer_list<trace_arg> args) noexcept : m_name{ name }, m_arg_cnt{ 0 }, m_begin{ 0 }
+	{
+		if (!trace_is_active())
+			return;
+
+		for (const trace_arg& arg : args)
+			if (m_arg_cnt != trace_max_args)
+				m_args[m_arg_cnt++] = arg;
+
+		m_begin = frame_stats_now();
+	}
+
+	~trace_scope()
+	{
+		if (m_begin)
+			trace_record(m_name, m_begin, frame_stats_now(), m_args, m_arg_cnt);
+	}
+
+	trace_scope(const trace_scope&) = delete;
+
+	trace_scope& operator=(const trace_scope&) = delete;
+
+private:
+
+	const char* m_name;
+
+	trace_arg m_args[trace_max_args];
+
+	uint32_t m_arg_cnt;
+
+	uint64_t m_begin;
+};
+
+#define OCH_TRACE_CONCAT_(a, b) a##b
+#define OCH_TRACE_CONCAT(a, b) OCH_TRACE_CONCAT_(a, b)
+
+#if OCH_TRACE
+//Traces the rest of the enclosing scope, e.g. OCH_TRACE_SCOPE("fill", { "i", i }, { "bytes", n })
+#define OCH_TRACE_SCOPE(name, ...) trace_scope OCH_TRACE_CONCAT(och_trace_scope_, __LINE__)(name, { __VA_ARGS__ })
+#else
+#define OCH_TRACE_SCOPE(name, ...) ((void)0)
+#endif
@@ -2,16 +2,15 @@
 
 #include <cstdio>
 #include <cstdint>
+#include <cmath>
+#include <vector>
 
-#include "cuda.h"
-#include "cuda_texture_types.h"
-#include "cuda_runtime_api.h"
-#include "cuda_runtime.h"
-#include "device_launch_parameters.h"
-#include "channel_descriptor.h"
+#include "och_cuda_compat.cuh"
 
 #include "och_cudahelpers.cuh"
 #include "och_simplex_noise_gpu.cuh"
+#include "och_frame_stats.h"
+#include "och_trace.h"
 
 #include "och_timer.h"
 
@@ -21,12 +20,50 @@ texture<uint8_t, cudaTextureType3D, cudaReadModeElementType> d_voxel_tex;
 
 uint8_t* d_slice;
 
+//Device and pinned host memory for one asynchronous slice, filled in order on s_slice_stream
+struct slice_buffer
+{
+	uint8_t* d_slice;
+
+	uint8_t* h_slice;
+
+	cudaEvent_t copied;
+
+	uint64_t serial;
+};
+
+static cudaStream_t s_slice_stream;
+
+static slice_buffer s_slice_buffers[slice_buffer_cnt];
+
+static uint64_t s_slice_serial;
+
+//Edge of the chunks init_voxels generates the volume in
+static constexpr uint32_t init_chunk_dim = 16;
+
 void init_voxels(const uint32_t dim_log2, float noise_limit, uint32_t noise_seed)
 {
 	const uint32_t dim = 1 << dim_log2;
 
+	OCH_TRACE_SCOPE("init_voxels", { "dim", dim });
+
 	CHECK(cudaMalloc(&d_slice, dim * dim));
 
+	CHECK(cudaStreamCreate(&s_slice_stream));
+
+	for (slice_buffer& buf : s_slice_buffers)
+	{
+		CHECK(cudaMalloc(&buf.d_slice, dim * dim));
+
+		CHECK(cudaMallocHost(&buf.h_slice, dim * dim));
+
+		CHECK(cudaEventCreate(&buf.copied));
+
+		buf.serial = 0;
+	}
+
+	s_slice_serial = 0;
+
 	och::print("\nStarting init_volume\n");
 
 	//device array
@@ -34,21 +71,41 @@ void init_voxels(const uint32_t dim_log2, float noise_limit, uint32_t noise_seed
 
 	CHECK(cudaMalloc3D(&d_voxel_lin, make_cudaExtent(dim, dim, dim)));
 
-	dim3 threads_per_block(32, 32, 32);
-	dim3 blocks_per_grid(dim / 32, dim / 32, dim / 32);
+	//One chunk descriptor per init_chunk_dim^3 region, sampling a single continuous noise field across the volume
+	const uint32_t chunks_per_axis = dim < init_chunk_dim ? 1 : dim / init_chunk_dim;
+
+	const uint32_t chunk_dim = dim < init_chunk_dim ? dim : init_chunk_dim;
+
+	const float3 step = make_float3(16.0F / dim, 16.0F / dim, 1.0F / dim);
+
+	std::vector<noise_chunk> chunks;
+
+	chunks.reserve(static_cast<size_t>(chunks_per_axis) * chunks_per_axis * chunks_per_axis);
+
+	for (uint32_t z = 0; z != chunks_per_axis; ++z)
+		for (uint32_t y = 0; y != chunks_per_axis; ++y)
+			for (uint32_t x = 0; x != chunks_per_axis; ++x)
+			{
+				const uint3 origin = make_uint3(x * chunk_dim, y * chunk_dim, z * chunk_dim);
+
+				chunks.push_back({ origin, make_float3(origin.x * step.x, origin.y * step.y, origin.z * step.z), step, noise_seed });
+			}
+
+	std::vector<cudaError_t> chunk_errors(chunks.size());
 
 	och::timer dev_fill_timer;
 
-	for (int i = 0; i != 16 * 16 * 16; ++i)
 	{
-		d_simplex_3d_uint8_t<<<threads_per_block, blocks_per_grid>>>(d_voxel_lin, make_uint3(dim, dim, dim), make_float3(0.0F, 0.0F, 0.0F), make_float3(16.0F / dim, 16.0F / dim, 1.0F / dim), i);
-		cudaError_t err = cudaGetLastError();
-		if (err != cudaSuccess)
-			och::print("Error (loop #{}): {}\n", i, cudaGetErrorString(err));
-		cudaDeviceSynchronize();
+		OCH_TRACE_SCOPE("generate_chunks", { "chunks", chunks.size() }, { "chunk_dim", chunk_dim }, { "voxels", static_cast<uint64_t>(dim) * dim * dim });
+
+		launch_simplex_3d_uint8_t_chunks(d_voxel_lin, make_uint3(dim, dim, dim), chunks.data(), static_cast<uint32_t>(chunks.size()), chunk_dim, chunk_errors.data());
 	}
 
-	och::print("\n{} for {}^3 noise-calls\n", dev_fill_timer.read(), dim);
+	och::print("\n{} for {} chunks of {}^3 noise-calls\n", dev_fill_timer.read(), chunks.size(), chunk_dim);
+
+	for (size_t i = 0; i != chunks.size(); ++i)
+		if (chunk_errors[i] != cudaSuccess)
+			och::print("Error (chunk #{}): {}\n", i, cudaGetErrorString(chunk_errors[i]));
 
 	//device cudaArray
 	cudaChannelFormatDesc channel_desc = cudaCreateChannelDesc<uint8_t>();
@@ -62,7 +119,11 @@ void init_voxels(const uint32_t dim_log2, float noise_limit, uint32_t noise_seed
 	cpy_params.extent = make_cudaExtent(dim, dim, dim);
 	cpy_params.kind = cudaMemcpyHostToDevice;
 
-	CHECK(cudaMemcpy3D(&cpy_params));
+	{
+		OCH_TRACE_SCOPE("copy_to_array", { "bytes", static_cast<uint64_t>(dim) * dim * dim });
+
+		CHECK(cudaMemcpy3D(&cpy_params));
+	}
 
 	d_voxel_tex.normalized = false;
 	d_voxel_tex.filterMode = cudaFilterModePoint;
@@ -88,16 +149,260 @@ void get_slice(uint8_t* h_slice, uint32_t z, uint32_t dim)
 	dim3 threads_per_block(32, 32);
 
 	dim3 blocks_per_grid(dim / 32, dim / 32);
+
+	OCH_TRACE_SCOPE("get_slice", { "z", z }, { "bytes", dim * dim });
 	
-	get_slice_kernel<<<threads_per_block, blocks_per_grid>>>(d_slice, z, dim);
+	{
+		OCH_FRAME_PROBE(kernel_launch);
+
+		OCH_LAUNCH(get_slice_kernel, threads_per_block, blocks_per_grid)(d_slice, z, dim);
+	}
+
 	cudaError_t err = cudaGetLastError();
 	if (err != cudaSuccess)
 		printf("Error2: %s\n", cudaGetErrorString(err));
 
+	OCH_FRAME_PROBE(slice_copy);
+
 	CHECK(cudaMemcpy(h_slice, d_slice, dim * dim, cudaMemcpyDeviceToHost));
 }
 
+//One instantiation per axis, so that mapping (u, v) to texel coordinates costs nothing per thread. Reads go through the
+//texture cache, which is laid out in 3D blocks, so x-, y- and z-slices touch the same number of cache lines
+template<slice_axis axis>
+__global__ void get_slice_region_kernel(uint8_t* dst, uint32_t idx, uint2 beg, uint2 dim)
+{
+	const uint32_t u = threadIdx.x + blockIdx.x * blockDim.x;
+	const uint32_t v = threadIdx.y + blockIdx.y * blockDim.y;
+
+	if (u >= dim.x || v >= dim.y)
+		return;
+
+	const uint32_t a = beg.x + u;
+	const uint32_t b = beg.y + v;
+
+	uint8_t val;
+
+	if (axis == slice_axis::z)
+		val = tex3D<uint8_t>(d_voxel_tex, a, b, idx);
+	else if (axis == slice_axis::y)
+		val = tex3D<uint8_t>(d_voxel_tex, a, idx, b);
+	else
+		val = tex3D<uint8_t>(d_voxel_tex, idx, a, b);
+
+	dst[u + v * dim.x] = val;
+}
+
+//Interpolates from eight point-sampled texels rather than using the texture unit's linear filtering, whose weights only
+//have 8 bits of fraction. Border addressing supplies the 0 outside the volume
+__global__ void get_oblique_slice_kernel(uint8_t* dst, slice_plane plane, uint2 dim)
+{
+	const uint32_t u = threadIdx.x + blockIdx.x * blockDim.x;
+	const uint32_t v = threadIdx.y + blockIdx.y * blockDim.y;
+
+	if (u >= dim.x || v >= dim.y)
+		return;
+
+	const float x = plane.origin[0] + plane.u_step[0] * u + plane.v_step[0] * v;
+	const float y = plane.origin[1] + plane.u_step[1] * u + plane.v_step[1] * v;
+	const float z = plane.origin[2] + plane.u_step[2] * u + plane.v_step[2] * v;
+
+	const float x0 = floorf(x);
+	const float y0 = floorf(y);
+	const float z0 = floorf(z);
+
+	const float fx = x - x0;
+	const float fy = y - y0;
+	const float fz = z - z0;
+
+	//Texel i covers [i, i + 1), so its centre is sampled to hit it regardless of rounding
+	const float cx = x0 + 0.5F;
+	const float cy = y0 + 0.5F;
+	const float cz = z0 + 0.5F;
+
+	const float c00 = tex3D<uint8_t>(d_voxel_tex, cx, cy,        cz       ) * (1.0F - fx) + tex3D<uint8_t>(d_voxel_tex, cx + 1.0F, cy,        cz       ) * fx;
+	const float c10 = tex3D<uint8_t>(d_voxel_tex, cx, cy + 1.0F, cz       ) * (1.0F - fx) + tex3D<uint8_t>(d_voxel_tex, cx + 1.0F, cy + 1.0F, cz       ) * fx;
+	const float c01 = tex3D<uint8_t>(d_voxel_tex, cx, cy,        cz + 1.0F) * (1.0F - fx) + tex3D<uint8_t>(d_voxel_tex, cx + 1.0F, cy,        cz + 1.0F) * fx;
+	const float c11 = tex3D<uint8_t>(d_voxel_tex, cx, cy + 1.0F, cz + 1.0F) * (1.0F - fx) + tex3D<uint8_t>(d_voxel_tex, cx + 1.0F, cy + 1.0F, cz + 1.0F) * fx;
+
+	const float c0 = c00 * (1.0F - fy) + c10 * fy;
+	const float c1 = c01 * (1.0F - fy) + c11 * fy;
+
+	dst[u + v * dim.x] = static_cast<uint8_t>(c0 * (1.0F - fz) + c1 * fz + 0.5F);
+}
+
+//Device buffer the region and oblique kernels write to, grown as needed
+static uint8_t* s_region;
+
+static size_t s_region_bytes;
+
+static uint8_t* region_buffer(size_t bytes)
+{
+	if (bytes > s_region_bytes)
+	{
+		CHECK(cudaFree(s_region));
+
+		CHECK(cudaMalloc(&s_region, bytes));
+
+		s_region_bytes = bytes;
+	}
+
+	return s_region;
+}
+
+void get_slice_region(uint8_t* dst, size_t dst_pitch, slice_axis axis, uint32_t idx, uint32_t u_beg, uint32_t v_beg, uint32_t w, uint32_t h)
+{
+	if (!w || !h)
+		return;
+
+	OCH_TRACE_SCOPE("get_slice_region", { "axis", static_cast<uint32_t>(axis) }, { "idx", idx }, { "bytes", static_cast<uint64_t>(w) * h });
+
+	uint8_t* d_region = region_buffer(static_cast<size_t>(w) * h);
+
+	const dim3 block(16, 16);
+
+	const dim3 grid((w + 15) / 16, (h + 15) / 16);
+
+	const uint2 beg = make_uint2(u_beg, v_beg);
+
+	const uint2 dim = make_uint2(w, h);
+
+	if (axis == slice_axis::z)
+		OCH_LAUNCH(get_slice_region_kernel<slice_axis::z>, grid, block)(d_region, idx, beg, dim);
+	else if (axis == slice_axis::y)
+		OCH_LAUNCH(get_slice_region_kernel<slice_axis::y>, grid, block)(d_region, idx, beg, dim);
+	else
+		OCH_LAUNCH(get_slice_region_kernel<slice_axis::x>, grid, block)(d_region, idx, beg, dim);
+
+	cudaError_t err = cudaGetLastError();
+	if (err != cudaSuccess)
+		printf("Error4: %s\n", cudaGetErrorString(err));
+
+	CHECK(cudaMemcpy2D(dst, dst_pitch, d_region, w, w, h, cudaMemcpyDeviceToHost));
+}
+
+void get_oblique_slice(uint8_t* dst, size_t dst_pitch, const slice_plane& plane, uint32_t w, uint32_t h)
+{
+	if (!w || !h)
+		return;
+
+	OCH_TRACE_SCOPE("get_oblique_slice", { "bytes", static_cast<uint64_t>(w) * h });
+
+	uint8_t* d_region = region_buffer(static_cast<size_t>(w) * h);
+
+	const dim3 block(16, 16);
+
+	const dim3 grid((w + 15) / 16, (h + 15) / 16);
+
+	OCH_LAUNCH(get_oblique_slice_kernel, grid, block)(d_region, plane, make_uint2(w, h));
+
+	cudaError_t err = cudaGetLastError();
+	if (err != cudaSuccess)
+		printf("Error5: %s\n", cudaGetErrorString(err));
+
+	CHECK(cudaMemcpy2D(dst, dst_pitch, d_region, w, w, h, cudaMemcpyDeviceToHost));
+}
+
+slice_handle request_slice(uint32_t z, uint32_t dim)
+{
+	OCH_TRACE_SCOPE("request_slice", { "z", z }, { "bytes", dim * dim });
+
+	const uint64_t serial = ++s_slice_serial;
+
+	const uint32_t buffer = static_cast<uint32_t>(serial % slice_buffer_cnt);
+
+	slice_buffer& buf = s_slice_buffers[buffer];
+
+	buf.serial = serial;
+
+	dim3 threads_per_block(32, 32);
+
+	dim3 blocks_per_grid(dim / 32, dim / 32);
+
+	{
+		OCH_FRAME_PROBE(kernel_launch);
+
+		OCH_LAUNCH_STREAM(get_slice_kernel, threads_per_block, blocks_per_grid, s_slice_stream)(buf.d_slice, z, dim);
+	}
+
+	cudaError_t err = cudaGetLastError();
+	if (err != cudaSuccess)
+		printf("Error3: %s\n", cudaGetErrorString(err));
+
+	CHECK(cudaMemcpyAsync(buf.h_slice, buf.d_slice, dim * dim, cudaMemcpyDeviceToHost, s_slice_stream));
+
+	CHECK(cudaEventRecord(buf.copied, s_slice_stream));
+
+	return { serial, z, buffer };
+}
+
+const uint8_t* try_get_slice(const slice_handle& slice)
+{
+	const slice_buffer& buf = s_slice_buffers[slice.buffer];
+
+	if (buf.serial != slice.serial)
+		return nullptr;
+
+	const cudaError_t status = cudaEventQuery(buf.copied);
+
+	if (status == cudaErrorNotReady)
+		return nullptr;
+
+	CHECK(status);
+
+	return buf.h_slice;
+}
+
+const uint8_t* wait_slice(const slice_handle& slice)
+{
+	const slice_buffer& buf = s_slice_buffers[slice.buffer];
+
+	if (buf.serial != slice.serial)
+		return nullptr;
+
+	OCH_FRAME_PROBE(slice_copy);
+
+	CHECK(cudaEventSynchronize(buf.copied));
+
+	return buf.h_slice;
+}
+
 void launch_voxels(uint32_t dim_log2, float noise_limit, uint32_t noise_seed)
 {
 	init_voxels(dim_log2, noise_limit, noise_seed);
 }
+
+void release_voxels()
+{
+	//Slice requests still in flight read the volume and write the slice buffers
+	CHECK(cudaStreamSynchronize(s_slice_stream));
+
+	CHECK(cudaStreamDestroy(s_slice_stream));
+
+	CHECK(cudaUnbindTexture(&d_voxel_tex));
+
+	CHECK(cudaFreeArray(d_voxel_arr));
+
+	CHECK(cudaFree(d_slice));
+
+	for (slice_buffer& buf : s_slice_buffers)
+	{
+		CHECK(cudaEventDestroy(buf.copied));
+
+		CHECK(cudaFreeHost(buf.h_slice));
+
+		CHECK(cudaFree(buf.d_slice));
+	}
+
+	s_slice_stream = nullptr;
+
+	CHECK(cudaFree(s_region));
+
+	s_region = nullptr;
+
+	s_region_bytes = 0;
+
+	d_voxel_arr = nullptr;
+
+	d_slice = nullptr;
+}
@@ -1,7 +1,44 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+
+#include "och_slice_plane.h"
 
 void launch_voxels(uint32_t dim_log2, float noise_limit, uint32_t noise_seed);
 
-void get_slice(uint8_t* dst, uint32_t idx, uint32_t z);
\ No newline at end of file
+void get_slice(uint8_t* dst, uint32_t idx, uint32_t z);
+
+//Rectangle [u_beg, u_beg + w) x [v_beg, v_beg + h) of the slice at idx along axis, written to dst[u + v * dst_pitch].
+//(u, v) is (x, y) for z-slices, (x, z) for y-slices and (y, z) for x-slices. Voxels outside the volume read as 0
+void get_slice_region(uint8_t* dst, size_t dst_pitch, slice_axis axis, uint32_t idx, uint32_t u_beg, uint32_t v_beg, uint32_t w, uint32_t h);
+
+//w x h samples of plane through the volume, written to dst[u + v * dst_pitch]
+void get_oblique_slice(uint8_t* dst, size_t dst_pitch, const slice_plane& plane, uint32_t w, uint32_t h);
+
+//Number of host buffers asynchronous slices are copied into, so that one can be read while the next one is being filled
+static constexpr uint32_t slice_buffer_cnt = 2;
+
+//Slice requested with request_slice. serial counts requests since launch_voxels and identifies the request
+struct slice_handle
+{
+	uint64_t serial;
+
+	uint32_t z;
+
+	uint32_t buffer;
+};
+
+//Starts copying slice z of the dim^3 volume into the next slice buffer and returns without waiting for it.
+//The buffer is reused by the request slice_buffer_cnt requests later, so the slice must no longer be read by then
+slice_handle request_slice(uint32_t z, uint32_t dim);
+
+//Returns the dim * dim bytes of the requested slice, laid out as with get_slice, if its copy has completed.
+//Returns nullptr without blocking if it is still in progress or if its buffer has been reused since
+const uint8_t* try_get_slice(const slice_handle& slice);
+
+//Like try_get_slice, but blocks until the copy has completed
+const uint8_t* wait_slice(const slice_handle& slice);
+
+//Frees the volume and slice buffers created by launch_voxels, so it can be called again with a different size
+void release_voxels();